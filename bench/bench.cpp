@@ -1,15 +1,31 @@
 #include <random>
 #include <benchmark/benchmark.h>
 #include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/numa.hpp"
+#include "lru-kvstore/shared_memory.hpp"
+#include "workload.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <span>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <sstream>
 #include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace kvstore;
 
 constexpr size_t CAPACITY = 1024;
 
+// Cap on distinct "cold" keys so the 16M-entry runs stay within memory.
+constexpr size_t MAX_COLD_KEYS = size_t{1} << 24;
+
 // Utility: generate N unique keys
 std::vector<std::string> generate_keys(size_t count) {
     std::vector<std::string> keys;
@@ -20,67 +36,91 @@ std::vector<std::string> generate_keys(size_t count) {
     return keys;
 }
 
+static Options options_for(size_t capacity, ProbeKernel kernel = ProbeKernel::Simd) {
+    Options options;
+    options.capacity = capacity;
+    options.probe_kernel = kernel;
+    return options;
+}
+
 // Benchmark: insert CAPACITY keys (no eviction)
 static void BM_Insert_NoEvict(benchmark::State& state) {
-    auto keys = generate_keys(CAPACITY);
+    const size_t capacity = state.range(0);
+    KeySet keys(capacity);
     for (auto _ : state) {
         state.PauseTiming();
-        KVStore store;
+        auto store = std::make_unique<KVStore>(options_for(capacity));
         state.ResumeTiming();
-        for (size_t i = 0; i < CAPACITY; ++i) {
-            store.put(keys[i], "val");
+        for (size_t i = 0; i < capacity; ++i) {
+            store->put(keys[i], "val");
         }
+        state.PauseTiming();
+        store.reset();
+        state.ResumeTiming();
     }
+    state.SetItemsProcessed(state.iterations() * capacity);
 }
 
-// Benchmark: insert 10x CAPACITY keys (max eviction)
+// Benchmark: insert 10x CAPACITY keys (max eviction). The keys cycle through a
+// pool twice the capacity, so every put past the first CAPACITY still misses
+// and evicts.
 static void BM_Insert_WithEvict(benchmark::State& state) {
-    const size_t N = CAPACITY * 10;
-    auto keys = generate_keys(N);
+    const size_t capacity = state.range(0);
+    const size_t N = capacity * 10;
+    KeySet keys(capacity * 2);
     for (auto _ : state) {
         state.PauseTiming();
-        KVStore store;
+        auto store = std::make_unique<KVStore>(options_for(capacity));
         state.ResumeTiming();
         for (size_t i = 0; i < N; ++i) {
-            store.put(keys[i], "val");
+            store->put(keys[i % keys.size()], "val");
         }
+        state.PauseTiming();
+        store.reset();
+        state.ResumeTiming();
     }
+    state.SetItemsProcessed(state.iterations() * N);
 }
 
 // Benchmark: read only from hot set (100% hit rate)
 static void BM_Get_HotHit(benchmark::State& state) {
-    auto keys = generate_keys(CAPACITY);
-    KVStore store;
-    for (auto& key : keys) store.put(key, "val");
+    const size_t capacity = state.range(0);
+    KeySet keys(capacity);
+    KVStore store(options_for(capacity));
+    for (size_t i = 0; i < keys.size(); ++i) store.put(keys[i], "val");
 
     for (auto _ : state) {
-        for (auto& key : keys) {
-            benchmark::DoNotOptimize(store.get(key));
+        for (size_t i = 0; i < keys.size(); ++i) {
+            benchmark::DoNotOptimize(store.get(keys[i]));
         }
     }
+    state.SetItemsProcessed(state.iterations() * keys.size());
 }
 
 // Benchmark: read cold keys that were never inserted (100% miss)
 static void BM_Get_ColdMiss(benchmark::State& state) {
-    auto keys = generate_keys(CAPACITY * 10);
-    KVStore store; // Empty
+    const size_t capacity = state.range(0);
+    KeySet keys(std::min(capacity * 10, MAX_COLD_KEYS));
+    KVStore store(options_for(capacity)); // Empty
 
     for (auto _ : state) {
-        for (auto& key : keys) {
-            benchmark::DoNotOptimize(store.get(key));
+        for (size_t i = 0; i < keys.size(); ++i) {
+            benchmark::DoNotOptimize(store.get(keys[i]));
         }
     }
+    state.SetItemsProcessed(state.iterations() * keys.size());
 }
 
 // Benchmark: mixed hot/cold access pattern
 static void BM_Mixed_HotCold(benchmark::State& state) {
-    const size_t hot_size = CAPACITY / 2;
-    const size_t cold_size = CAPACITY * 10;
-    auto hot_keys = generate_keys(hot_size);
-    auto cold_keys = generate_keys(cold_size);
+    const size_t capacity = state.range(0);
+    const size_t hot_size = capacity / 2;
+    const size_t cold_size = std::min(capacity * 10, MAX_COLD_KEYS);
+    KeySet hot_keys(hot_size);
+    KeySet cold_keys(cold_size);
 
-    KVStore store;
-    for (auto& key : hot_keys) store.put(key, "val");
+    KVStore store(options_for(capacity));
+    for (size_t i = 0; i < hot_keys.size(); ++i) store.put(hot_keys[i], "val");
 
     std::mt19937 rng(42);
     std::bernoulli_distribution hot_prob(0.9);
@@ -98,67 +138,105 @@ static void BM_Mixed_HotCold(benchmark::State& state) {
     }
 }
 
+// One store shared by all threads of a multi-threaded benchmark. Thread 0
+// builds it before the timed loop and drops it afterwards; the loop starts
+// and ends with a barrier across threads, so the others only see it in between.
+static std::unique_ptr<KVStore> shared_store;
+
+static void fill_shared_store(benchmark::State& state, const std::vector<std::string>& keys) {
+    if (state.thread_index() != 0)
+        return;
+    shared_store = std::make_unique<KVStore>();
+    for (const auto& key : keys)
+        shared_store->put(key, "val");
+}
+
+static void drop_shared_store(benchmark::State& state) {
+    if (state.thread_index() == 0)
+        shared_store.reset();
+}
+
+// Arg "get_into": 0 = locked get(), 1 = optimistic get_into().
+static void read_value(KVStore& store, std::string_view key, bool optimistic) {
+    if (optimistic) {
+        char buffer[64];
+        benchmark::DoNotOptimize(store.get_into(key, std::span<char>(buffer)));
+        benchmark::ClobberMemory();
+    } else {
+        benchmark::DoNotOptimize(store.get(key));
+    }
+}
+
+// Uniform key indices in [0, n), drawn before the timed loop so that it
+// measures the store rather than the RNG. The length is a power of two.
+static std::vector<uint32_t> uniform_trace(size_t n, uint64_t seed) {
+    UniformGenerator keys(n);
+    std::mt19937_64 rng(seed);
+    std::vector<uint32_t> trace(1 << 16);
+    for (auto& key : trace)
+        key = static_cast<uint32_t>(keys(rng));
+    return trace;
+}
+
 static void BM_Get_ParallelReaders(benchmark::State& state) {
     const size_t hot_size = 256;
+    const bool optimistic = state.range(0) != 0;
     auto hot_keys = generate_keys(hot_size);
+    fill_shared_store(state, hot_keys);
 
-    KVStore store;
-    for (const auto& key : hot_keys)
-        store.put(key, "val");
-
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<size_t> dist(0, hot_size - 1);
+    auto trace = uniform_trace(hot_size, state.thread_index() + 1);
 
+    size_t i = 0;
     for (auto _ : state) {
-        const std::string& key = hot_keys[dist(rng)];
-        benchmark::DoNotOptimize(store.get(key));
+        read_value(*shared_store, hot_keys[trace[i]], optimistic);
+        i = (i + 1) & (trace.size() - 1);
     }
+    drop_shared_store(state);
 }
 
 
 
 static void BM_Concurrent_ReadWrite(benchmark::State& state) {
     const size_t hot_size = 512;
+    const bool optimistic = state.range(0) != 0;
     auto hot_keys = generate_keys(hot_size);
     auto write_keys = generate_keys(10000);
+    fill_shared_store(state, hot_keys);
 
-    KVStore store;
-    for (const auto& key : hot_keys)
-        store.put(key, "val");
-
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<size_t> hot_dist(0, hot_size - 1);
-    std::uniform_int_distribution<size_t> write_dist(0, write_keys.size() - 1);
+    const bool writer = state.thread_index() == 0;
+    auto trace = uniform_trace(writer ? write_keys.size() : hot_size, state.thread_index() + 1);
 
+    size_t i = 0;
     for (auto _ : state) {
-        if (state.thread_index() == 0) {
-            // Writer
-            store.put(write_keys[write_dist(rng)], "val");
+        if (writer) {
+            shared_store->put(write_keys[trace[i]], "val");
         } else {
-            // Readers
-            benchmark::DoNotOptimize(store.get(hot_keys[hot_dist(rng)]));
+            read_value(*shared_store, hot_keys[trace[i]], optimistic);
         }
+        i = (i + 1) & (trace.size() - 1);
     }
+    drop_shared_store(state);
 }
 
 static void BM_Write_Heavy_Parallel(benchmark::State& state) {
     auto keys = generate_keys(10000);
-    KVStore store;
+    fill_shared_store(state, {});
 
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<size_t> dist(0, keys.size() - 1);
+    auto trace = uniform_trace(keys.size(), state.thread_index() + 1);
 
+    size_t i = 0;
     for (auto _ : state) {
-        store.put(keys[dist(rng)], "val");
+        shared_store->put(keys[trace[i]], "val");
+        i = (i + 1) & (trace.size() - 1);
     }
+    drop_shared_store(state);
 }
 
 static void BM_ReadMostly_SharedStore(benchmark::State& state) {
+    const bool optimistic = state.range(0) != 0;
     auto hot_keys = generate_keys(CAPACITY);
     auto write_keys = generate_keys(10000);
-    KVStore store;
-
-    for (auto& key : hot_keys) store.put(key, "val");
+    fill_shared_store(state, hot_keys);
 
     std::mt19937 rng(std::random_device{}());
     std::uniform_real_distribution<> prob(0.0, 1.0);
@@ -167,25 +245,852 @@ static void BM_ReadMostly_SharedStore(benchmark::State& state) {
 
     for (auto _ : state) {
         if (prob(rng) < 0.05) {
-            store.put(write_keys[write_dist(rng)], "val");
+            shared_store->put(write_keys[write_dist(rng)], "val");
+        } else {
+            read_value(*shared_store, hot_keys[read_dist(rng)], optimistic);
+        }
+    }
+    drop_shared_store(state);
+}
+
+// Benchmark: cache-aside over a Zipfian key stream. Each thread reads with
+// get_into() and puts the key on a miss. Args: promote (0 = FIFO, i.e.
+// Options::promote_on_read off; 1 = buffered LRU promotion) and theta x 100.
+// 100K distinct keys against a 10K-entry store.
+static void BM_CacheAside_Zipf(benchmark::State& state) {
+    const bool promote = state.range(0) != 0;
+    const double theta = static_cast<double>(state.range(1)) / 100.0;
+    const size_t key_space = 100'000;
+    KeySet keys(key_space);
+
+    if (state.thread_index() == 0) {
+        Options options = options_for(key_space / 10);
+        options.promote_on_read = promote;
+        shared_store = std::make_unique<KVStore>(options);
+    }
+
+    // Ranks are drawn up front so the timed loop measures the store, not pow().
+    ZipfianGenerator zipf(key_space, theta);
+    std::mt19937_64 rng(state.thread_index() + 1);
+    std::vector<uint32_t> trace(1 << 20);
+    for (auto& rank : trace)
+        rank = static_cast<uint32_t>(zipf(rng));
+
+    // The first pass over the trace only warms the store; hits are counted
+    // from the second pass on so the ratio reflects steady state.
+    std::string value;
+    size_t hits = 0;
+    size_t reads = 0;
+    size_t i = 0;
+    bool warm = false;
+    for (auto _ : state) {
+        auto key = keys[trace[i]];
+        bool hit = shared_store->get_into(key, value);
+        if (!hit)
+            shared_store->put(key, "val");
+        if (warm) {
+            hits += hit;
+            ++reads;
+        }
+        if (++i == trace.size()) {
+            i = 0;
+            warm = true;
+        }
+    }
+    if (reads == 0)
+        reads = 1;
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hit_ratio"] = benchmark::Counter(static_cast<double>(hits) / static_cast<double>(reads),
+                                                     benchmark::Counter::kAvgThreads);
+    drop_shared_store(state);
+}
+
+// Benchmark: one eviction policy under cache-aside traffic, as in
+// BM_CacheAside_Zipf (Zipfian 0.99 over 100K keys, 10K-entry store). Arg
+// "scan" = 1 replaces every third request with the next key of a sequential
+// scan over 1M keys that are never requested again, the pattern that flushes
+// hot keys out of a plain LRU. Arg "tinylfu" = 1 puts the W-TinyLFU admission
+// filter in front of the policy.
+template <typename Store>
+static void BM_Policy(benchmark::State& state) {
+    const bool scans = state.range(0) != 0;
+    const bool tinylfu = state.range(1) != 0;
+    const size_t key_space = 100'000;
+    const size_t scan_space = 1'000'000;
+    static const KeySet keys(key_space + scan_space);
+    static std::unique_ptr<Store> store;
+
+    if (state.thread_index() == 0) {
+        Options options = options_for(key_space / 10);
+        options.admission = tinylfu ? Admission::TinyLfu : Admission::Always;
+        store = std::make_unique<Store>(options);
+    }
+
+    ZipfianGenerator zipf(key_space, 0.99);
+    std::mt19937_64 rng(state.thread_index() + 1);
+    std::vector<uint32_t> trace(1 << 20);
+    size_t scan_pos = key_space + state.thread_index() * (scan_space / 4);
+    for (size_t i = 0; i < trace.size(); ++i) {
+        if (scans && i % 3 == 2) {
+            trace[i] = static_cast<uint32_t>(scan_pos);
+            if (++scan_pos == key_space + scan_space)
+                scan_pos = key_space;
+        } else {
+            trace[i] = static_cast<uint32_t>(zipf(rng));
+        }
+    }
+
+    std::string value;
+    size_t hits = 0;
+    size_t reads = 0;
+    size_t i = 0;
+    bool warm = false;
+    for (auto _ : state) {
+        auto key = keys[trace[i]];
+        bool hit = store->get_into(key, value);
+        if (!hit)
+            store->put(key, "val");
+        if (warm && trace[i] < key_space) {
+            hits += hit;
+            ++reads;
+        }
+        if (++i == trace.size()) {
+            i = 0;
+            warm = true;
+        }
+    }
+    if (reads == 0)
+        reads = 1;
+    state.SetItemsProcessed(state.iterations());
+    // Hit ratio of the Zipfian requests only; scan keys always miss.
+    state.counters["hit_ratio"] = benchmark::Counter(static_cast<double>(hits) / static_cast<double>(reads),
+                                                     benchmark::Counter::kAvgThreads);
+    if (state.thread_index() == 0) {
+        state.counters["admission_bytes_per_entry"] =
+            static_cast<double>(store->memory_usage().admission_bytes) / static_cast<double>(store->capacity());
+        store.reset();
+    }
+}
+
+// Benchmark: one shard lock under oversubscription. All threads share a
+// single-shard LRU store of 1K keys and do 95% locked get() and 5% put(), so
+// every operation takes the same lock. Run with up to 8x as many threads as
+// cores; spins and sleeps per operation come from lock_counters().
+template <typename Store>
+static void BM_ShardLock(benchmark::State& state) {
+    static std::unique_ptr<Store> store;
+    static const KeySet keys(1024);
+    if (state.thread_index() == 0) {
+        Options options = options_for(keys.size());
+        options.num_shards = 1;
+        store = std::make_unique<Store>(options);
+        for (size_t i = 0; i < keys.size(); ++i)
+            store->put(keys[i], "val");
+    }
+
+    std::mt19937 rng(state.thread_index() + 1);
+    std::uniform_int_distribution<size_t> dist(0, keys.size() - 1);
+    size_t sink = 0;
+    for (auto _ : state) {
+        auto key = keys[dist(rng)];
+        if (rng() % 20 == 0) {
+            store->put(key, "val");
+        } else {
+            auto value = store->get(key);
+            sink += value ? value->size() : 0;
+        }
+    }
+    benchmark::DoNotOptimize(sink);
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        LockCounters counters = store->lock_counters();
+        auto ops = static_cast<double>(state.iterations() * state.threads());
+        state.counters["spins_per_op"] = static_cast<double>(counters.spins) / ops;
+        state.counters["sleeps_per_op"] = static_cast<double>(counters.sleeps) / ops;
+        store.reset();
+    }
+}
+
+// Benchmark: batched lookups against a loop of single-key calls. 100K keys
+// in a default-sharded store big enough to hold them all; each iteration
+// looks up `batch` random keys. Arg "api": 0 = loop over get_into(), 1 =
+// multi_get(). Items are keys, so items_per_second compares directly.
+static void BM_MultiGet(benchmark::State& state) {
+    const size_t batch = state.range(0);
+    const bool batched = state.range(1) != 0;
+    const size_t key_space = 100'000;
+    static const KeySet keys(key_space);
+    KVStore store(options_for(key_space));
+    for (size_t i = 0; i < key_space; ++i)
+        store.put(keys[i], "value_0123456789");
+
+    // Requests are consecutive windows of a pre-drawn random trace.
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> dist(0, key_space - 1);
+    std::vector<std::string_view> trace(1 << 16);
+    for (auto& key : trace)
+        key = keys[dist(rng)];
+    std::vector<std::optional<std::string>> values(batch);
+    std::string value;
+
+    size_t pos = 0;
+    for (auto _ : state) {
+        std::span<const std::string_view> request(trace.data() + pos, batch);
+        if (batched) {
+            benchmark::DoNotOptimize(store.multi_get(request, values));
+        } else {
+            for (auto key : request)
+                benchmark::DoNotOptimize(store.get_into(key, value));
+        }
+        pos = pos + 2 * batch > trace.size() ? 0 : pos + batch;
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+// Benchmark: batched overwrites against a loop of put(), as BM_MultiGet.
+static void BM_MultiPut(benchmark::State& state) {
+    const size_t batch = state.range(0);
+    const bool batched = state.range(1) != 0;
+    const size_t key_space = 100'000;
+    static const KeySet keys(key_space);
+    KVStore store(options_for(key_space));
+    for (size_t i = 0; i < key_space; ++i)
+        store.put(keys[i], "value_0123456789");
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> dist(0, key_space - 1);
+    std::vector<std::pair<std::string_view, std::string_view>> trace(1 << 16);
+    for (auto& entry : trace)
+        entry = {keys[dist(rng)], "value_9876543210"};
+
+    size_t pos = 0;
+    for (auto _ : state) {
+        std::span<const std::pair<std::string_view, std::string_view>> request(trace.data() + pos, batch);
+        if (batched) {
+            benchmark::DoNotOptimize(store.multi_put(request));
+        } else {
+            for (auto [key, value] : request)
+                benchmark::DoNotOptimize(store.put(key, value));
+        }
+        pos = pos + 2 * batch > trace.size() ? 0 : pos + batch;
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+// Benchmark: interleaved lookups against a table far larger than the cache.
+// One 8M-entry store (several times the LLC, built once and shared by every
+// run) answers batches of 256 random keys. Arg "depth": 0 = loop over
+// get_into(), otherwise lookup_many() with that many lookups in flight.
+static void BM_LookupMany(benchmark::State& state) {
+    const size_t depth = state.range(0);
+    const size_t key_space = 8'000'000;
+    const size_t batch = 256;
+    static const KeySet keys(key_space);
+    static std::unique_ptr<KVStore> store;
+    if (!store) {
+        Options options = options_for(key_space);
+        options.memory_budget = key_space * 32;
+        store = std::make_unique<KVStore>(options);
+        for (size_t i = 0; i < key_space; ++i)
+            store->put(keys[i], "value_01");
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> dist(0, key_space - 1);
+    std::vector<std::string_view> trace(1 << 16);
+    for (auto& key : trace)
+        key = keys[dist(rng)];
+    std::vector<std::optional<std::string>> values(batch);
+    std::string value;
+
+    size_t pos = 0;
+    size_t hits = 0;
+    for (auto _ : state) {
+        std::span<const std::string_view> request(trace.data() + pos, batch);
+        if (depth == 0) {
+            for (auto key : request)
+                hits += store->get_into(key, value);
+        } else {
+            hits += store->lookup_many(request, values, depth);
+        }
+        pos = pos + 2 * batch > trace.size() ? 0 : pos + batch;
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.counters["hit_ratio"] = static_cast<double>(hits) / static_cast<double>(state.iterations() * batch);
+}
+
+// Benchmark: the hash function alone, over 1024 keys of state.range(0)
+// bytes each (distinct, so the loop cannot be folded).
+template <typename Hasher>
+static void BM_Hash(benchmark::State& state) {
+    const size_t length = state.range(0);
+    std::vector<std::string> keys(1024, std::string(length, 'k'));
+    for (size_t i = 0; i < keys.size(); ++i)
+        for (size_t b = 0; b < std::min<size_t>(length, 2); ++b)
+            keys[i][b] = static_cast<char>(i >> (8 * b));
+
+    Hasher hash;
+    for (auto _ : state) {
+        for (const auto& key : keys)
+            benchmark::DoNotOptimize(hash(key));
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+    state.SetBytesProcessed(state.iterations() * keys.size() * length);
+}
+
+// Benchmark: BM_Get_HotHit per hasher, hashing each key on every call
+// (prehashed = 0) or once up front (prehashed = 1).
+template <typename Store>
+static void BM_Get_HotHit_Hasher(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    const bool prehashed = state.range(1) != 0;
+    KeySet keys(capacity);
+    Store store(options_for(capacity));
+    std::vector<HashedKey> hashed(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        store.put(keys[i], "val");
+        hashed[i] = Store::prehash(keys[i]);
+    }
+
+    for (auto _ : state) {
+        if (prehashed) {
+            for (const auto& key : hashed)
+                benchmark::DoNotOptimize(store.get(key));
+        } else {
+            for (size_t i = 0; i < keys.size(); ++i)
+                benchmark::DoNotOptimize(store.get(keys[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Benchmark: the cost of statistics, ShardStats against NoStats. op = 0
+// get_into() hits, 1 get_into() misses, 2 puts cycling through twice the
+// capacity (every put evicts). Threads share one 4K-entry store, small
+// enough to stay in cache, so the counters' cost is not hidden behind cache
+// misses. With several threads, each counts into its own stripe.
+template <typename Store>
+static void BM_Stats(benchmark::State& state) {
+    static std::unique_ptr<Store> store;
+    const int op = static_cast<int>(state.range(0));
+    const size_t capacity = 1 << 12;
+    static KeySet keys(capacity * 2);
+    if (state.thread_index() == 0) {
+        store = std::make_unique<Store>(options_for(capacity));
+        for (size_t i = 0; i < capacity; ++i)
+            store->put(keys[i], "val");
+    }
+
+    char buffer[64];
+    size_t i = state.thread_index() * 4099;
+    for (auto _ : state) {
+        if (op == 0)
+            benchmark::DoNotOptimize(store->get_into(keys[i % capacity], std::span<char>(buffer)));
+        else if (op == 1)
+            benchmark::DoNotOptimize(store->get_into(keys[capacity + i % capacity], std::span<char>(buffer)));
+        else
+            benchmark::DoNotOptimize(store->put(keys[i % keys.size()], "val"));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0)
+        store.reset();
+}
+
+// Benchmark: the cost of TTL bookkeeping on the hot path. ttl = 0 is a store
+// without Options::expiry, 1 has it but puts without a TTL, 2 gives every
+// entry an hour's TTL (so nothing expires; every hit reads the clock and
+// every insert schedules a timer). op = 0 get() hits, 1 get_into() hits,
+// 2 puts cycling through twice the capacity (every put evicts).
+// Reads from a store well past the LLC with its memory placed by
+// NumaPlacement (0 = first touch, 1 = interleaved, 2 = per shard). Thread t
+// runs on node t % nodes. With affine=1 it reads only keys whose shard
+// belongs to its node (under the per-shard spread, whatever the placement),
+// so per-shard placement keeps every access local; with affine=0 it reads
+// any key. On a single-node machine the placements are the same store.
+static void BM_NumaPlacement(benchmark::State& state) {
+    static std::unique_ptr<KVStore> store;
+    const auto placement = static_cast<NumaPlacement>(state.range(0));
+    const bool affine = state.range(1) != 0;
+    const size_t capacity = 1 << 20;
+    const size_t num_shards = 16;
+    static KeySet keys(capacity);
+    if (state.thread_index() == 0) {
+        Options options = options_for(capacity);
+        options.num_shards = num_shards;
+        options.numa = placement;
+        store = std::make_unique<KVStore>(options);
+        for (size_t i = 0; i < capacity; ++i)
+            store->put(keys[i], "val");
+    }
+
+    const size_t nodes = numa_node_count();
+    const int node = static_cast<int>(state.thread_index() % nodes);
+    numa_run_on_node(node);
+    // Thread 0 may still be filling `store`; a store's shard_of() depends
+    // only on the shard count, so a tiny one routes the keys meanwhile.
+    Options routing;
+    routing.capacity = num_shards;
+    routing.num_shards = num_shards;
+    KVStore router(routing);
+    std::vector<uint32_t> local;
+    for (size_t i = 0; i < capacity; ++i) {
+        size_t shard = router.shard_of(keys[i]);
+        if (!affine || shard * nodes / num_shards == static_cast<size_t>(node))
+            local.push_back(static_cast<uint32_t>(i));
+    }
+    auto trace = uniform_trace(local.size(), state.thread_index() + 1);
+
+    char buffer[64];
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(store->get_into(keys[local[trace[i]]], std::span<char>(buffer)));
+        i = (i + 1) & (trace.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0)
+        store.reset();
+}
+
+static void BM_Ttl(benchmark::State& state) {
+    using namespace std::chrono_literals;
+    const int ttl = static_cast<int>(state.range(0));
+    const int op = static_cast<int>(state.range(1));
+    const size_t capacity = 1 << 12;
+    KeySet keys(op == 2 ? capacity * 2 : capacity);
+
+    Options options = options_for(capacity);
+    options.expiry = ttl > 0;
+    KVStore store(options);
+    auto put = [&](std::string_view key) { return ttl == 2 ? store.put(key, "val", 1h) : store.put(key, "val"); };
+    for (size_t i = 0; i < capacity; ++i)
+        put(keys[i]);
+
+    std::string out;
+    size_t i = 0;
+    for (auto _ : state) {
+        if (op == 0)
+            benchmark::DoNotOptimize(store.get(keys[i]));
+        else if (op == 1)
+            benchmark::DoNotOptimize(store.get_into(keys[i], out));
+        else
+            benchmark::DoNotOptimize(put(keys[i]));
+        if (++i == keys.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Benchmark: warm restart of a full store with 1M entries of ~100 bytes
+// across 8 shards. mode = 0 builds a new store by putting every entry again
+// (a restart without a snapshot, data already in memory), 1 loads a
+// snapshot (one mapping plus the index validation), 2 loads it and reads
+// every value once (paging the file in), 3 writes the snapshot. The file
+// sits in the page cache throughout, so this is CPU cost, not disk.
+static void BM_WarmRestart(benchmark::State& state) {
+    const int mode = static_cast<int>(state.range(0));
+    const size_t entries = state.range(1);
+    KeySet keys(entries);
+    const std::string value(88, 'v');
+    const std::string path = "/tmp/kvstore_bench_" + std::to_string(entries) + ".snap";
+
+    Options options = options_for(entries);
+    options.memory_budget = entries * 128;
+    KVStore source(options);
+    for (size_t i = 0; i < entries; ++i)
+        source.put(keys[i], value);
+    source.snapshot(path);
+
+    std::string out;
+    for (auto _ : state) {
+        if (mode == 0) {
+            KVStore store(options);
+            for (size_t i = 0; i < entries; ++i)
+                store.put(keys[i], value);
+            benchmark::DoNotOptimize(store.size());
+        } else if (mode == 1 || mode == 2) {
+            auto store = KVStore::load(path);
+            for (size_t i = 0; mode == 2 && i < entries; ++i)
+                benchmark::DoNotOptimize(store->get_into(keys[i], out));
+            benchmark::DoNotOptimize(store->size());
         } else {
-            benchmark::DoNotOptimize(store.get(hot_keys[read_dist(rng)]));
+            source.snapshot(path);
+        }
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * entries);
+}
+
+// Benchmark: put() throughput in durable mode against a log file in /tmp
+// (ext4 on the VM's virtual disk). Args: wal_commit_interval in ms (0 = a
+// volatile store, the baseline) and wal_commit_bytes in KB. 64K keys of
+// 100-byte values cycle through a 64K-entry store; the timed loop ends
+// with sync(), so every put counted is on disk.
+static void BM_WalPut(benchmark::State& state) {
+    const auto interval = std::chrono::milliseconds(state.range(0));
+    const size_t commit_bytes = state.range(1) * 1024;
+    const size_t capacity = 1 << 16;
+    KeySet keys(capacity);
+    const std::string value(96, 'v');
+    const std::string path = "/tmp/kvstore_bench.wal";
+    std::remove(path.c_str());
+    std::remove((path + ".snap").c_str());
+
+    Options options = options_for(capacity);
+    if (interval.count() > 0) {
+        options.wal_path = path;
+        options.wal_commit_interval = interval;
+        options.wal_commit_bytes = commit_bytes;
+    }
+    {
+        KVStore store(options);
+        size_t i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(store.put(keys[i], value));
+            if (++i == keys.size()) i = 0;
+        }
+        if (interval.count() > 0)
+            store.sync();
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".snap").c_str());
+    state.SetItemsProcessed(state.iterations());
+}
+
+// Benchmark: a read-mostly mix (90% get_into, 10% put of 64-byte values
+// over the 64K keys of a full 64K-entry store) from `workers` threads of
+// one process on a private store (shared = 0), or from `workers` forked
+// processes on a store in a shared memory segment (shared = 1). Each
+// iteration starts the workers, OPS operations each, and waits for them
+// all, so thread and process start-up are part of the time.
+static void BM_MultiProcess(benchmark::State& state) {
+    using Store = BasicKVStore<LruPolicy, AdaptiveLock>;
+    const int workers = static_cast<int>(state.range(0));
+    const bool shared = state.range(1) != 0;
+    constexpr size_t OPS = 1 << 18;
+    const size_t capacity = 1 << 16;
+    KeySet keys(capacity);
+    const std::string value(64, 'v');
+
+    Options options = options_for(capacity);
+    if (shared) {
+        options.shared_name = "kvstore_bench_" + std::to_string(::getpid());
+        SharedSegment::unlink(options.shared_name);
+    }
+    {
+        Store store(options);
+        for (size_t i = 0; i < capacity; ++i)
+            store.put(keys[i], value);
+
+        auto work = [&](uint64_t seed) {
+            std::mt19937_64 rng(seed);
+            std::string out;
+            for (size_t op = 0; op < OPS; ++op) {
+                uint64_t r = rng();
+                if (r % 10 == 0)
+                    store.put(keys[(r >> 8) % capacity], value);
+                else
+                    benchmark::DoNotOptimize(store.get_into(keys[(r >> 8) % capacity], out));
+            }
+        };
+        for (auto _ : state) {
+            if (shared) {
+                // Children inherit the mapping, and with it the store.
+                std::vector<pid_t> children;
+                for (int w = 0; w < workers; ++w) {
+                    pid_t child = ::fork();
+                    if (child == 0) {
+                        work(w + 1);
+                        std::_Exit(0);
+                    }
+                    children.push_back(child);
+                }
+                for (pid_t child : children)
+                    ::waitpid(child, nullptr, 0);
+            } else {
+                std::vector<std::jthread> threads;
+                for (int w = 0; w < workers; ++w)
+                    threads.emplace_back(work, w + 1);
+            }
         }
     }
+    if (shared)
+        SharedSegment::unlink(options.shared_name);
+    state.SetItemsProcessed(state.iterations() * workers * OPS);
 }
 
+// Benchmark: probe-length distribution of a full table, then after 10x churn
+// (every put evicts). Reported as counters; the timed part is the lookup of
+// every live key plus one never-inserted key per live key.
+static void BM_ProbeLength(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    KeySet keys(capacity * 2);
+    KeySet missing(capacity, capacity * 2);
+    KVStore store(options_for(capacity));
 
+    for (size_t i = 0; i < capacity * 10; ++i) {
+        store.put(keys[i % keys.size()], "val");
+    }
 
+    for (auto _ : state) {
+        for (size_t i = 0; i < capacity; ++i) {
+            benchmark::DoNotOptimize(store.get(keys[i]));
+            benchmark::DoNotOptimize(store.get(missing[i]));
+        }
+    }
+
+    auto histogram = store.probe_histogram();
+    state.counters["hit_mean"] = ProbeHistogram::mean(histogram.hit);
+    state.counters["hit_p99"] = ProbeHistogram::percentile(histogram.hit, 0.99);
+    state.counters["hit_max"] = histogram.max_hit;
+    state.counters["miss_mean"] = ProbeHistogram::mean(histogram.miss);
+    state.counters["miss_p99"] = ProbeHistogram::percentile(histogram.miss, 0.99);
+    state.counters["miss_max"] = histogram.max_miss;
+    state.SetItemsProcessed(state.iterations() * capacity * 2);
+}
+
+// Benchmark: get() hits and misses on a full store through each control-byte
+// kernel. Args: {capacity, simd (1) or scalar (0)}.
+static void BM_Get_ProbeKernel_Hit(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    const auto kernel = state.range(1) ? ProbeKernel::Simd : ProbeKernel::Scalar;
+    KeySet keys(capacity);
+    KVStore store(options_for(capacity, kernel));
+    for (size_t i = 0; i < keys.size(); ++i) store.put(keys[i], "val");
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            benchmark::DoNotOptimize(store.get(keys[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+static void BM_Get_ProbeKernel_Miss(benchmark::State& state) {
+    const size_t capacity = state.range(0);
+    const auto kernel = state.range(1) ? ProbeKernel::Simd : ProbeKernel::Scalar;
+    KeySet keys(capacity);
+    KeySet missing(capacity, capacity);
+    KVStore store(options_for(capacity, kernel));
+    for (size_t i = 0; i < keys.size(); ++i) store.put(keys[i], "val");
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < missing.size(); ++i) {
+            benchmark::DoNotOptimize(store.get(missing[i]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * missing.size());
+}
+
+static void ProbeKernels(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"capacity", "simd"});
+    for (int64_t capacity : {1 << 10, 1 << 20, 1 << 24}) {
+        b->Args({capacity, 1});
+        b->Args({capacity, 0});
+    }
+}
+
+// The old fixed layout: a 128-byte Node (32-byte key, 64-byte value, key_len,
+// prev, next, hash), a 24-byte bucket and a used flag, whatever the value size.
+// Values over 63 bytes did not fit at all.
+constexpr size_t FIXED_NODE_BYTES_PER_ENTRY = 128 + 24 + 1;
+constexpr size_t FIXED_NODE_MAX_VALUE = 63;
+
+// Benchmark: memory per entry for a store filled with values of one size.
+// Arg: value size in bytes.
+static void BM_Memory_PerEntry(benchmark::State& state) {
+    const size_t value_size = state.range(0);
+    const size_t entries = 1 << 16;
+    KeySet keys(entries);
+    std::string value(value_size, 'v');
+
+    Options options;
+    options.capacity = entries;
+    options.memory_budget = entries * (value_size + 32) * 2;
+
+    MemoryUsage usage;
+    for (auto _ : state) {
+        KVStore store(options);
+        for (size_t i = 0; i < entries; ++i) {
+            store.put(keys[i], value);
+        }
+        usage = store.memory_usage();
+    }
+
+    double n = static_cast<double>(usage.entries);
+    state.counters["bytes_per_entry"] = (usage.index_bytes + usage.data_bytes_used) / n;
+    state.counters["payload_per_entry"] = usage.payload_bytes / n;
+    state.counters["fixed_bytes_per_entry"] =
+        value_size <= FIXED_NODE_MAX_VALUE ? FIXED_NODE_BYTES_PER_ENTRY : 0;
+    state.SetItemsProcessed(state.iterations() * entries);
+}
+
+// Benchmark: put throughput with eviction for one value size. The budget fits
+// about 64K entries of that size. Arg: value size in bytes.
+static void BM_Put_ValueSize(benchmark::State& state) {
+    const size_t value_size = state.range(0);
+    const size_t entries = 1 << 16;
+    KeySet keys(entries * 4);
+    std::string value(value_size, 'v');
+
+    Options options;
+    options.capacity = entries;
+    options.memory_budget = entries * (value_size + 16);
+    KVStore store(options);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        store.put(keys[i], value);
+        if (++i == keys.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * value_size);
+}
+
+// Benchmark: reading a value and summing its bytes, by copy (get_into into a
+// reused buffer) versus zero-copy (pin). The sum stands in for a consumer that
+// touches every byte, which either path has to pay for.
+static void read_by_value_size(benchmark::State& state, bool zero_copy) {
+    const size_t value_size = state.range(0);
+    const size_t entries = 1 << 10;
+    KeySet keys(entries);
+    KVStore store(options_for(entries * 2));
+    for (size_t i = 0; i < entries; ++i)
+        store.put(keys[i], std::string(value_size, 'v'));
+
+    std::string buffer;
+    size_t i = 0;
+    for (auto _ : state) {
+        uint64_t sum = 0;
+        if (zero_copy) {
+            ValueHandle handle = store.pin(keys[i]);
+            for (char c : handle.value()) sum += static_cast<unsigned char>(c);
+        } else {
+            store.get_into(keys[i], buffer);
+            for (char c : buffer) sum += static_cast<unsigned char>(c);
+        }
+        benchmark::DoNotOptimize(sum);
+        if (++i == entries) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * value_size);
+}
+
+// Benchmark: a contended counter. Every thread increments one of `counters`
+// keys, picked at random. api = 0 reads it with get_into() and writes it
+// back with put(): two lock holds, two hashes, two probes, and increments
+// lost whenever another thread's write lands in between. api = 1 is incr():
+// one of each. "lost" is the fraction of increments missing at the end.
+static void BM_Counter(benchmark::State& state) {
+    static std::unique_ptr<KVStore> store;
+    const bool atomic = state.range(0) != 0;
+    const size_t counters = state.range(1);
+    static KeySet keys(64);
+    if (state.thread_index() == 0) {
+        store = std::make_unique<KVStore>(options_for(1024));
+        for (size_t i = 0; i < keys.size(); ++i)
+            store->put(keys[i], "0");
+    }
+
+    std::mt19937 rng(state.thread_index() + 1);
+    char buffer[24];
+    for (auto _ : state) {
+        HashedKey key = KVStore::prehash(keys[rng() % counters]);
+        if (atomic) {
+            uint64_t result = 0;
+            store->incr(key, 1, result);
+        } else {
+            auto size = store->get_into(key, std::span<char>(buffer));
+            uint64_t value = 0;
+            std::from_chars(buffer, buffer + size.value_or(0), value);
+            char* end = std::to_chars(buffer, buffer + sizeof(buffer), value + 1).ptr;
+            store->put(key, std::string_view(buffer, end - buffer));
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        uint64_t total = 0;
+        std::string value;
+        for (size_t i = 0; i < counters; ++i) {
+            store->get_into(keys[i], value);
+            total += std::stoull(value);
+        }
+        auto expected = static_cast<double>(state.iterations() * state.threads());
+        state.counters["lost"] = 1.0 - static_cast<double>(total) / expected;
+        store.reset();
+    }
+}
+
+static void BM_Read_Copy(benchmark::State& state) { read_by_value_size(state, false); }
+static void BM_Read_Pinned(benchmark::State& state) { read_by_value_size(state, true); }
+
+static void ValueSizes(benchmark::internal::Benchmark* b) {
+    b->ArgName("value_size");
+    for (int64_t size : {3, 16, 64, 256, 1024, 4096})
+        b->Arg(size);
+}
+
+
+// Store sizes: 1K (fits in L1/L2), 1M and 16M entries (well past the LLC).
+static void StoreSizes(benchmark::internal::Benchmark* b) {
+    b->ArgName("capacity")->Arg(1 << 10)->Arg(1 << 20)->Arg(1 << 24);
+}
 
-BENCHMARK(BM_Insert_NoEvict)->UseRealTime();
-BENCHMARK(BM_Insert_WithEvict)->UseRealTime();
-BENCHMARK(BM_Get_HotHit)->UseRealTime();
-BENCHMARK(BM_Get_ColdMiss)->UseRealTime();
-BENCHMARK(BM_Mixed_HotCold)->UseRealTime();
-BENCHMARK(BM_Get_ParallelReaders)->Threads(8)->UseRealTime();
-BENCHMARK(BM_Concurrent_ReadWrite)->Threads(5)->UseRealTime();
+BENCHMARK(BM_Insert_NoEvict)->Apply(StoreSizes)->UseRealTime();
+BENCHMARK(BM_Insert_WithEvict)->Apply(StoreSizes)->UseRealTime();
+BENCHMARK(BM_Get_HotHit)->Apply(StoreSizes)->UseRealTime();
+BENCHMARK(BM_Get_ColdMiss)->Apply(StoreSizes)->UseRealTime();
+BENCHMARK(BM_Mixed_HotCold)->Apply(StoreSizes)->UseRealTime();
+BENCHMARK(BM_Get_ProbeKernel_Hit)->Apply(ProbeKernels)->UseRealTime();
+BENCHMARK(BM_Get_ProbeKernel_Miss)->Apply(ProbeKernels)->UseRealTime();
+BENCHMARK(BM_Memory_PerEntry)->Apply(ValueSizes)->Iterations(1);
+BENCHMARK(BM_Put_ValueSize)->Apply(ValueSizes)->UseRealTime();
+BENCHMARK(BM_Read_Copy)->Apply(ValueSizes)->UseRealTime();
+BENCHMARK(BM_Read_Pinned)->Apply(ValueSizes)->UseRealTime();
+BENCHMARK(BM_ProbeLength)->ArgName("capacity")->Arg(1 << 10)->Arg(1 << 20)->UseRealTime();
+BENCHMARK(BM_Get_ParallelReaders)->ArgName("get_into")->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Concurrent_ReadWrite)->ArgName("get_into")->Arg(0)->Arg(1)->Threads(5)->UseRealTime();
 BENCHMARK(BM_Write_Heavy_Parallel)->Threads(4)->UseRealTime();
-BENCHMARK(BM_ReadMostly_SharedStore)->Threads(8)->UseRealTime();
+BENCHMARK(BM_CacheAside_Zipf)->ArgNames({"promote", "theta"})
+    ->ArgsProduct({{0, 1}, {80, 99}})->ThreadRange(1, 4)->Iterations(3 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Policy, KVStore)->ArgNames({"scan", "tinylfu"})->ArgsProduct({{0, 1}, {0, 1}})
+    ->ThreadRange(1, 4)->Iterations(3 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Policy, ClockKVStore)->ArgNames({"scan", "tinylfu"})->ArgsProduct({{0, 1}, {0, 1}})
+    ->ThreadRange(1, 4)->Iterations(3 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Policy, SieveKVStore)->ArgNames({"scan", "tinylfu"})->ArgsProduct({{0, 1}, {0, 1}})
+    ->ThreadRange(1, 4)->Iterations(3 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Policy, S3FifoKVStore)->ArgNames({"scan", "tinylfu"})->ArgsProduct({{0, 1}, {0, 1}})
+    ->ThreadRange(1, 4)->Iterations(3 << 20)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShardLock, KVStore)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShardLock, BasicKVStore<LruPolicy, BackoffLock>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShardLock, BasicKVStore<LruPolicy, AdaptiveLock>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ShardLock, BasicKVStore<LruPolicy, SharedAdaptiveLock>)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_MultiGet)->ArgNames({"batch", "api"})->ArgsProduct({{1, 16, 256}, {0, 1}})->UseRealTime();
+BENCHMARK(BM_MultiPut)->ArgNames({"batch", "api"})->ArgsProduct({{1, 16, 256}, {0, 1}})->UseRealTime();
+BENCHMARK(BM_LookupMany)->ArgName("depth")->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->Arg(32)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Hash, WyHasher)->ArgName("bytes")->Arg(4)->Arg(8)->Arg(16)->Arg(32)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_Hash, FnvHasher)->ArgName("bytes")->Arg(4)->Arg(8)->Arg(16)->Arg(32)->Arg(64)->Arg(256);
+BENCHMARK_TEMPLATE(BM_Get_HotHit_Hasher, KVStore)->ArgNames({"capacity", "prehashed"})
+    ->ArgsProduct({{1 << 10, 1 << 20}, {0, 1}})->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Get_HotHit_Hasher, BasicKVStore<LruPolicy, SpinLock, FnvHasher>)
+    ->ArgNames({"capacity", "prehashed"})->ArgsProduct({{1 << 10, 1 << 20}, {0, 1}})->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Stats, KVStore)->ArgName("op")->Arg(0)->Arg(1)->Arg(2)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Stats, BasicKVStore<LruPolicy, SpinLock, WyHasher, NoStats>)->ArgName("op")
+    ->Arg(0)->Arg(1)->Arg(2)->ThreadRange(1, 4)->UseRealTime();
+BENCHMARK(BM_NumaPlacement)->ArgNames({"placement", "affine"})->ArgsProduct({{0, 1, 2}, {0, 1}})
+    ->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Ttl)->ArgNames({"ttl", "op"})->ArgsProduct({{0, 1, 2}, {0, 1, 2}})->UseRealTime();
+BENCHMARK(BM_WarmRestart)->ArgNames({"mode", "entries"})->ArgsProduct({{0, 1, 2, 3}, {1 << 20}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WalPut)->ArgNames({"interval_ms", "commit_kb"})
+    ->Args({0, 0})->ArgsProduct({{1, 10, 100}, {64, 1024, 16384}})->UseRealTime();
+BENCHMARK(BM_MultiProcess)->ArgNames({"workers", "shared"})->ArgsProduct({{1, 2, 4}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ReadMostly_SharedStore)->ArgName("get_into")->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_Counter)->ArgNames({"api", "counters"})->ArgsProduct({{0, 1}, {1, 64}})->ThreadRange(1, 8)
+    ->UseRealTime();
 
 
 BENCHMARK_MAIN();
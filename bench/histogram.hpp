@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Log-linear histogram in the style of HdrHistogram, for latencies in
+// nanoseconds. Values below 2^SUB_BITS get a bucket each; above that, every
+// power of two is split into 2^SUB_BITS equal buckets. A percentile is
+// therefore reported within 1 / 2^SUB_BITS (under 1%) of the true value,
+// and recording is one increment with no allocation. Each thread records
+// into its own histogram; merge() combines them after the run.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 7;
+
+    LatencyHistogram() : counts(BUCKETS) {}
+
+    void record(uint64_t value) {
+        ++counts[index(value)];
+        ++total;
+        sum += value;
+        max = std::max(max, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        max = std::max(max, other.max);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max_value() const { return max; }
+    double mean() const { return total == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(total); }
+
+    // The smallest recorded value that at least `percent` % of the values
+    // are at or below, rounded up to the top of its bucket.
+    uint64_t percentile(double percent) const {
+        if (total == 0)
+            return 0;
+        auto rank = static_cast<uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(total)));
+        rank = std::clamp<uint64_t>(rank, 1, total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(highest_in(i), max);
+        }
+        return max;
+    }
+
+private:
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    static size_t index(uint64_t value) {
+        if (value < SUB_BUCKETS)
+            return static_cast<size_t>(value);
+        unsigned shift = 63 - static_cast<unsigned>(__builtin_clzll(value)) - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+    }
+
+    static uint64_t highest_in(size_t index) {
+        size_t group = index >> SUB_BITS;
+        uint64_t sub = index & (SUB_BUCKETS - 1);
+        if (group == 0)
+            return sub;
+        unsigned shift = static_cast<unsigned>(group - 1);
+        return ((SUB_BUCKETS + sub) << shift) + ((uint64_t{1} << shift) - 1);
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+};
@@ -0,0 +1,303 @@
+// kvstore_latency: throughput, tail latency and hit ratio of KVStore under
+// YCSB-style workloads, as JSON on stdout.
+//
+//   kvstore_latency [--workload=a|b|c|f] [--distribution=zipfian|uniform|latest|hotspot|scan]
+//                   [--theta=0.99] [--records=N] [--capacity=N] [--value-size=N]
+//                   [--ops=N] [--threads=1,2,4,8]
+//
+// The store is used cache-aside: a read that misses puts the key, and its
+// latency includes that put. For each thread count, a fresh store is loaded
+// with the records in key order. Each thread draws two traces of --ops
+// requests up front from the same distribution: it replays the first to warm
+// the store, then the second, timing every request into a histogram of its
+// own. Replaying one trace twice would find all of its keys on the second
+// pass whenever it touches fewer distinct keys than the capacity.
+
+#include "histogram.hpp"
+#include "workload.hpp"
+#include "lru-kvstore/kv_store.hpp"
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace kvstore;
+
+namespace {
+    struct Config {
+        OperationMix mix = YCSB_WORKLOADS[0];
+        std::string distribution = "zipfian";
+        double theta = 0.99;
+        size_t records = 1'000'000;
+        size_t capacity = 100'000;
+        size_t value_size = 100;
+        size_t ops = 1'000'000;
+        std::vector<size_t> threads = {1, 2, 4, 8};
+        // Hotspot: this share of the requests goes to this share of the keys.
+        double hot_keys = 0.2;
+        double hot_ops = 0.8;
+        // Scan bursts: `scan_length` scan keys after every `scan_period`
+        // Zipfian ones; each thread scans its own `capacity` keys.
+        size_t scan_period = 900;
+        size_t scan_length = 100;
+    };
+
+    constexpr const char* OPERATION_NAMES[] = {"read", "update", "read_modify_write"};
+    constexpr size_t OPERATIONS = 3;
+
+    struct ThreadResult {
+        LatencyHistogram all;
+        LatencyHistogram by_op[OPERATIONS];
+        uint64_t reads = 0;
+        uint64_t hits = 0;
+    };
+
+    [[noreturn]] void usage(const char* error) {
+        std::fprintf(stderr,
+                     "kvstore_latency: %s\n"
+                     "usage: kvstore_latency [--workload=a|b|c|f] "
+                     "[--distribution=zipfian|uniform|latest|hotspot|scan]\n"
+                     "                       [--theta=0.99] [--records=N] [--capacity=N] [--value-size=N]\n"
+                     "                       [--ops=N] [--threads=1,2,4,8]\n",
+                     error);
+        std::exit(2);
+    }
+
+    std::vector<size_t> parse_list(const std::string& text) {
+        std::vector<size_t> values;
+        size_t begin = 0;
+        while (begin <= text.size()) {
+            size_t end = text.find(',', begin);
+            if (end == std::string::npos)
+                end = text.size();
+            values.push_back(std::stoull(text.substr(begin, end - begin)));
+            begin = end + 1;
+        }
+        return values;
+    }
+
+    Config parse(int argc, char** argv) {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos)
+                usage(("bad argument " + arg).c_str());
+            std::string name = arg.substr(2, eq - 2);
+            std::string value = arg.substr(eq + 1);
+            try {
+                if (name == "workload") {
+                    const OperationMix* found = nullptr;
+                    for (const OperationMix& mix : YCSB_WORKLOADS)
+                        if (value == mix.name)
+                            found = &mix;
+                    if (!found)
+                        usage(("unknown workload " + value).c_str());
+                    config.mix = *found;
+                } else if (name == "distribution") {
+                    if (value != "zipfian" && value != "uniform" && value != "latest" && value != "hotspot" &&
+                        value != "scan")
+                        usage(("unknown distribution " + value).c_str());
+                    config.distribution = value;
+                } else if (name == "theta") {
+                    config.theta = std::stod(value);
+                } else if (name == "records") {
+                    config.records = std::stoull(value);
+                } else if (name == "capacity") {
+                    config.capacity = std::stoull(value);
+                } else if (name == "value-size") {
+                    config.value_size = std::stoull(value);
+                } else if (name == "ops") {
+                    config.ops = std::stoull(value);
+                } else if (name == "threads") {
+                    config.threads = parse_list(value);
+                } else {
+                    usage(("unknown option --" + name).c_str());
+                }
+            } catch (const std::logic_error&) {
+                usage(("bad value for --" + name).c_str());
+            }
+        }
+        if (config.records == 0 || config.records > UINT32_MAX / 2 || config.capacity == 0 || config.ops == 0 ||
+            config.theta <= 0.0 || config.theta >= 1.0)
+            usage("records, capacity and ops must be positive, records below 2^31, theta in (0, 1)");
+        for (size_t threads : config.threads)
+            if (threads == 0)
+                usage("thread counts must be positive");
+        return config;
+    }
+
+    std::vector<Request> make_trace(const Config& config, size_t thread, uint64_t seed) {
+        std::vector<Request> trace(config.ops);
+        std::mt19937_64 rng(seed);
+        if (config.distribution == "uniform") {
+            UniformGenerator keys(config.records);
+            fill_trace(trace, keys, config.mix, rng);
+        } else if (config.distribution == "latest") {
+            LatestGenerator keys(config.records, config.theta);
+            fill_trace(trace, keys, config.mix, rng);
+        } else if (config.distribution == "hotspot") {
+            HotspotGenerator keys(config.records, config.hot_keys, config.hot_ops);
+            fill_trace(trace, keys, config.mix, rng);
+        } else if (config.distribution == "scan") {
+            uint64_t scan_begin = config.records + thread * config.capacity;
+            ScanBurstGenerator keys(config.records, config.theta, config.scan_period, config.scan_length,
+                                    scan_begin, scan_begin + config.capacity);
+            fill_trace(trace, keys, config.mix, rng);
+        } else {
+            ZipfianGenerator keys(config.records, config.theta);
+            fill_trace(trace, keys, config.mix, rng);
+        }
+        return trace;
+    }
+
+    // What one pair of clock reads costs, and so adds to every latency.
+    uint64_t clock_overhead_ns() {
+        LatencyHistogram histogram;
+        for (int i = 0; i < 100'000; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            auto end = std::chrono::steady_clock::now();
+            histogram.record(static_cast<uint64_t>((end - start).count()));
+        }
+        return histogram.percentile(50);
+    }
+
+    bool run_request(KVStore& store, std::string_view key, Operation op, std::string_view value,
+                     std::string& out) {
+        switch (op) {
+            case Operation::Read:
+                if (store.get_into(key, out))
+                    return true;
+                store.put(key, value);
+                return false;
+            case Operation::Update:
+                store.put(key, value);
+                return false;
+            case Operation::ReadModifyWrite: {
+                bool hit = store.get_into(key, out);
+                store.put(key, hit ? std::string_view(out) : value);
+                return hit;
+            }
+        }
+        return false;
+    }
+
+    void print_latency(const char* name, const LatencyHistogram& histogram, bool last) {
+        std::printf("        \"%s\": {\"count\": %llu, \"mean\": %.1f, \"p50\": %llu, \"p99\": %llu, "
+                    "\"p999\": %llu, \"max\": %llu}%s\n",
+                    name, static_cast<unsigned long long>(histogram.count()), histogram.mean(),
+                    static_cast<unsigned long long>(histogram.percentile(50)),
+                    static_cast<unsigned long long>(histogram.percentile(99)),
+                    static_cast<unsigned long long>(histogram.percentile(99.9)),
+                    static_cast<unsigned long long>(histogram.max_value()), last ? "" : ",");
+    }
+
+    void run(const Config& config, size_t threads, const KeySet& keys, bool last) {
+        Options options;
+        options.capacity = config.capacity;
+        options.memory_budget = config.capacity * (config.value_size + 32);
+        KVStore store(options);
+        const std::string value(config.value_size, 'x');
+        for (size_t i = 0; i < config.records; ++i)
+            store.put(keys[i], value);
+
+        std::vector<ThreadResult> results(threads);
+        std::barrier sync(static_cast<std::ptrdiff_t>(threads));
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                std::string out;
+                for (const Request& request : make_trace(config, t, 2 * t + 1))
+                    run_request(store, keys[request.key], request.op, value, out);
+                std::vector<Request> trace = make_trace(config, t, 2 * t + 2);
+
+                ThreadResult& result = results[t];
+                sync.arrive_and_wait();
+                if (t == 0)
+                    start = std::chrono::steady_clock::now();
+                for (const Request& request : trace) {
+                    auto before = std::chrono::steady_clock::now();
+                    bool hit = run_request(store, keys[request.key], request.op, value, out);
+                    auto after = std::chrono::steady_clock::now();
+                    auto ns = static_cast<uint64_t>((after - before).count());
+                    result.all.record(ns);
+                    result.by_op[static_cast<size_t>(request.op)].record(ns);
+                    if (request.op != Operation::Update) {
+                        ++result.reads;
+                        result.hits += hit;
+                    }
+                }
+                sync.arrive_and_wait();
+                if (t == 0)
+                    end = std::chrono::steady_clock::now();
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+
+        ThreadResult total;
+        for (const ThreadResult& result : results) {
+            total.all.merge(result.all);
+            for (size_t op = 0; op < OPERATIONS; ++op)
+                total.by_op[op].merge(result.by_op[op]);
+            total.reads += result.reads;
+            total.hits += result.hits;
+        }
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double hit_ratio = total.reads == 0 ? 0.0 : static_cast<double>(total.hits) / static_cast<double>(total.reads);
+
+        std::printf("    {\n");
+        std::printf("      \"threads\": %zu,\n", threads);
+        std::printf("      \"ops\": %llu,\n", static_cast<unsigned long long>(total.all.count()));
+        std::printf("      \"seconds\": %.4f,\n", seconds);
+        std::printf("      \"ops_per_second\": %.0f,\n", static_cast<double>(total.all.count()) / seconds);
+        std::printf("      \"hit_ratio\": %.4f,\n", hit_ratio);
+        std::printf("      \"latency_ns\": {\n");
+        print_latency("all", total.all, false);
+        size_t remaining = 0;
+        for (size_t op = 0; op < OPERATIONS; ++op)
+            remaining += total.by_op[op].count() != 0;
+        for (size_t op = 0; op < OPERATIONS; ++op)
+            if (total.by_op[op].count() != 0)
+                print_latency(OPERATION_NAMES[op], total.by_op[op], --remaining == 0);
+        std::printf("      }\n");
+        std::printf("    }%s\n", last ? "" : ",");
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config = parse(argc, argv);
+    size_t max_threads = 0;
+    for (size_t threads : config.threads)
+        max_threads = std::max(max_threads, threads);
+    size_t key_count = config.records;
+    if (config.distribution == "scan")
+        key_count += max_threads * config.capacity;
+    KeySet keys(key_count);
+
+    std::printf("{\n");
+    std::printf("  \"workload\": \"%s\",\n", config.mix.name);
+    std::printf("  \"distribution\": \"%s\",\n", config.distribution.c_str());
+    std::printf("  \"theta\": %.2f,\n", config.theta);
+    std::printf("  \"records\": %zu,\n", config.records);
+    std::printf("  \"capacity\": %zu,\n", config.capacity);
+    std::printf("  \"value_size\": %zu,\n", config.value_size);
+    std::printf("  \"ops_per_thread\": %zu,\n", config.ops);
+    std::printf("  \"clock_overhead_ns\": %llu,\n", static_cast<unsigned long long>(clock_overhead_ns()));
+    std::printf("  \"runs\": [\n");
+    for (size_t i = 0; i < config.threads.size(); ++i)
+        run(config, config.threads[i], keys, i + 1 == config.threads.size());
+    std::printf("  ]\n");
+    std::printf("}\n");
+    return 0;
+}
@@ -0,0 +1,375 @@
+// kvstore_loadgen: throughput and latency of the memcached-protocol server
+// (server.hpp) over loopback TCP at several pipelining depths, as JSON on
+// stdout.
+//
+//   kvstore_loadgen [--port=N] [--server-threads=2] [--connections=4] [--depth=1,4,16,64]
+//                   [--workload=a|b|c] [--theta=0.99] [--records=100000] [--value-size=100]
+//                   [--ops=200000]
+//
+// Without --port, a server is started in this process on a free loopback
+// port, over a store that holds every record; with it, the load goes to a
+// kvstore_server already listening on 127.0.0.1:N. The records are set
+// first. Then, for each depth, every connection (one client thread each)
+// replays --ops requests drawn from a Zipfian distribution in the
+// workload's mix of gets and sets: it writes `depth` requests at once and
+// reads all their responses before writing the next batch. A request's
+// latency runs from its batch's write to the arrival of its response, so
+// it includes waiting behind the requests ahead of it in the batch.
+
+#include "histogram.hpp"
+#include "workload.hpp"
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <barrier>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace kvstore;
+
+namespace {
+    struct Config {
+        uint16_t port = 0;  // 0 = start a server in this process
+        size_t server_threads = 2;
+        size_t connections = 4;
+        std::vector<size_t> depths = {1, 4, 16, 64};
+        OperationMix mix = YCSB_WORKLOADS[1];
+        double theta = 0.99;
+        size_t records = 100'000;
+        size_t value_size = 100;
+        size_t ops = 200'000;
+    };
+
+    struct ThreadResult {
+        LatencyHistogram latency;
+        uint64_t gets = 0;
+        uint64_t hits = 0;
+    };
+
+    [[noreturn]] void usage(const char* error) {
+        std::fprintf(stderr,
+                     "kvstore_loadgen: %s\n"
+                     "usage: kvstore_loadgen [--port=N] [--server-threads=2] [--connections=4] "
+                     "[--depth=1,4,16,64]\n"
+                     "                       [--workload=a|b|c] [--theta=0.99] [--records=100000] "
+                     "[--value-size=100]\n"
+                     "                       [--ops=200000]\n",
+                     error);
+        std::exit(2);
+    }
+
+    std::vector<size_t> parse_list(const std::string& text) {
+        std::vector<size_t> values;
+        size_t begin = 0;
+        while (begin <= text.size()) {
+            size_t end = text.find(',', begin);
+            if (end == std::string::npos)
+                end = text.size();
+            values.push_back(std::stoull(text.substr(begin, end - begin)));
+            begin = end + 1;
+        }
+        return values;
+    }
+
+    Config parse(int argc, char** argv) {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos)
+                usage(("bad argument " + arg).c_str());
+            std::string name = arg.substr(2, eq - 2);
+            std::string value = arg.substr(eq + 1);
+            try {
+                if (name == "port") {
+                    unsigned long port = std::stoul(value);
+                    if (port == 0 || port > 65535)
+                        usage("port must be in 1..65535");
+                    config.port = static_cast<uint16_t>(port);
+                } else if (name == "server-threads") {
+                    config.server_threads = std::stoull(value);
+                } else if (name == "connections") {
+                    config.connections = std::stoull(value);
+                } else if (name == "depth") {
+                    config.depths = parse_list(value);
+                } else if (name == "workload") {
+                    // F's read-modify-writes depend on their reads, so they cannot be pipelined.
+                    const OperationMix* found = nullptr;
+                    for (const OperationMix& mix : YCSB_WORKLOADS)
+                        if (value == mix.name && mix.read_modify_write == 0.0)
+                            found = &mix;
+                    if (!found)
+                        usage(("unknown workload " + value).c_str());
+                    config.mix = *found;
+                } else if (name == "theta") {
+                    config.theta = std::stod(value);
+                } else if (name == "records") {
+                    config.records = std::stoull(value);
+                } else if (name == "value-size") {
+                    config.value_size = std::stoull(value);
+                } else if (name == "ops") {
+                    config.ops = std::stoull(value);
+                } else {
+                    usage(("unknown option --" + name).c_str());
+                }
+            } catch (const std::logic_error&) {
+                usage(("bad value for --" + name).c_str());
+            }
+        }
+        if (config.server_threads == 0 || config.connections == 0 || config.records == 0 ||
+            config.records > UINT32_MAX / 2 || config.ops == 0 || config.theta <= 0.0 || config.theta >= 1.0)
+            usage("threads, connections, records and ops must be positive, records below 2^31, theta in (0, 1)");
+        for (size_t depth : config.depths)
+            if (depth == 0)
+                usage("depths must be positive");
+        return config;
+    }
+
+    [[noreturn]] void fail(const char* what) {
+        throw std::system_error(errno, std::generic_category(), std::string("kvstore_loadgen: ") + what);
+    }
+
+    // A blocking loopback connection that reads responses into a buffer.
+    class Client {
+    public:
+        explicit Client(uint16_t port) {
+            fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+                fail("cannot create socket");
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+                fail("cannot connect");
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        ~Client() { ::close(fd); }
+
+        void send(std::string_view data) {
+            while (!data.empty()) {
+                ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    fail("send failed");
+                data.remove_prefix(static_cast<size_t>(n));
+            }
+        }
+
+        // Reads more into the buffer; what was parsed is dropped first.
+        void receive() {
+            buffer.erase(0, parsed);
+            parsed = 0;
+            size_t size = buffer.size();
+            buffer.resize(size + 64 * 1024);
+            ssize_t n;
+            do {
+                n = ::recv(fd, buffer.data() + size, 64 * 1024, 0);
+            } while (n < 0 && errno == EINTR);
+            if (n <= 0) {
+                buffer.resize(size);
+                fail(n == 0 ? "server closed the connection" : "recv failed");
+            }
+            buffer.resize(size + static_cast<size_t>(n));
+        }
+
+        // Takes the next complete response off the buffer: false if it has
+        // not all arrived. `hit` tells whether a get found its key.
+        bool next_response(bool& hit) {
+            std::string_view rest(buffer.data() + parsed, buffer.size() - parsed);
+            size_t pos = 0;
+            hit = false;
+            for (;;) {
+                size_t eol = rest.find("\r\n", pos);
+                if (eol == std::string_view::npos)
+                    return false;
+                std::string_view line = rest.substr(pos, eol - pos);
+                if (line.rfind("VALUE ", 0) != 0) {
+                    parsed += eol + 2;
+                    return true;
+                }
+                // VALUE <key> <flags> <bytes>: skip the data block.
+                size_t last = line.rfind(' ');
+                size_t bytes = 0;
+                std::from_chars(line.data() + last + 1, line.data() + line.size(), bytes);
+                pos = eol + 2 + bytes + 2;
+                if (pos > rest.size())
+                    return false;
+                hit = true;
+            }
+        }
+
+    private:
+        int fd = -1;
+        std::string buffer;
+        size_t parsed = 0;
+    };
+
+    std::string key_of(uint32_t index) {
+        return "key:" + std::to_string(index);
+    }
+
+    void append_request(std::string& batch, const Request& request, const std::string& value) {
+        if (request.op == Operation::Read) {
+            batch += "get ";
+            batch += key_of(request.key);
+            batch += "\r\n";
+        } else {
+            batch += "set ";
+            batch += key_of(request.key);
+            batch += " 0 0 ";
+            batch += std::to_string(value.size());
+            batch += "\r\n";
+            batch += value;
+            batch += "\r\n";
+        }
+    }
+
+    void load(const Config& config, const std::string& value) {
+        Client client(config.port);
+        std::string batch;
+        bool hit = false;
+        for (size_t first = 0; first < config.records; first += 64) {
+            size_t count = std::min<size_t>(64, config.records - first);
+            batch.clear();
+            for (size_t i = 0; i < count; ++i)
+                append_request(batch, {static_cast<uint32_t>(first + i), Operation::Update}, value);
+            client.send(batch);
+            for (size_t i = 0; i < count; ++i)
+                while (!client.next_response(hit))
+                    client.receive();
+        }
+    }
+
+    void run(const Config& config, size_t depth, const std::string& value, bool last) {
+        std::vector<ThreadResult> results(config.connections);
+        std::barrier sync(static_cast<std::ptrdiff_t>(config.connections));
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < config.connections; ++t) {
+            threads.emplace_back([&, t] {
+                std::vector<Request> trace(config.ops);
+                std::mt19937_64 rng(t + 1);
+                ZipfianGenerator keys(config.records, config.theta);
+                fill_trace(trace, keys, config.mix, rng);
+                Client client(config.port);
+                ThreadResult& result = results[t];
+                std::string batch;
+                bool hit = false;
+
+                sync.arrive_and_wait();
+                if (t == 0)
+                    start = std::chrono::steady_clock::now();
+                for (size_t first = 0; first < trace.size(); first += depth) {
+                    size_t count = std::min(depth, trace.size() - first);
+                    batch.clear();
+                    for (size_t i = 0; i < count; ++i)
+                        append_request(batch, trace[first + i], value);
+                    auto sent = std::chrono::steady_clock::now();
+                    client.send(batch);
+                    for (size_t i = 0; i < count; ++i) {
+                        while (!client.next_response(hit))
+                            client.receive();
+                        auto now = std::chrono::steady_clock::now();
+                        result.latency.record(static_cast<uint64_t>((now - sent).count()));
+                        if (trace[first + i].op == Operation::Read) {
+                            ++result.gets;
+                            result.hits += hit;
+                        }
+                    }
+                }
+                sync.arrive_and_wait();
+                if (t == 0)
+                    end = std::chrono::steady_clock::now();
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        ThreadResult total;
+        for (const ThreadResult& result : results) {
+            total.latency.merge(result.latency);
+            total.gets += result.gets;
+            total.hits += result.hits;
+        }
+        double seconds = std::chrono::duration<double>(end - start).count();
+        const LatencyHistogram& latency = total.latency;
+        std::printf("    {\n");
+        std::printf("      \"depth\": %zu,\n", depth);
+        std::printf("      \"ops\": %llu,\n", static_cast<unsigned long long>(latency.count()));
+        std::printf("      \"seconds\": %.4f,\n", seconds);
+        std::printf("      \"ops_per_second\": %.0f,\n", static_cast<double>(latency.count()) / seconds);
+        std::printf("      \"hit_ratio\": %.4f,\n",
+                    total.gets == 0 ? 0.0 : static_cast<double>(total.hits) / static_cast<double>(total.gets));
+        std::printf("      \"latency_ns\": {\"mean\": %.1f, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, "
+                    "\"max\": %llu}\n",
+                    latency.mean(), static_cast<unsigned long long>(latency.percentile(50)),
+                    static_cast<unsigned long long>(latency.percentile(99)),
+                    static_cast<unsigned long long>(latency.percentile(99.9)),
+                    static_cast<unsigned long long>(latency.max_value()));
+        std::printf("    }%s\n", last ? "" : ",");
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config = parse(argc, argv);
+    try {
+        std::unique_ptr<KVStore> store;
+        std::unique_ptr<Server> server;
+        if (config.port == 0) {
+            Options options;
+            options.capacity = config.records * 2;
+            options.num_shards = 64;
+            options.memory_budget = options.capacity * (config.value_size + 64);
+            store = std::make_unique<KVStore>(options);
+            ServerOptions server_options;
+            server_options.port = 0;
+            server_options.threads = config.server_threads;
+            server = std::make_unique<Server>(*store, server_options);
+            config.port = server->port();
+        }
+        const std::string value(config.value_size, 'x');
+        load(config, value);
+
+        std::printf("{\n");
+        std::printf("  \"server\": \"%s\",\n", server ? "in-process" : "external");
+        if (server)
+            std::printf("  \"server_threads\": %zu,\n", config.server_threads);
+        std::printf("  \"connections\": %zu,\n", config.connections);
+        std::printf("  \"workload\": \"%s\",\n", config.mix.name);
+        std::printf("  \"theta\": %.2f,\n", config.theta);
+        std::printf("  \"records\": %zu,\n", config.records);
+        std::printf("  \"value_size\": %zu,\n", config.value_size);
+        std::printf("  \"ops_per_connection\": %zu,\n", config.ops);
+        std::printf("  \"runs\": [\n");
+        for (size_t i = 0; i < config.depths.size(); ++i)
+            run(config, config.depths[i], value, i + 1 == config.depths.size());
+        std::printf("  ]\n");
+        std::printf("}\n");
+        return 0;
+    } catch (const std::exception& error) {
+        std::fprintf(stderr, "%s\n", error.what());
+        return 1;
+    }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The keys "key_<first>" onwards, packed into one buffer so that tens of
+// millions of them fit next to a store of the same size.
+class KeySet {
+public:
+    explicit KeySet(size_t count, size_t first = 0) {
+        offsets.reserve(count + 1);
+        blob.reserve(count * 12);
+        for (size_t i = 0; i < count; ++i) {
+            offsets.push_back(static_cast<uint32_t>(blob.size()));
+            blob += "key_";
+            blob += std::to_string(first + i);
+        }
+        offsets.push_back(static_cast<uint32_t>(blob.size()));
+    }
+
+    size_t size() const { return offsets.size() - 1; }
+
+    std::string_view operator[](size_t i) const {
+        return {blob.data() + offsets[i], offsets[i + 1] - offsets[i]};
+    }
+
+private:
+    std::string blob;
+    std::vector<uint32_t> offsets;
+};
+
+// Zipfian rank generator (Gray et al., "Quickly Generating Billion-Record
+// Synthetic Databases", as used by YCSB): returns i in [0, n) with probability
+// proportional to 1 / (i + 1)^theta, so rank 0 is the hottest key.
+class ZipfianGenerator {
+public:
+    explicit ZipfianGenerator(uint64_t n, double theta = 0.99)
+        : n(n), theta(theta)
+    {
+        zeta_n = zeta(n, theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) /
+              (1.0 - zeta(2, theta) / zeta_n);
+        half_pow_theta = 1.0 + std::pow(0.5, theta);
+    }
+
+    template <typename Rng>
+    uint64_t operator()(Rng& rng) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zeta_n;
+        if (uz < 1.0)
+            return 0;
+        if (uz < half_pow_theta)
+            return 1;
+        auto rank = static_cast<uint64_t>(static_cast<double>(n) * std::pow(eta * u - eta + 1.0, alpha));
+        return rank < n ? rank : n - 1;
+    }
+
+private:
+    static double zeta(uint64_t count, double theta) {
+        double sum = 0.0;
+        for (uint64_t i = 1; i <= count; ++i)
+            sum += 1.0 / std::pow(static_cast<double>(i), theta);
+        return sum;
+    }
+
+    uint64_t n;
+    double theta;
+    double zeta_n;
+    double alpha;
+    double eta;
+    double half_pow_theta;
+};
+
+// Uniform ranks in [0, n).
+class UniformGenerator {
+public:
+    explicit UniformGenerator(uint64_t n) : dist(0, n - 1) {}
+
+    template <typename Rng>
+    uint64_t operator()(Rng& rng) { return dist(rng); }
+
+private:
+    std::uniform_int_distribution<uint64_t> dist;
+};
+
+// YCSB "latest": Zipfian over recency. Keys are loaded in rank order, so the
+// last one loaded (n - 1) is the hottest.
+class LatestGenerator {
+public:
+    explicit LatestGenerator(uint64_t n, double theta = 0.99) : n(n), zipf(n, theta) {}
+
+    template <typename Rng>
+    uint64_t operator()(Rng& rng) { return n - 1 - zipf(rng); }
+
+private:
+    uint64_t n;
+    ZipfianGenerator zipf;
+};
+
+// YCSB "hotspot": hot_ops of the requests go uniformly to the first hot_keys
+// of the key space, the rest uniformly to the others.
+class HotspotGenerator {
+public:
+    HotspotGenerator(uint64_t n, double hot_keys = 0.2, double hot_ops = 0.8)
+        : hot_size(std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(n) * hot_keys))),
+          hot_ops(hot_ops), n(n)
+    {
+    }
+
+    template <typename Rng>
+    uint64_t operator()(Rng& rng) {
+        bool hot = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < hot_ops || hot_size == n;
+        if (hot)
+            return std::uniform_int_distribution<uint64_t>(0, hot_size - 1)(rng);
+        return std::uniform_int_distribution<uint64_t>(hot_size, n - 1)(rng);
+    }
+
+private:
+    uint64_t hot_size;
+    double hot_ops;
+    uint64_t n;
+};
+
+// Zipfian requests broken up by scan bursts: every `period` requests, the
+// next `length` are consecutive keys of a scan over [scan_begin, scan_end),
+// past the Zipfian key space, so each scan key is new to the store. The scan
+// wraps around, by which time its first keys are long evicted.
+class ScanBurstGenerator {
+public:
+    ScanBurstGenerator(uint64_t n, double theta, uint64_t period, uint64_t length, uint64_t scan_begin,
+                       uint64_t scan_end)
+        : zipf(n, theta), period(period), length(length), scan_begin(scan_begin), scan_end(scan_end),
+          cursor(scan_begin)
+    {
+    }
+
+    template <typename Rng>
+    uint64_t operator()(Rng& rng) {
+        uint64_t phase = count++ % (period + length);
+        if (phase < period)
+            return zipf(rng);
+        uint64_t key = cursor;
+        cursor = cursor + 1 == scan_end ? scan_begin : cursor + 1;
+        return key;
+    }
+
+private:
+    ZipfianGenerator zipf;
+    uint64_t period;
+    uint64_t length;
+    uint64_t scan_begin;
+    uint64_t scan_end;
+    uint64_t cursor;
+    uint64_t count = 0;
+};
+
+// A YCSB core workload's operation mix, as fractions that sum to 1. The
+// workloads here neither insert nor scan, so D and E are left out.
+struct OperationMix {
+    const char* name;
+    double read;
+    double update;
+    double read_modify_write;
+};
+
+inline constexpr OperationMix YCSB_WORKLOADS[] = {
+    {"a", 0.50, 0.50, 0.00},  // update heavy
+    {"b", 0.95, 0.05, 0.00},  // read mostly
+    {"c", 1.00, 0.00, 0.00},  // read only
+    {"f", 0.50, 0.00, 0.50},  // read-modify-write
+};
+
+enum class Operation : uint8_t { Read, Update, ReadModifyWrite };
+
+// One request of a pre-generated trace.
+struct Request {
+    uint32_t key;
+    Operation op;
+};
+
+// Fills `trace` with requests whose keys come from `keys` and whose
+// operations follow `mix`. Traces are drawn before a timed run so that the
+// run measures the store, not the generators.
+template <typename KeyGenerator, typename Rng>
+void fill_trace(std::vector<Request>& trace, KeyGenerator& keys, const OperationMix& mix, Rng& rng) {
+    std::uniform_real_distribution<double> pick(0.0, 1.0);
+    for (Request& request : trace) {
+        request.key = static_cast<uint32_t>(keys(rng));
+        double p = pick(rng);
+        request.op = p < mix.read ? Operation::Read
+                   : p < mix.read + mix.update ? Operation::Update
+                   : Operation::ReadModifyWrite;
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace kvstore {
+
+    // One up-front mapping that shard tables and node pools are carved out of.
+    // Everything is allocated at construction; nothing is returned until the
+    // arena itself goes away, so objects placed here must be trivially destructible.
+    // Nothing placed here may hold a pointer either (only indices and
+    // offsets), which is what lets a snapshot be mapped back at any address.
+    class Arena {
+    public:
+        static constexpr size_t ALIGNMENT = 64;
+
+        Arena() = default;
+        explicit Arena(size_t bytes);
+        // Maps `bytes` of file `fd` from `offset` (page-aligned) copy-on-write:
+        // a snapshot's arena. Its objects already exist, so the same sequence
+        // of allocations as the original carves out the same objects and
+        // allocate() constructs nothing.
+        Arena(int fd, size_t offset, size_t bytes);
+        // Carves up `bytes` of zero-filled memory that someone else mapped
+        // and unmaps (a shared segment's arena); the arena only borrows it.
+        Arena(std::byte* memory, size_t bytes);
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+        Arena(Arena&& other) noexcept;
+        Arena& operator=(Arena&& other) noexcept;
+
+        template <typename T>
+        static constexpr size_t bytes_for(size_t count) {
+            return (sizeof(T) * count + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        }
+
+        template <typename T>
+        T* allocate(size_t count) {
+            static_assert(std::is_trivially_destructible_v<T>);
+            static_assert(alignof(T) <= ALIGNMENT);
+
+            size_t bytes = bytes_for<T>(count);
+            if (bytes > size - used)
+                throw std::bad_alloc();
+
+            T* first = reinterpret_cast<T*>(base + used);
+            used += bytes;
+            if (!mapped_file)
+                for (size_t i = 0; i < count; ++i)
+                    new (first + i) T{};
+            return first;
+        }
+
+        // Raw, zero-filled bytes. Unlike allocate<T>() nothing is written, so
+        // large regions stay untouched until first use.
+        std::byte* allocate_bytes(size_t bytes) {
+            bytes = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            if (bytes > size - used)
+                throw std::bad_alloc();
+
+            std::byte* first = base + used;
+            used += bytes;
+            return first;
+        }
+
+        // Skips ahead so the next allocation starts at a multiple of
+        // `alignment` (a power of two) from the arena's start.
+        void align(size_t alignment) {
+            size_t aligned = (used + alignment - 1) & ~(alignment - 1);
+            if (aligned > size)
+                throw std::bad_alloc();
+            used = aligned;
+        }
+
+        size_t capacity() const { return size; }
+        size_t bytes_used() const { return used; }
+        const std::byte* data() const { return base; }
+        // True for a snapshot's arena: what is carved out is already initialized.
+        bool restored() const { return mapped_file; }
+
+    private:
+        std::byte* base = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+        bool mapped_file = false;
+        bool borrowed = false;
+    };
+}
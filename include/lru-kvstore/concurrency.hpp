@@ -1,19 +1,228 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 
 namespace kvstore {
 
+    inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    // Contention seen by a lock: pause iterations spent waiting for it and
+    // times a thread went to sleep on it. Only the slow paths count.
+    struct LockCounters {
+        uint64_t spins = 0;
+        uint64_t sleeps = 0;
+
+        LockCounters& operator+=(const LockCounters& other) {
+            spins += other.spins;
+            sleeps += other.sleeps;
+            return *this;
+        }
+    };
+
+    // Shard locks. Every lock has lock(), try_lock(), unlock() and counters();
+    // a SharedLockable one also lets get() and pin() share it (see below).
+    // None of them allocates or needs a destructor, so they live in the
+    // shard like any other member.
+
+    // Plain test-and-set: cheapest uncontended, but waiters hammer the flag's
+    // cache line and never yield the core.
     struct SpinLock {
         std::atomic_flag flag = ATOMIC_FLAG_INIT;
+        std::atomic<uint64_t> spins{0};
 
         void lock() {
-            while (flag.test_and_set(std::memory_order_acquire)) {}
+            if (!flag.test_and_set(std::memory_order_acquire))
+                return;
+            uint64_t n = 1;
+            while (flag.test_and_set(std::memory_order_acquire))
+                ++n;
+            spins.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        bool try_lock() {
+            return !flag.test_and_set(std::memory_order_acquire);
         }
 
         void unlock() {
             flag.clear(std::memory_order_release);
         }
+
+        LockCounters counters() const { return {spins.load(std::memory_order_relaxed), 0}; }
     };
-}
 
+    // Upper bound on pause instructions between two looks at a contended lock.
+    static constexpr uint32_t MAX_BACKOFF = 64;
+    // Pause instructions a waiter spends before it goes to sleep (a few
+    // microseconds, about the length of a long eviction).
+    static constexpr uint32_t SPIN_LIMIT = 4096;
+
+    // Test-and-test-and-set: waiters spin on a plain load, pausing 1, 2, 4 ...
+    // MAX_BACKOFF times between looks, and only retry the exchange once the
+    // lock looks free. Never sleeps.
+    struct BackoffLock {
+        std::atomic<bool> locked{false};
+        std::atomic<uint64_t> spins{0};
+
+        void lock() {
+            if (!locked.exchange(true, std::memory_order_acquire))
+                return;
+            lock_slow();
+        }
+
+        bool try_lock() {
+            return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+        }
+
+        void unlock() {
+            locked.store(false, std::memory_order_release);
+        }
+
+        LockCounters counters() const { return {spins.load(std::memory_order_relaxed), 0}; }
+
+    private:
+        void lock_slow();
+    };
+
+    // BackoffLock that stops spinning after SPIN_LIMIT pauses and sleeps on a
+    // futex (Drepper's three-state mutex: 0 free, 1 held, 2 held with
+    // sleepers), so a preempted holder does not cost the waiters whole
+    // timeslices. Unlock enters the kernel only when someone may be asleep.
+    struct AdaptiveLock {
+        std::atomic<uint32_t> state{0};
+        std::atomic<uint64_t> spins{0};
+        std::atomic<uint64_t> sleeps{0};
+
+        void lock() {
+            uint32_t expected = 0;
+            if (state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            lock_slow();
+        }
+
+        bool try_lock() {
+            uint32_t expected = 0;
+            return state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void unlock() {
+            if (state.exchange(0, std::memory_order_release) == 2)
+                wake();
+        }
+
+        LockCounters counters() const {
+            return {spins.load(std::memory_order_relaxed), sleeps.load(std::memory_order_relaxed)};
+        }
+
+    private:
+        void lock_slow();
+        void wake();
+    };
+
+    // Reader/writer AdaptiveLock. get() and pin() take it shared, so readers
+    // of one shard no longer serialize; everything else takes it exclusive.
+    // A waiting writer sets PENDING, which holds off new readers until it is
+    // in. Waiters spin with backoff, then sleep on the state word.
+    struct SharedAdaptiveLock {
+        static constexpr uint32_t WRITER = 1u << 31;
+        static constexpr uint32_t PENDING = 1u << 30;
+        static constexpr uint32_t READERS = PENDING - 1;
+
+        std::atomic<uint32_t> state{0};
+        std::atomic<uint32_t> sleepers{0};
+        std::atomic<uint64_t> spins{0};
+        std::atomic<uint64_t> sleeps{0};
+
+        void lock() {
+            uint32_t expected = 0;
+            if (state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            lock_slow();
+        }
+
+        bool try_lock() {
+            uint32_t expected = 0;
+            return state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        void unlock() {
+            state.fetch_and(~WRITER, std::memory_order_seq_cst);
+            if (sleepers.load(std::memory_order_seq_cst))
+                wake();
+        }
+
+        void lock_shared() {
+            uint32_t s = state.load(std::memory_order_relaxed);
+            if (!(s & (WRITER | PENDING)) &&
+                state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+            lock_shared_slow();
+        }
+
+        void unlock_shared() {
+            uint32_t s = state.fetch_sub(1, std::memory_order_seq_cst) - 1;
+            if ((s & READERS) == 0 && sleepers.load(std::memory_order_seq_cst))
+                wake();
+        }
+
+        LockCounters counters() const {
+            return {spins.load(std::memory_order_relaxed), sleeps.load(std::memory_order_relaxed)};
+        }
+
+    private:
+        void lock_slow();
+        void lock_shared_slow();
+        void sleep(uint32_t seen);
+        void wake();
+    };
+
+    template <typename Lock>
+    concept SharedLockable = requires(Lock& lock) {
+        lock.lock_shared();
+        lock.unlock_shared();
+    };
+
+    // Blocks while `word` still holds `expected` (spurious wakeups allowed).
+    void futex_wait(std::atomic<uint32_t>& word, uint32_t expected);
+    void futex_wake(std::atomic<uint32_t>& word, int waiters);
+
+    // Sequence lock for optimistic readers. Writers (already serialized by the
+    // shard lock) make the sequence odd while they mutate; a reader snapshots
+    // it, reads without locking, and retries if it changed in between.
+    struct SeqLock {
+        std::atomic<uint64_t> sequence{0};
+
+        uint64_t read_begin() const {
+            return sequence.load(std::memory_order_acquire);
+        }
+
+        // True if what was read since read_begin() may be torn.
+        bool read_retry(uint64_t start) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return (start & 1) || sequence.load(std::memory_order_relaxed) != start;
+        }
+
+        void write_begin() {
+            sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        void write_end() {
+            sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        struct WriteSection {
+            SeqLock& seq;
+            explicit WriteSection(SeqLock& s) : seq(s) { seq.write_begin(); }
+            ~WriteSection() { seq.write_end(); }
+            WriteSection(const WriteSection&) = delete;
+            WriteSection& operator=(const WriteSection&) = delete;
+        };
+    };
+}
@@ -1,7 +1,98 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace kvstore {
-    static constexpr size_t NUM_SHARDS = 8;
-    static constexpr size_t TOTAL_CAPACITY = 1024;
-    static constexpr size_t LOCAL_CAPACITY = TOTAL_CAPACITY / NUM_SHARDS;
+    static constexpr size_t DEFAULT_NUM_SHARDS = 8;
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+    static constexpr double DEFAULT_LOAD_FACTOR = 0.75;
+    // Key + value bytes assumed per entry when only one of capacity and
+    // memory_budget is given (the old fixed 32-byte key / 64-byte value node).
+    static constexpr size_t DEFAULT_ENTRY_BYTES = 96;
+    // Expired entries a write reclaims before it goes ahead, and the
+    // maintenance thread per hold of a shard lock.
+    static constexpr size_t EXPIRE_BATCH = 32;
+    // Each shard can hold back capacity / RETIRED_CHUNK_SHARE chunks (at
+    // least RETIRED_CHUNKS_MIN) that pinned ValueHandles may still read.
+    static constexpr size_t RETIRED_CHUNK_SHARE = 16;
+    static constexpr size_t RETIRED_CHUNKS_MIN = 64;
+    // In durable mode, a writer that finds its shard's log buffer this many
+    // times over its share of wal_commit_bytes commits the log itself
+    // instead of waiting for the commit thread (backpressure).
+    static constexpr size_t WAL_BACKPRESSURE = 4;
+
+    // How Shard::find scans control bytes.
+    enum class ProbeKernel : std::uint8_t {
+        Simd,    // AVX2 (32 buckets) or SSE2 (16 buckets), whichever the build targets
+        Scalar,  // portable SWAR, 8 buckets per 64-bit word
+    };
+
+    // Which new keys may displace existing ones once a shard is full.
+    enum class Admission : std::uint8_t {
+        Always,   // every new key goes in; the policy's victim leaves
+        TinyLfu,  // W-TinyLFU: a 1% window, then a frequency contest with the victim
+    };
+
+    // Where the arena's pages go on a machine with several NUMA nodes (see
+    // numa.hpp). With one node, or a kernel that will not say, all three are
+    // the same.
+    enum class NumaPlacement : std::uint8_t {
+        None,        // wherever the first thread to touch them runs (first touch)
+        Interleave,  // round-robin over all nodes, page by page
+        PerShard,    // each shard's tables, nodes and slab on that shard's node
+    };
+
+    struct Options {
+        // Maximum number of entries across all shards. 0 = derived from
+        // memory_budget / DEFAULT_ENTRY_BYTES.
+        size_t capacity = DEFAULT_CAPACITY;
+        // Bytes of key/value storage across all shards; the LRU evicts when
+        // either this or capacity is exhausted. 0 = capacity * DEFAULT_ENTRY_BYTES.
+        size_t memory_budget = 0;
+        size_t num_shards = DEFAULT_NUM_SHARDS;
+        // Upper bound on occupied / total buckets in each shard's table.
+        double load_factor = DEFAULT_LOAD_FACTOR;
+        ProbeKernel probe_kernel = ProbeKernel::Simd;
+        // Move entries to the LRU head when they are read, not only when they
+        // are written. Reads are batched through per-shard read buffers.
+        // false = eviction in insertion/update order (FIFO for read-only keys).
+        bool promote_on_read = true;
+        Admission admission = Admission::Always;
+        // Give every entry an optional deadline, so put() can take a TTL.
+        // Costs a per-shard timer wheel and 16 bytes per entry.
+        bool expiry = false;
+        // With expiry, a background thread reclaims expired entries this
+        // often. 0 = no thread: writes to a shard reclaim its expired
+        // entries, EXPIRE_BATCH at a time, and expire() does it on demand.
+        std::chrono::milliseconds expiry_interval{0};
+        // Durable mode: non-empty makes every put() and erase() append a
+        // record to a write-ahead log at this path, with `<wal_path>.snap`
+        // holding the log's last compaction. On construction the store
+        // loads that snapshot, replays the log over it and compacts the
+        // two into a new snapshot. Records are buffered per shard and
+        // written and fdatasync'd together (group commit) once the buffers
+        // hold wal_commit_bytes or wal_commit_interval has passed, so a
+        // crash loses at most about that much; sync() waits for it.
+        std::string wal_path;
+        size_t wal_commit_bytes = 1 << 20;
+        std::chrono::milliseconds wal_commit_interval{10};
+        // Multi-process mode: non-empty puts the shards in the POSIX shared
+        // memory segment of this name (see shared_memory.hpp), which other
+        // processes attach to by constructing a store of the same type with
+        // the same Options. The first to get there creates it; the segment
+        // outlives every store until SharedSegment::unlink(). Not with
+        // wal_path.
+        std::string shared_name;
+        NumaPlacement numa = NumaPlacement::None;
+        // With NumaPlacement::PerShard: shard i's node. Empty = shards split
+        // into numa_node_count() equal runs, shard i on node
+        // i * nodes / num_shards. BasicKVStore::shard_node() reports the
+        // result, so threads can be pinned (numa_run_on_node()) next to the
+        // shards they use.
+        std::vector<int> shard_nodes;
+    };
 }
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+namespace kvstore {
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    class BasicKVStore;
+
+    // Epoch-based reclamation for zero-copy reads. A reader pins the current
+    // epoch in one of a fixed set of slots for as long as it holds a view into
+    // shard memory. A writer that unlinks a slab chunk stamps it with retire()
+    // and frees it only once every pinned slot is newer than the stamp.
+    // Slots are claimed per pin, so one thread may hold several.
+    class EpochDomain {
+    public:
+        static constexpr size_t MAX_SLOTS = 128;
+        static constexpr uint64_t NONE = UINT64_MAX;
+
+        // Claims a slot at the current epoch and returns its index. Throws
+        // std::runtime_error if every slot is taken.
+        uint32_t pin();
+        void unpin(uint32_t slot) { slots[slot].epoch.store(0, std::memory_order_release); }
+
+        // Closes the current epoch and returns it. Readers pinned at or before
+        // the returned epoch may still see whatever was unlinked before the call.
+        uint64_t retire() { return epoch.fetch_add(1, std::memory_order_acq_rel); }
+
+        // Oldest pinned epoch, or NONE when no reader is pinned. Costs one load
+        // per slot ever claimed, so it is free until the first pin.
+        uint64_t oldest_pinned() const;
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch{0};     // 0 = free
+        };
+
+        std::atomic<uint64_t> epoch{1};
+        std::atomic<uint32_t> slots_used{0};    // high-water mark of claimed slots
+        Slot slots[MAX_SLOTS];
+    };
+
+
+    // Zero-copy view of a value that stays readable while the handle lives,
+    // even if the entry is overwritten, erased or evicted meanwhile: its chunk
+    // is recycled only after every handle that could see it is gone. A handle
+    // must not outlive the store it came from.
+    class ValueHandle {
+    public:
+        ValueHandle() = default;
+        ~ValueHandle() { reset(); }
+
+        ValueHandle(ValueHandle&& other) noexcept
+            : epochs(std::exchange(other.epochs, nullptr)), slot(other.slot), view(other.view) {}
+
+        ValueHandle& operator=(ValueHandle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                epochs = std::exchange(other.epochs, nullptr);
+                slot = other.slot;
+                view = other.view;
+            }
+            return *this;
+        }
+
+        ValueHandle(const ValueHandle&) = delete;
+        ValueHandle& operator=(const ValueHandle&) = delete;
+
+        explicit operator bool() const { return epochs != nullptr; }
+        std::string_view value() const { return view; }
+        std::string_view operator*() const { return view; }
+
+        void reset() {
+            if (epochs)
+                epochs->unpin(slot);
+            epochs = nullptr;
+            view = {};
+        }
+
+    private:
+        template <typename Policy, typename Lock, typename Hasher, typename Stats>
+        friend class BasicKVStore;
+
+        ValueHandle(EpochDomain* epochs, uint32_t slot, std::string_view view)
+            : epochs(epochs), slot(slot), view(view) {}
+
+        EpochDomain* epochs = nullptr;
+        uint32_t slot = 0;
+        std::string_view view;
+    };
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "arena.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace kvstore {
+
+    static constexpr uint32_t NIL_NODE = UINT32_MAX;
+
+    // Hot per-node metadata: everything a probe, a Robin Hood move or a queue
+    // splice touches. 16 bytes, so four nodes share a cache line. `prev` and
+    // `next` belong to the eviction policy while the node is resident, and
+    // link the shard's free and retired lists otherwise.
+    struct NodeMeta {
+        uint64_t hash = 0;
+        uint32_t prev = NIL_NODE;
+        uint32_t next = NIL_NODE;
+    };
+
+    // Eviction policies. A shard owns one policy object and calls it with the
+    // shard lock held, except on_access() when CONCURRENT_ACCESS is true:
+    // lock-free readers then call it directly, so it may only touch per-node
+    // atomics. Otherwise reader hits go through the shard's ReadBuffer.
+    //
+    //   static constexpr bool CONCURRENT_ACCESS;
+    //   static size_t storage_bytes(size_t capacity);
+    //   void init(Arena& arena, size_t capacity, NodeMeta* meta);
+    //   void on_insert(uint32_t node);     // new entry; meta[node].hash is set
+    //   void on_access(uint32_t node);     // read or overwrite hit
+    //   void on_remove(uint32_t node);     // erased, or evicted after victim()
+    //   uint32_t victim(uint32_t keep);    // next node to evict, never `keep`;
+    //                                      // NIL_NODE if there is none
+    //   bool contains(uint32_t node) const;
+    //   struct State;                      // what lives outside the arena:
+    //   State state() const;               // queue ends, hands (snapshots)
+    //   bool restore(const State&, size_t capacity);  // after init() on a
+    //                                      // snapshot's arena; false if a
+    //                                      // node index is out of range or
+    //                                      // a queue does not hold together
+    //
+    // victim() may update the policy's own state (hands, queues, ghosts). The
+    // shard usually evicts the node it returns, but with TinyLFU admission the
+    // victim can win against the candidate and stay; it must then remain a
+    // valid resident node.
+
+    // Doubly-linked queue through NodeMeta::prev/next; head is the newest end.
+    struct NodeQueue {
+        uint32_t head = NIL_NODE;
+        uint32_t tail = NIL_NODE;
+        size_t size = 0;
+
+        void push_front(NodeMeta* meta, uint32_t node);
+        void unlink(NodeMeta* meta, uint32_t node);
+        bool empty() const { return head == NIL_NODE; }
+        // Walks the queue from head to tail, at most `size` steps, so a
+        // snapshot whose links loop or disagree is rejected.
+        bool valid(const NodeMeta* meta, size_t capacity) const;
+    };
+
+
+    // Classic LRU: every hit splices the node to the head, the tail goes first.
+    class LruPolicy {
+    public:
+        static constexpr bool CONCURRENT_ACCESS = false;
+
+        static size_t storage_bytes(size_t) { return 0; }
+        void init(Arena&, size_t, NodeMeta* meta) { this->meta = meta; }
+
+        void on_insert(uint32_t node) { queue.push_front(meta, node); }
+        void on_access(uint32_t node) {
+            if (node == queue.head)
+                return;
+            queue.unlink(meta, node);
+            queue.push_front(meta, node);
+        }
+        void on_remove(uint32_t node) { queue.unlink(meta, node); }
+        uint32_t victim(uint32_t keep) const {
+            if (queue.tail != keep || keep == NIL_NODE)
+                return queue.tail;
+            return meta[keep].prev;
+        }
+        // Only resident nodes have a predecessor or are the head.
+        bool contains(uint32_t node) const { return meta[node].prev != NIL_NODE || node == queue.head; }
+
+        struct State {
+            NodeQueue queue;
+        };
+        State state() const { return {queue}; }
+        bool restore(const State& state, size_t capacity) {
+            queue = state.queue;
+            return queue.valid(meta, capacity);
+        }
+
+    private:
+        NodeMeta* meta = nullptr;
+        NodeQueue queue;
+    };
+
+
+    // CLOCK: a hit sets the node's reference bit; the hand sweeps node slots,
+    // clearing set bits and evicting the first resident node without one.
+    class ClockPolicy {
+    public:
+        static constexpr bool CONCURRENT_ACCESS = true;
+
+        static size_t storage_bytes(size_t capacity);
+        void init(Arena& arena, size_t capacity, NodeMeta* meta);
+
+        void on_insert(uint32_t node) {
+            slots[node].referenced.store(0, std::memory_order_relaxed);
+            slots[node].resident = 1;
+        }
+        void on_access(uint32_t node) {
+            if (!slots[node].referenced.load(std::memory_order_relaxed))
+                slots[node].referenced.store(1, std::memory_order_relaxed);
+        }
+        void on_remove(uint32_t node) { slots[node].resident = 0; }
+        uint32_t victim(uint32_t keep);
+        bool contains(uint32_t node) const { return slots[node].resident != 0; }
+
+        struct State {
+            uint64_t hand;
+        };
+        State state() const { return {hand}; }
+        bool restore(const State& state, size_t capacity) {
+            hand = state.hand;
+            return hand < capacity;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<uint8_t> referenced{0};
+            uint8_t resident = 0;       // written only under the shard lock
+        };
+
+        Slot* slots = nullptr;
+        size_t capacity = 0;
+        size_t hand = 0;
+    };
+
+
+    // SIEVE (Zhang et al., NSDI '24): one FIFO queue plus a visited bit. The
+    // hand walks from the tail towards the head, clearing visited bits, and
+    // evicts the first unvisited node in place; survivors are never moved.
+    class SievePolicy {
+    public:
+        static constexpr bool CONCURRENT_ACCESS = true;
+
+        static size_t storage_bytes(size_t capacity);
+        void init(Arena& arena, size_t capacity, NodeMeta* meta);
+
+        void on_insert(uint32_t node) {
+            visited[node].store(0, std::memory_order_relaxed);
+            queue.push_front(meta, node);
+        }
+        void on_access(uint32_t node) {
+            if (!visited[node].load(std::memory_order_relaxed))
+                visited[node].store(1, std::memory_order_relaxed);
+        }
+        void on_remove(uint32_t node);
+        uint32_t victim(uint32_t keep);
+        bool contains(uint32_t node) const { return meta[node].prev != NIL_NODE || node == queue.head; }
+
+        struct State {
+            NodeQueue queue;
+            uint32_t hand;
+        };
+        State state() const { return {queue, hand}; }
+        bool restore(const State& state, size_t capacity) {
+            queue = state.queue;
+            hand = state.hand;
+            return queue.valid(meta, capacity) && (hand == NIL_NODE || hand < capacity);
+        }
+
+    private:
+        NodeMeta* meta = nullptr;
+        std::atomic<uint8_t>* visited = nullptr;
+        NodeQueue queue;
+        uint32_t hand = NIL_NODE;
+    };
+
+
+    // S3-FIFO (Yang et al., SOSP '23): new keys enter a small FIFO holding
+    // ~10% of the shard. Leaving it, a key read more than once moves to the
+    // main FIFO; the rest are evicted and remembered in a ghost table, so
+    // their next insert goes straight to main. Main evicts FIFO order,
+    // reinserting keys whose 2-bit read counter is non-zero (and decrementing
+    // it). The ghost table is direct-mapped by hash, one slot per node; a
+    // collision simply forgets the older ghost.
+    class S3FifoPolicy {
+    public:
+        static constexpr bool CONCURRENT_ACCESS = true;
+
+        static size_t storage_bytes(size_t capacity);
+        void init(Arena& arena, size_t capacity, NodeMeta* meta);
+
+        void on_insert(uint32_t node);
+        void on_access(uint32_t node) {
+            uint8_t freq = slots[node].freq.load(std::memory_order_relaxed);
+            if (freq < MAX_FREQ)
+                slots[node].freq.store(freq + 1, std::memory_order_relaxed);
+        }
+        void on_remove(uint32_t node);
+        uint32_t victim(uint32_t keep);
+        bool contains(uint32_t node) const { return slots[node].queue != NONE; }
+
+        struct State {
+            NodeQueue small;
+            NodeQueue main;
+        };
+        State state() const { return {small, main}; }
+        bool restore(const State& state, size_t capacity) {
+            small = state.small;
+            main = state.main;
+            return small.valid(meta, capacity) && main.valid(meta, capacity);
+        }
+
+    private:
+        static constexpr uint8_t MAX_FREQ = 3;
+        static constexpr uint8_t NONE = 0;
+        static constexpr uint8_t SMALL = 1;
+        static constexpr uint8_t MAIN = 2;
+
+        struct Slot {
+            std::atomic<uint8_t> freq{0};
+            uint8_t queue = NONE;       // written only under the shard lock
+        };
+
+        NodeQueue& queue_of(uint32_t node) { return slots[node].queue == SMALL ? small : main; }
+        void move_to(NodeQueue& to, uint8_t which, uint32_t node);
+
+        NodeMeta* meta = nullptr;
+        Slot* slots = nullptr;
+        uint64_t* ghosts = nullptr;
+        size_t ghost_mask = 0;
+        size_t small_target = 1;
+        NodeQueue small;
+        NodeQueue main;
+    };
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kvstore {
+
+    // Count-min sketch of 4-bit counters for TinyLFU admission. Each key maps
+    // to one counter in each of four rows; its estimate is the smallest of the
+    // four. Counters saturate at 15, and once the shard has recorded ten
+    // accesses per entry every counter is halved, so the sketch follows
+    // recent popularity rather than all-time counts. Sixteen counters share a
+    // 64-bit word, four counters per entry of capacity (about 2 bytes each).
+    class FrequencySketch {
+    public:
+        static constexpr uint32_t MAX_COUNT = 15;
+
+        static size_t storage_bytes(size_t capacity);
+        void init(Arena& arena, size_t capacity);
+
+        // Conservative update: only the counters at the current minimum grow.
+        void increment(uint64_t hash);
+        uint32_t estimate(uint64_t hash) const;
+
+        size_t bytes() const { return words * sizeof(uint64_t); }
+
+        // The counters live in the arena; a snapshot keeps only the aging clock.
+        size_t additions_since_aging() const { return additions; }
+        void restore(size_t additions) { this->additions = additions; }
+
+    private:
+        static constexpr int DEPTH = 4;
+
+        static size_t words_for(size_t capacity);
+        size_t index(uint64_t hash, int row) const;
+        uint32_t counter(size_t idx) const { return (table[idx >> 4] >> ((idx & 15) * 4)) & 0xF; }
+        void age();
+
+        uint64_t* table = nullptr;
+        size_t words = 0;
+        size_t counter_mask = 0;
+        size_t additions = 0;
+        size_t sample_size = 0;
+    };
+}
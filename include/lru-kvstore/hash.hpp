@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace kvstore {
+
+    // Key hashers for BasicKVStore. A hasher maps a key to 64 bits with
+    // every input bit spread over both halves: the store takes the shard from
+    // the high 32 bits and the bucket and tag from the low ones.
+
+    // wyhash (Wang Yi, public domain): reads the key 4 or 8 bytes at a time
+    // and folds it with 64x64->128-bit multiplies. Keys of up to 16 bytes
+    // take two overlapping loads per side and a single multiply; longer keys
+    // fold 16 or 48 bytes per round. The default.
+    struct WyHasher {
+        static constexpr uint64_t P0 = 0xa0761d6478bd642full;
+        static constexpr uint64_t P1 = 0xe7037ed1a0b428dbull;
+        static constexpr uint64_t P2 = 0x8ebc6af09c88c6e3ull;
+        static constexpr uint64_t P3 = 0x589965cc75374cc3ull;
+
+        static uint64_t mix(uint64_t a, uint64_t b) {
+            __uint128_t r = static_cast<__uint128_t>(a) * b;
+            return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+        }
+        static uint64_t read64(const char* p) {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+        static uint64_t read32(const char* p) {
+            uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        uint64_t operator()(std::string_view key) const noexcept {
+            const char* p = key.data();
+            size_t len = key.size();
+            uint64_t seed = mix(P0, P1);
+            uint64_t a = 0;
+            uint64_t b = 0;
+
+            if (len <= 16) {
+                if (len >= 4) {
+                    size_t step = (len >> 3) << 2;
+                    a = (read32(p) << 32) | read32(p + step);
+                    b = (read32(p + len - 4) << 32) | read32(p + len - 4 - step);
+                } else if (len > 0) {
+                    a = (uint64_t{static_cast<uint8_t>(p[0])} << 16) |
+                        (uint64_t{static_cast<uint8_t>(p[len >> 1])} << 8) |
+                        static_cast<uint8_t>(p[len - 1]);
+                }
+            } else {
+                size_t left = len;
+                if (left > 48) {
+                    uint64_t s1 = seed;
+                    uint64_t s2 = seed;
+                    do {
+                        seed = mix(read64(p) ^ P1, read64(p + 8) ^ seed);
+                        s1 = mix(read64(p + 16) ^ P2, read64(p + 24) ^ s1);
+                        s2 = mix(read64(p + 32) ^ P3, read64(p + 40) ^ s2);
+                        p += 48;
+                        left -= 48;
+                    } while (left > 48);
+                    seed ^= s1 ^ s2;
+                }
+                while (left > 16) {
+                    seed = mix(read64(p) ^ P1, read64(p + 8) ^ seed);
+                    p += 16;
+                    left -= 16;
+                }
+                a = read64(p + left - 16);
+                b = read64(p + left - 8);
+            }
+
+            __uint128_t r = static_cast<__uint128_t>(a ^ P1) * (b ^ seed);
+            return mix(static_cast<uint64_t>(r) ^ P0 ^ len, static_cast<uint64_t>(r >> 64) ^ P1);
+        }
+    };
+
+    // FNV-1a, one byte and one multiply at a time, followed by the murmur3
+    // finalizer because FNV-1a's low bits are weak. The store's original hash.
+    struct FnvHasher {
+        uint64_t operator()(std::string_view key) const noexcept {
+            uint64_t hash = 14695981039346656037ull;
+            for (char c : key) {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 1099511628211ull;
+            }
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+    };
+
+    // A key together with its hash, from BasicKVStore::prehash().
+    struct HashedKey {
+        std::string_view key;
+        size_t hash = 0;
+    };
+}
@@ -1,91 +1,631 @@
 #pragma once
 
+#include "arena.hpp"
 #include "concurrency.hpp"
 #include "config.hpp"
+#include "epoch.hpp"
+#include "eviction.hpp"
+#include "frequency_sketch.hpp"
+#include "hash.hpp"
+#include "lookup_task.hpp"
+#include "probe_group.hpp"
+#include "read_buffer.hpp"
+#include "slab.hpp"
+#include "stats.hpp"
+#include "timer_wheel.hpp"
+#include "wal.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 
 namespace kvstore{
 
 
+    // Probe-length distribution of a store's tables. Bucket i counts lookups
+    // that needed i + 1 bucket reads; the last bucket also holds anything longer.
+    struct ProbeHistogram {
+        static constexpr size_t BUCKETS = 64;
+
+        std::array<uint64_t, BUCKETS> hit{};   // one sample per stored entry
+        std::array<uint64_t, BUCKETS> miss{};  // one sample per home bucket
+        size_t max_hit = 0;
+        size_t max_miss = 0;
+
+        void record_hit(size_t probes);
+        void record_miss(size_t probes);
+
+        static double mean(const std::array<uint64_t, BUCKETS>& histogram);
+        static size_t percentile(const std::array<uint64_t, BUCKETS>& histogram, double q);
+    };
+
+
+    struct MemoryUsage {
+        size_t entries = 0;
+        size_t index_bytes = 0;          // control bytes, buckets and nodes
+        size_t data_bytes_reserved = 0;  // slab pages handed to a size class
+        size_t data_bytes_used = 0;      // chunks handed out (incl. class rounding)
+        size_t payload_bytes = 0;        // key + value bytes actually stored
+        size_t admission_bytes = 0;      // TinyLFU sketch and window flags (in index_bytes too)
+    };
+
+
+    // Outcome of a read-modify-write call (see BasicKVStore::compare_and_swap()).
+    enum class RmwStatus : uint8_t {
+        Ok,
+        NotFound,    // no live entry for the key
+        Mismatch,    // compare_and_swap(): the entry has another version
+        NotNumeric,  // incr()/decr(): the value is not a decimal uint64_t
+        NotStored,   // the new value cannot fit; the entry keeps its old one
+    };
+
+
+    // One slice of the store. Which entry leaves when the shard is full is
+    // up to Policy (see eviction.hpp); Lock guards everything but the
+    // optimistic read path (see concurrency.hpp).
+    template <typename Policy, typename Lock = SpinLock, typename Stats = ShardStats>
     struct Shard {
 
+        static constexpr uint32_t NIL = NIL_NODE;
 
-        struct Node {
-            char key[32];
-            char value[64];
-            size_t key_len = 0;
-            Node* prev = nullptr;
-            Node* next = nullptr;
-            size_t hash = 0;
-        };
+        // A parked node (see retire_node) keeps its NodeData and stores its
+        // retire epoch in NodeMeta::hash, linked through `next`.
+        using NodeMeta = kvstore::NodeMeta;
 
-        enum class BucketState : std::uint8_t {
-            Empty,
-            Occupied,
-            Deleted
+        // Cold per-node data: key and value bytes live back to back in one slab chunk.
+        struct NodeData {
+            uint32_t data = SlabAllocator::NONE;
+            uint32_t key_len = 0;
+            uint32_t value_len = 0;
+            // Set by pin() once a ValueHandle may see the chunk, cleared when
+            // the entry gets a new one. A chunk without it is only read under
+            // the lock or a sequence check, so writers reuse it at once.
+            uint8_t pinned = 0;
+            // Taken from version_clock by every write of the value: the CAS
+            // token of compare_and_swap().
+            uint64_t version = 0;
         };
 
-        struct Bucket {
-            size_t hash = 0;
-            std::atomic<Node*> node = nullptr;
-            BucketState state = BucketState::Empty;
+        // Robin Hood open addressing over 32-bit node indices: table[i] is NIL
+        // when bucket i is empty, and entries are kept ordered by distance from
+        // their home bucket, so deletion shifts the run back instead of leaving
+        // tombstones. ctrl[i] mirrors bucket i as CTRL_EMPTY or a 7-bit tag of
+        // its hash; lookups scan ctrl a group at a time and only touch matching
+        // buckets.
+        //
+        // The members up to `slab` are what every lookup reads, lock-free
+        // ones included, and are written only by init(), so they fill the
+        // shard's first cache line and nothing a writer changes shares it.
+        uint8_t* ctrl = nullptr;
+        std::atomic<uint32_t>* table = nullptr;
+        NodeMeta* meta = nullptr;
+        NodeData* nodes = nullptr;
+        size_t capacity = 0;
+        size_t table_size = 0;
+        size_t mask = 0;
+        ProbeKernel probe_kernel = ProbeKernel::Simd;
+        // Hits from lock-free readers. Policies that can take them concurrently
+        // get them directly; the rest are buffered in `reads` and applied
+        // under `lock`.
+        bool promote_on_read = true;
+        // Starts on a cache line of its own (see slab.hpp).
+        SlabAllocator slab;
+
+        // From here on, what writers change under `lock`.
+        Policy policy;
+        // W-TinyLFU (Admission::TinyLfu only, otherwise in_window is null):
+        // new keys enter a small LRU window outside the policy; the window's
+        // oldest key joins the policy only if the sketch rates it above the
+        // policy's victim. Window nodes link through NodeMeta::prev/next.
+        FrequencySketch sketch;
+        NodeQueue window;
+        uint8_t* in_window = nullptr;
+        size_t window_capacity = 0;
+        // Options::expiry only (otherwise disabled): deadlines of entries put
+        // with a TTL, in monotonic_ms() ticks. Expired entries read as
+        // misses at once and are reclaimed by writes and expire().
+        TimerWheel timers;
+        uint32_t free_head = NIL;
+        // Pinned chunks a ValueHandle may still be reading, oldest first: a
+        // ring in the arena, so retiring a chunk takes no node from the pool.
+        // Its last slot is kept for store_value() (see retire_node).
+        struct RetiredChunk {
+            uint64_t epoch;
+            uint32_t data;
         };
+        RetiredChunk* retired_chunks = nullptr;
+        size_t retired_slots = 0;
+        size_t retired_first = 0;
+        size_t retired_chunk_count = 0;
+        // Nodes parked with their chunk once the ring is full, oldest first.
+        uint32_t retired_head = NIL;
+        uint32_t retired_tail = NIL;
+        size_t retired_count = 0;
+        EpochDomain* epochs = nullptr;  // for pin(); writers only look at it
+        // The last version handed out; versions are never reused, snapshots included.
+        uint64_t version_clock = 0;
 
+        // Written under `lock`, read without it by approximate_size().
+        std::atomic<size_t> current_size{0};
+        size_t payload_bytes = 0;
+        // Options::wal_path only: this shard's writes not yet in the log,
+        // appended under `lock` (see BasicKVStore::commit_log).
+        bool logging = false;
+        WalBuffer wal;
+        // The slice of the store's arena that init() carved out.
+        size_t region_offset = 0;
+        size_t region_bytes = 0;
 
+        static size_t storage_bytes(size_t capacity, size_t table_size, size_t slab_pages, size_t slab_page_bytes,
+                                    Admission admission, bool expiry);
+        void init(Arena& arena, size_t capacity, size_t table_size, size_t slab_pages, size_t slab_page_bytes,
+                  ProbeKernel kernel, EpochDomain& epochs, bool promote_on_read, Admission admission, bool expiry);
 
-        Bucket table[LOCAL_CAPACITY];
-        Node node_pool[LOCAL_CAPACITY];
-        bool node_used[LOCAL_CAPACITY] = {};
+        // What a snapshot keeps besides the arena region: the shard's state
+        // outside the arena. Trivially copyable, written to the file as is.
+        struct Image {
+            typename Policy::State policy;
+            SlabAllocator::State slab;
+            uint64_t sketch_additions;
+            NodeQueue window;
+            uint32_t free_head;
+            uint32_t retired_head;
+            uint64_t retired_first;
+            uint64_t retired_chunk_count;
+            uint64_t current_size;
+            uint64_t payload_bytes;
+            uint64_t region_offset;
+            uint64_t region_bytes;
+            uint64_t version_clock;
+        };
+        // Caller holds `lock`.
+        Image image() const;
+        // After init() on a snapshot's arena: takes the image's state and
+        // checks it and the region against each other before anything
+        // follows an index from them (see BasicKVStore::load()). Returns
+        // false on any inconsistency. Then frees what was retired, since no
+        // reader of the old process survives, and moves TTL deadlines onto
+        // this process's clock by `shift` ms.
+        bool restore(const Image& image, uint64_t now, int64_t shift);
 
-        Node* head = nullptr;
-        Node* tail = nullptr;
+        std::string_view key_of(uint32_t node) const {
+            return {slab.data(nodes[node].data), nodes[node].key_len};
+        }
+        std::string_view value_of(uint32_t node) const {
+            return {slab.data(nodes[node].data) + nodes[node].key_len, nodes[node].value_len};
+        }
+        bool key_matches(uint32_t node, std::string_view key, size_t hash) const;
+        // On a hit, `distance` is the key's bucket distance from its home.
+        std::optional<size_t> copy_value(std::string_view key, size_t hash, std::span<char> buffer,
+                                         uint32_t& node, size_t& distance) const;
+        // Outcome of one lookup_many() probe. `fallback` means the optimistic
+        // attempts kept racing writers and the caller should take the lock.
+        struct LookupResult {
+            std::optional<size_t> size;
+            uint32_t node = NIL;
+            size_t distance = 0;
+            bool fallback = false;
+        };
+        // copy_value() under the sequence lock as a LookupTask (lookup_task.hpp).
+        template <typename Group>
+        LookupTask lookup(std::string_view key, size_t hash, std::span<char> buffer, LookupResult& result) const;
+        uint32_t allocate_chunk(size_t bytes, uint32_t keep);
+        // Makes the node's value its first `keep` bytes followed by `value`,
+        // under a new version. Returns false, changing nothing, if there is
+        // no room for it.
+        bool store_value(uint32_t node, std::string_view value, size_t keep = 0);
+        void stamp(uint32_t node) { nodes[node].version = ++version_clock; }
 
-        size_t current_size = 0;
+        // Neither the deadline nor the clock is read unless the shard has
+        // entries with a deadline.
+        bool expired(uint32_t node) const {
+            if (timers.empty())
+                return false;
+            uint64_t deadline = timers.deadline(node);
+            return deadline != 0 && deadline <= monotonic_ms();
+        }
+        // Evicts up to `max` expired entries; caller holds `lock` in a write section.
+        size_t expire_due(size_t max);
 
-        void insertToFront(Node* node);
-        void unlink(Node* node);
-        void moveToFront(Node* node);
+        void record_read(uint32_t node, size_t hash);
+        // A hit found under ReadGuard: applied at once if the lock is held
+        // exclusive, recorded like a lock-free read if it is shared.
+        void on_guarded_hit(uint32_t node, size_t hash);
+        void drain_reads();
+        void on_hit(uint32_t node, bool promote);
+        void promote(uint32_t node);
+        bool resident(uint32_t node) const;
+        void admit(uint32_t node);
+        void make_room();
+        uint32_t victim(uint32_t keep);
         void evict();
-        bool erase(std::string_view key, size_t hash);
+        void evict_node(uint32_t node);
+        size_t evict_page(uint32_t page);
+        void detach(uint32_t node);
+        // Sets `buffered` to the WAL buffer's size when logging, for logged().
+        bool erase(std::string_view key, size_t hash, size_t& buffered);
+        // Unlinks the entry at table index idx; caller holds `lock` in a write section.
+        void remove_found(size_t idx);
+        // Pulls in the control bytes and bucket a lookup of `hash` starts at.
+        void prefetch(size_t hash) const {
+            __builtin_prefetch(ctrl + home(hash));
+            __builtin_prefetch(table + home(hash));
+        }
 
-        Node* allocate_node();
-        void free_node(Node* node);
+        uint32_t allocate_node();
+        void free_node(uint32_t node);
+        void retire_node(uint32_t node);
+        // True if the ring has `slots` free for retire_chunk(), after reclaiming.
+        bool can_retire_chunk(size_t slots = 1);
+        void retire_chunk(uint32_t data);
+        void reclaim(uint64_t oldest_pinned);
+        static size_t retired_slots_for(size_t capacity) {
+            return std::max(capacity / RETIRED_CHUNK_SHARE, RETIRED_CHUNKS_MIN);
+        }
         std::pair<bool, size_t> find( std::string_view key, size_t hash) const;
 
-        mutable SpinLock lock;
+        template <typename Group>
+        std::pair<bool, size_t> find_in_groups(std::string_view key, size_t hash) const;
+
+        size_t home(size_t hash) const { return hash & mask; }
+        size_t distance(size_t idx, size_t hash) const { return (idx - home(hash)) & mask; }
+        size_t bucket_distance(size_t idx, uint32_t node) const { return distance(idx, meta[node].hash); }
+        // Bits 25..31: below the 32 bits used for shard selection and, for
+        // tables of up to 2^25 buckets, above the bits used for the home bucket.
+        static uint8_t tag(size_t hash) { return static_cast<uint8_t>((hash >> 25) & 0x7F); }
+        void set_ctrl(size_t idx, uint8_t value);
+        void insert(uint32_t node);
+        void remove_at(size_t idx);
+        size_t locate(uint32_t node) const;
+        void collect_probe_lengths(ProbeHistogram& histogram) const;
+
+        // The lock and the sequence counter get a cache line each: threads
+        // waiting for the lock spin on its line without stealing the one the
+        // holder is writing, and optimistic readers poll `seq` without
+        // contending with either.
+        alignas(64) mutable Lock lock;
+        // What get(), pin() and the get_into() fallback hold: the lock shared
+        // if it can be, otherwise exclusive.
+        using ReadGuard = std::conditional_t<SharedLockable<Lock>, std::shared_lock<Lock>, std::lock_guard<Lock>>;
+        // Bumped around every mutation (under `lock`) for optimistic readers.
+        alignas(64) SeqLock seq;
+        ReadBuffer reads;
+        [[no_unique_address]] Stats stats;
 
     };
 
-    class KVStore
+    // Sharded key-value store. The eviction policy is a compile-time choice:
+    // LruPolicy (the default KVStore), ClockPolicy, SievePolicy or S3FifoPolicy.
+    // So is the shard lock: SpinLock by default, or BackoffLock, AdaptiveLock
+    // or SharedAdaptiveLock. And so is the key hasher: WyHasher by default, or
+    // FnvHasher. And so are statistics: ShardStats by default, or NoStats to
+    // compile them out (see stats.hpp). kv_store.cpp instantiates every
+    // policy with SpinLock, WyHasher and ShardStats, LruPolicy with every
+    // lock, LruPolicy with FnvHasher, and LruPolicy with NoStats.
+    class SnapshotReader;
+    class SharedSegment;
+
+    template <typename Policy, typename Lock = SpinLock, typename Hasher = WyHasher, typename Stats = ShardStats>
+    class BasicKVStore
     {
     public:
-        KVStore() = default;
-        ~KVStore();
+        using ShardType = Shard<Policy, Lock, Stats>;
+
+        // Keys a batch call hashes and sorts at a time, on the stack.
+        static constexpr size_t MULTI_BATCH = 64;
+        static constexpr size_t MAX_INTERLEAVE = 32;
+
+        BasicKVStore();
+        explicit BasicKVStore(const Options& options);
+        ~BasicKVStore();
+
+        BasicKVStore(const BasicKVStore&) = delete;
+        BasicKVStore& operator=(const BasicKVStore&) = delete;
+        BasicKVStore(BasicKVStore&&) = delete;
+        BasicKVStore& operator=(BasicKVStore&&) = delete;
+
+        // Hashes `key` the way this store does. Every single-key call below
+        // has an overload taking the result, so a caller that looks the same
+        // key up repeatedly, or already hashed it for its own routing, pays
+        // for hashing once. The hash must come from this store type's hasher.
+        static HashedKey prehash(std::string_view key) { return {key, Hasher{}(key)}; }
 
-        KVStore(const KVStore&) = delete;
-        KVStore& operator=(const KVStore&) = delete;
-        KVStore(KVStore&&) = delete;
-        KVStore& operator=(KVStore&&) = delete;
+        // Returns false if key + value can never fit in a shard (larger than
+        // max_entry_bytes()), and then any previous value for the key is
+        // dropped. A put that fails for want of room (see pin()) leaves the
+        // previous value in place.
+        bool put(std::string_view key, std::string_view value) { return put(prehash(key), value); }
+        bool put(HashedKey key, std::string_view value) { return put_until(key, value, 0); }
+        // put() for an entry that expires `ttl` from now, give or take the
+        // coarse clock's tick (see monotonic_ms()): reads miss from then on,
+        // and the shard reclaims it before evicting anything live. A plain
+        // put() of the key clears its TTL. Needs Options::expiry
+        // (std::logic_error otherwise); ttl must be positive.
+        bool put(std::string_view key, std::string_view value, std::chrono::milliseconds ttl) {
+            return put(prehash(key), value, ttl);
+        }
+        bool put(HashedKey key, std::string_view value, std::chrono::milliseconds ttl);
+        // The view points into shard memory and is only valid until the next
+        // write to that shard; concurrent readers should use get_into() or pin().
+        std::optional<std::string_view> get(std::string_view key) { return get(prehash(key)); }
+        std::optional<std::string_view> get(HashedKey key);
+        // Zero-copy read that stays valid until the handle is released, whatever
+        // writers do meanwhile. Empty handle on a miss. Release handles
+        // promptly: a chunk a handle was given is freed only once no handle
+        // older than its replacement is left, and while a shard holds
+        // retired_slots_for(capacity) of them, overwrites of pinned entries
+        // return false.
+        ValueHandle pin(std::string_view key) { return pin(prehash(key)); }
+        ValueHandle pin(HashedKey key);
+        // Lock-free optimistic read: probes the shard without locking, copies
+        // the value into `buffer` and retries if a writer touched the shard in
+        // the meantime (falling back to the lock after a few attempts).
+        // Returns the value's full size, which may exceed buffer.size(); only
+        // the first buffer.size() bytes are copied then.
+        std::optional<size_t> get_into(std::string_view key, std::span<char> buffer) {
+            return get_into(prehash(key), buffer);
+        }
+        std::optional<size_t> get_into(HashedKey key, std::span<char> buffer) { return read_into(key, buffer, nullptr); }
+        // Same, growing `out` to fit. Returns false on a miss.
+        bool get_into(std::string_view key, std::string& out) { return get_into(prehash(key), out); }
+        bool get_into(HashedKey key, std::string& out);
+        // get_into() that also sets `version` to the entry's version, for
+        // compare_and_swap(). Every write of a value gives it a new version.
+        std::optional<size_t> get_versioned(std::string_view key, std::span<char> buffer, uint64_t& version) {
+            return get_versioned(prehash(key), buffer, version);
+        }
+        std::optional<size_t> get_versioned(HashedKey key, std::span<char> buffer, uint64_t& version) {
+            return read_into(key, buffer, &version);
+        }
+        bool get_versioned(std::string_view key, std::string& out, uint64_t& version) {
+            return get_versioned(prehash(key), out, version);
+        }
+        bool get_versioned(HashedKey key, std::string& out, uint64_t& version);
+        // Batched get(): values[i] receives a copy of keys[i]'s value, or
+        // nullopt on a miss (values.size() must be at least keys.size()).
+        // Keys are hashed up front and grouped by shard, and each shard is
+        // locked once per group of up to MULTI_BATCH keys. Returns the hits.
+        size_t multi_get(std::span<const std::string_view> keys, std::span<std::optional<std::string>> values);
+        // Batched put(), grouped the same way. Returns how many entries were
+        // stored; an entry that can never fit drops the key, as put() does.
+        size_t multi_put(std::span<const std::pair<std::string_view, std::string_view>> entries);
+        // multi_get() for tables larger than the cache: keeps `depth` lookups
+        // (at most MAX_INTERLEAVE) in flight on the calling thread, each one
+        // a coroutine that prefetches its next bucket, node or key and yields
+        // to the others, so their memory stalls overlap. Lookups are lock-free
+        // like get_into(), with the same lock fallback. Returns the hits.
+        size_t lookup_many(std::span<const std::string_view> keys, std::span<std::optional<std::string>> values,
+                           size_t depth = 8);
+        bool erase(std::string_view key) { return erase(prehash(key)); }
+        bool erase(HashedKey key);
 
-        void put( std::string_view key,  std::string_view value);
-         std::optional<std::string_view> get( std::string_view key);
-        bool erase(std::string_view key);
+        // Read-modify-write. Each call finds the key with one probe under
+        // one hold of the shard lock and writes it in the same hold, so it
+        // is atomic against every other write, where get() then put() takes
+        // the lock twice and can lose a concurrent update. None of them
+        // changes the entry's TTL. An expired entry counts as absent.
+        //
+        // Stores `value` only if the entry's version is still `version`
+        // (from get_versioned() or an earlier call). Sets `version` to the
+        // new version on Ok, to the current one on Mismatch, and to 0 on
+        // NotFound, so a retry loop need not read the key again.
+        RmwStatus compare_and_swap(std::string_view key, uint64_t& version, std::string_view value) {
+            return compare_and_swap(prehash(key), version, value);
+        }
+        RmwStatus compare_and_swap(HashedKey key, uint64_t& version, std::string_view value);
+        // Adds `delta` to a value holding a decimal uint64_t, wrapping at
+        // 2^64, and stores `result` back as text (memcached's incr). On a
+        // miss, stores `initial` instead if one is given, without a TTL.
+        RmwStatus incr(std::string_view key, uint64_t delta, uint64_t& result,
+                       std::optional<uint64_t> initial = std::nullopt) {
+            return incr(prehash(key), delta, result, initial);
+        }
+        RmwStatus incr(HashedKey key, uint64_t delta, uint64_t& result, std::optional<uint64_t> initial = std::nullopt) {
+            return add(key, delta, false, result, initial);
+        }
+        // incr() that subtracts, stopping at 0 rather than wrapping.
+        RmwStatus decr(std::string_view key, uint64_t delta, uint64_t& result,
+                       std::optional<uint64_t> initial = std::nullopt) {
+            return decr(prehash(key), delta, result, initial);
+        }
+        RmwStatus decr(HashedKey key, uint64_t delta, uint64_t& result, std::optional<uint64_t> initial = std::nullopt) {
+            return add(key, delta, true, result, initial);
+        }
+        // Adds `suffix` to the end of the value, in place when the chunk has
+        // room for it and no ValueHandle is out. NotFound on a miss.
+        RmwStatus append(std::string_view key, std::string_view suffix) { return append(prehash(key), suffix); }
+        RmwStatus append(HashedKey key, std::string_view suffix);
+        // Stores `value` and copies the value it replaces into `previous`.
+        // NotFound means `value` was stored as a new entry (previous is
+        // left empty); NotStored that it cannot fit, in which case the key
+        // keeps any old value, still copied to `previous`.
+        RmwStatus get_and_set(std::string_view key, std::string_view value, std::string& previous) {
+            return get_and_set(prehash(key), value, previous);
+        }
+        RmwStatus get_and_set(HashedKey key, std::string_view value, std::string& previous);
+        // Reclaims every expired entry now, EXPIRE_BATCH per shard lock hold;
+        // what the Options::expiry_interval thread runs. Returns how many.
+        size_t expire();
+        // Entries held, including expired ones not reclaimed yet.
         size_t size() const;
+        // size() without locking: a relaxed read of each shard's count, so
+        // writes in flight may or may not show.
+        size_t approximate_size() const;
+        size_t capacity() const;
+        size_t shard_count() const;
+        size_t memory_budget() const;
+        // Largest key + value a put() takes: the slab page size, which
+        // memory_budget() picks (see SlabAllocator::page_size_for()).
+        size_t max_entry_bytes() const { return shards[0].slab.max_allocation(); }
+        MemoryUsage memory_usage() const;
+        // Index of the shard that holds `key`.
+        size_t shard_of(std::string_view key) const;
+        size_t shard_of(HashedKey key) const { return shard_index(key.hash); }
+        // The NUMA node shard `shard`'s memory was placed on with
+        // NumaPlacement::PerShard (0 on a single-node machine), -1 otherwise.
+        // Threads run on that node (numa_run_on_node()) and given only keys
+        // whose shard_of() is there never touch another node's memory.
+        int shard_node(size_t shard) const;
+
+        // Writes the store to `path` (see snapshot.hpp), replacing it
+        // atomically. Each shard is locked only while its arena region is
+        // copied to a buffer, so the result is consistent per shard, not
+        // across shards; the file is written with no lock held. Pending
+        // read promotions are applied first. Throws std::system_error on
+        // I/O failure.
+        void snapshot(const std::string& path);
+        // A store holding what snapshot() saved, in the same eviction order
+        // and with the same Options (expiry_interval included), TTLs still
+        // counting down from when the snapshot was taken. The file is mapped
+        // copy-on-write rather than read, and only the index is validated,
+        // so loading costs a pass over the index instead of a put() per
+        // entry; values are paged in as they are read. The store type must
+        // match the one that wrote it (the Lock may differ). Throws
+        // std::runtime_error on a mismatched or corrupt file.
+        static std::unique_ptr<BasicKVStore> load(const std::string& path);
+
+        // Durable mode (Options::wal_path) only; std::logic_error otherwise.
+        // sync() commits the log now and returns once every write made
+        // before the call is on disk; it rethrows the std::system_error of
+        // the last failed commit, including one on the commit thread.
+        void sync();
+        // Snapshots the store to `<wal_path>.snap` and empties the log, as
+        // construction does after a replay. Writes carry on meanwhile;
+        // commits wait for it.
+        void compact();
+
+        // Contention on the shard locks so far, summed over shards.
+        LockCounters lock_counters() const;
+        // Counters since construction, summed over shards without locking
+        // (see stats.hpp). With NoStats, only `locks` and `entries` are set.
+        StoreStats stats() const;
+
+        // Walks every table under its shard lock; meant for diagnostics and benchmarks.
+        ProbeHistogram probe_histogram() const;
 
 
     private:
 
-        Shard shards[NUM_SHARDS];
-        static size_t fnv1a( std::string_view key) ;
+        BasicKVStore(const Options& options, const SnapshotReader* snapshot);
+        // `<wal_path>.snap` if it exists, for the public constructor.
+        static std::unique_ptr<SnapshotReader> open_snapshot(const Options& options);
+        // Creates or attaches to the Options::shared_name segment for a
+        // store whose arena takes `arena_bytes`, and points `common`, `shards`
+        // and `arena` into it. Returns true if this store created it and so
+        // must initialize the shards.
+        bool open_shared(const Options& options, size_t arena_bytes);
 
+        // `compacting` drops what each shard's log buffer holds as its region
+        // is copied, since the snapshot then contains it.
+        void write_snapshot(const std::string& path, uint64_t generation, bool compacting);
+        // Replays the log over the store, compacts if it held anything and
+        // starts logging. `generation` is the snapshot's.
+        void open_log(const Options& options, uint64_t generation);
+        // Group commit: takes every shard's buffer, writes them in one go
+        // and fdatasyncs. Serialized by wal_mutex.
+        void commit_log();
+        // Called with the size of a shard's buffer after a write logged to it.
+        void logged(size_t buffered);
+        // A TTL deadline in wall-clock ms for the log, 0 for none.
+        static int64_t wall_deadline(uint64_t deadline);
+
+        ShardType& shard_for(size_t hash);
+        size_t shard_index(size_t hash) const { return ((hash >> 32) * num_shards) >> 32; }
+        // `deadline` is in monotonic_ms() ticks, 0 for none.
+        bool put_until(HashedKey key, std::string_view value, uint64_t deadline);
+        bool put_locked(ShardType& shard, std::string_view key, std::string_view value, size_t hash,
+                        uint64_t deadline);
+        // The insert half of put_locked(), for a key the shard does not
+        // hold. Returns the new node, NIL if there was no room.
+        uint32_t insert_locked(ShardType& shard, std::string_view key, std::string_view value, size_t hash,
+                               uint64_t deadline);
+        // get_into(), and get_versioned() when `version` is set.
+        std::optional<size_t> read_into(HashedKey key, std::span<char> buffer, uint64_t* version);
+        // The frame of every read-modify-write call: takes the shard lock in
+        // a write section, finds the key's live entry (NIL if none) and hands
+        // it to `update(shard, node, written)`, which sets `written` to the
+        // node it stored, if any; that write is then logged in durable mode.
+        template <typename Update>
+        RmwStatus modify(HashedKey key, Update&& update);
+        RmwStatus add(HashedKey key, uint64_t delta, bool subtract, uint64_t& result, std::optional<uint64_t> initial);
+        size_t plan_batch(std::span<const std::string_view> keys, size_t* hashes, uint64_t* order) const;
+
+        size_t num_shards = 0;
+        size_t total_capacity = 0;
+        size_t total_budget = 0;
+        // What every process sharing the store must see one copy of, shards
+        // aside: in the segment in multi-process mode, in `own_common`
+        // otherwise.
+        struct Common {
+            EpochDomain epochs;
+        };
 
+        // Multi-process mode (Options::shared_name): the segment that holds
+        // `common`, the shards and the arena. Declared before them so that
+        // it is unmapped last.
+        std::unique_ptr<SharedSegment> segment;
+        Arena arena;
+        Common* common = nullptr;
+        std::unique_ptr<Common> own_common;
+        ShardType* shards = nullptr;
+        std::unique_ptr<ShardType[]> own_shards;
+        // NumaPlacement::PerShard only: each shard's node.
+        std::vector<int> shard_nodes;
+        // Kept for snapshot().
+        double load_factor = DEFAULT_LOAD_FACTOR;
+        NumaPlacement numa = NumaPlacement::None;
+        bool expiry = false;
+        std::chrono::milliseconds expiry_interval{0};
+        // Durable mode.
+        bool durable = false;
+        std::string wal_path;
+        size_t wal_shard_bytes = 0;
+        uint64_t wal_generation = 0;
+        std::unique_ptr<WriteAheadLog> wal;
+        // Held across a commit or compaction; guards what follows.
+        std::mutex wal_mutex;
+        std::unique_ptr<WalBuffer[]> wal_batch;
+        std::exception_ptr wal_failure;
+        std::atomic<bool> commit_requested{false};
+        // Options::expiry_interval and the durable mode's commit thread.
+        // Declared last so that they stop before the shards go away.
+        std::mutex maintenance_mutex;
+        std::condition_variable_any maintenance_wake;
+        std::jthread maintenance;
+        std::mutex commit_mutex;
+        std::condition_variable_any commit_wake;
+        std::jthread committer;
     };
 
+    extern template class BasicKVStore<LruPolicy>;
+    extern template class BasicKVStore<ClockPolicy>;
+    extern template class BasicKVStore<SievePolicy>;
+    extern template class BasicKVStore<S3FifoPolicy>;
+    extern template class BasicKVStore<LruPolicy, BackoffLock>;
+    extern template class BasicKVStore<LruPolicy, AdaptiveLock>;
+    extern template class BasicKVStore<LruPolicy, SharedAdaptiveLock>;
+    extern template class BasicKVStore<LruPolicy, SpinLock, FnvHasher>;
+    extern template class BasicKVStore<LruPolicy, SpinLock, WyHasher, NoStats>;
 
+    using KVStore = BasicKVStore<LruPolicy>;
+    using ClockKVStore = BasicKVStore<ClockPolicy>;
+    using SieveKVStore = BasicKVStore<SievePolicy>;
+    using S3FifoKVStore = BasicKVStore<S3FifoPolicy>;
 
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+namespace kvstore {
+
+    // One lookup of BasicKVStore::lookup_many(), written as a coroutine that
+    // suspends right after prefetching the next line it will touch (control
+    // bytes and bucket, node, key bytes). The caller keeps several in flight
+    // and resumes them round-robin, so each one's cache miss is served while
+    // the others run. Starts suspended; resume() until done().
+    //
+    // Frames come from a per-thread free list of FRAME_BYTES blocks (larger
+    // frames fall back to operator new), so a warmed-up thread allocates
+    // nothing per lookup.
+    class LookupTask {
+    public:
+        static constexpr size_t FRAME_BYTES = 512;
+
+        struct promise_type {
+            LookupTask get_return_object() {
+                return LookupTask(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+
+            static void* operator new(size_t bytes);
+            static void operator delete(void* frame, size_t bytes);
+        };
+
+        LookupTask() = default;
+        LookupTask(LookupTask&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+        LookupTask& operator=(LookupTask&& other) noexcept {
+            if (this != &other) {
+                if (handle)
+                    handle.destroy();
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+        LookupTask(const LookupTask&) = delete;
+        LookupTask& operator=(const LookupTask&) = delete;
+        ~LookupTask() {
+            if (handle)
+                handle.destroy();
+        }
+
+        void resume() { handle.resume(); }
+        bool done() const { return handle.done(); }
+        explicit operator bool() const { return static_cast<bool>(handle); }
+
+    private:
+        explicit LookupTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    // co_await Prefetch{a, b}: prefetch up to two lines, then yield to the
+    // next lookup in flight.
+    struct Prefetch {
+        const void* first;
+        const void* second = nullptr;
+
+        bool await_ready() const noexcept {
+            __builtin_prefetch(first);
+            if (second)
+                __builtin_prefetch(second);
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        void await_resume() const noexcept {}
+    };
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "kv_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace kvstore {
+
+    // The server side of the memcached text protocol, as far as kvstore_server
+    // speaks it:
+    //
+    //   get <key>+                                  VALUE <key> <flags> <bytes>\r\n<data>\r\n ... END\r\n
+    //   gets <key>+                                 the same with " <cas>" after <bytes>: the entry's version
+    //   set <key> <flags> <exptime> <bytes> [noreply]\r\n<data>\r\n   STORED\r\n
+    //   delete <key> [noreply]                      DELETED\r\n or NOT_FOUND\r\n
+    //   quit                                        closes the connection
+    //
+    // Anything else is answered with ERROR, a malformed request with
+    // CLIENT_ERROR <reason>. An entry's value is its 4 flag bytes followed
+    // by the data, so `set` stores the client's flags without a copy (see
+    // McRequest::data). exptime follows memcached: seconds from now, a Unix
+    // time if above MC_RELATIVE_EXPTIME, already expired if negative.
+    static constexpr size_t MC_MAX_KEY = 250;
+    // A command line with no newline within this many bytes closes the connection.
+    static constexpr size_t MC_MAX_LINE = 2048;
+    static constexpr size_t MC_MAX_VALUE = 1 << 20;
+    static constexpr int64_t MC_RELATIVE_EXPTIME = 60 * 60 * 24 * 30;
+    static constexpr size_t MC_FLAG_BYTES = sizeof(uint32_t);
+
+    enum class McCommand : uint8_t { Get, Gets, Set, Delete, Quit };
+
+    // One parsed request. Every view points into the input it was parsed
+    // from; nothing is copied.
+    struct McRequest {
+        McCommand command = McCommand::Get;
+        // get/gets: all the keys, separated by spaces; set/delete: the key.
+        std::string_view keys;
+        uint32_t flags = 0;
+        int64_t exptime = 0;
+        // set: the data block. The MC_FLAG_BYTES before it are the end of
+        // the command line, already parsed, which McSession overwrites with
+        // the flags to store them in front of the data in place.
+        char* data = nullptr;
+        size_t bytes = 0;
+        bool noreply = false;
+        // ClientError and Fatal: what to tell the client.
+        const char* error = nullptr;
+    };
+
+    enum class McParse : uint8_t {
+        Incomplete,   // the request has not all arrived; nothing consumed
+        Request,      // `request` describes it
+        Error,        // unknown command: reply ERROR
+        ClientError,  // malformed: reply CLIENT_ERROR and go on after it
+        Fatal,        // no newline within MC_MAX_LINE: reply CLIENT_ERROR and close
+    };
+
+    // Parses the request at the front of [begin, end) and sets `consumed`
+    // to its length in bytes, data block included (0 if Incomplete).
+    McParse parse_request(char* begin, char* end, McRequest& request, size_t& consumed);
+
+    // A connection's responses, queued for writev(). Fixed replies (STORED,
+    // END, ...) are queued by reference and never copied; VALUE lines and
+    // values go in one buffer that values are copied into straight from the
+    // store (get_into()) and that is reused once everything has been sent.
+    class McOutput {
+    public:
+        // `text` must outlive the output: a string literal.
+        void append_constant(std::string_view text);
+        // Copies `text` into the buffer and queues it.
+        void append_copy(std::string_view text);
+        // At least `bytes` of free buffer space to fill before commit().
+        char* space(size_t bytes);
+        size_t space_bytes() const { return capacity - used; }
+        // Takes `bytes` of the space as filled and returns their offset;
+        // queue() then sends [offset, offset + length) of the buffer.
+        size_t commit(size_t bytes);
+        void queue(size_t offset, size_t length);
+
+        size_t pending_bytes() const { return pending; }
+        bool empty() const { return pending == 0; }
+        // The first unsent bytes as up to `max` iovecs; returns how many.
+        size_t gather(iovec* iov, size_t max) const;
+        // Drops the first `bytes` unsent bytes after a write.
+        void consume(size_t bytes);
+
+    private:
+        struct Segment {
+            const char* constant;  // null: `offset` into the buffer
+            size_t offset;
+            size_t length;
+        };
+
+        std::unique_ptr<char[]> buffer;
+        size_t capacity = 0;
+        size_t used = 0;
+        std::vector<Segment> segments;
+        size_t first = 0;       // segments before it are sent
+        size_t first_sent = 0;  // bytes of segments[first] sent
+        size_t pending = 0;
+    };
+
+    // One connection's protocol state: runs the requests that arrive on it
+    // against a store and queues the responses. exptime needs a store with
+    // Options::expiry; without it, a set with one fails with SERVER_ERROR.
+    class McSession {
+    public:
+        explicit McSession(KVStore& store) : store(&store) {}
+
+        // Runs the complete requests at the front of [begin, end) and returns
+        // how many bytes they took; the rest is an incomplete request. May
+        // write into the range (see McRequest::data). Stops early once the
+        // output holds `max_output` bytes or more, and after quit or a
+        // fatal error, when closing() turns true.
+        size_t execute(char* begin, char* end, size_t max_output = SIZE_MAX);
+
+        McOutput& output() { return out; }
+        bool closing() const { return close_requested; }
+
+    private:
+        void get(std::string_view keys, bool with_cas);
+        void set(const McRequest& request);
+        void reply(bool noreply, std::string_view text);
+
+        KVStore* store;
+        McOutput out;
+        bool close_requested = false;
+    };
+}
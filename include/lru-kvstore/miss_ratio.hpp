@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace kvstore {
+
+    // Miss-ratio curve of an LRU cache, estimated in one pass with SHARDS
+    // (Waldspurger et al., "Efficient MRC Construction with SHARDS", FAST
+    // '15). Only keys whose hash falls below sampling_rate * 2^64 are
+    // tracked. For each of those accesses the exact reuse distance among
+    // sampled keys is computed, which is the number of distinct sampled keys
+    // accessed since the previous access to the same key. Scaled by
+    // 1 / sampling_rate, it estimates the reuse distance in the full trace,
+    // and an LRU cache of C entries hits exactly the accesses with a reuse
+    // distance below C. Memory and time grow with the sampled keys only.
+    //
+    // This models one global LRU. A store's per-shard queues and policies
+    // only approximate it (compare with the store's own hit ratio). Not
+    // thread-safe.
+    class MissRatioCurve {
+    public:
+        explicit MissRatioCurve(double sampling_rate = 0.01);
+
+        // `hash` must be a well-mixed 64-bit hash of the key. Every access
+        // is passed in; unsampled ones are only counted.
+        void access(uint64_t hash);
+        void erase(uint64_t hash);
+
+        // Estimated miss ratio of an LRU cache of `capacity` entries over
+        // the accesses so far: 1 if there were none.
+        double miss_ratio(size_t capacity) const;
+
+        uint64_t accesses() const { return total; }
+        uint64_t sampled_accesses() const { return sampled; }
+        size_t sampled_keys() const { return last_access.size(); }
+
+    private:
+        bool is_sampled(uint64_t hash) const { return hash < threshold || threshold == UINT64_MAX; }
+        // Fenwick tree over access times: a 1 at each sampled key's latest.
+        void mark(uint64_t time, int delta);
+        uint64_t marks_up_to(uint64_t time) const;
+        // Renumbers the live marks 1..n once the clock reaches the tree's end.
+        void compact();
+
+        double rate;
+        uint64_t threshold;
+        std::unordered_map<uint64_t, uint64_t> last_access;  // hash -> time
+        std::vector<int64_t> tree;
+        uint64_t clock = 0;
+        // distances[d]: sampled accesses with a reuse distance of d.
+        std::vector<uint64_t> distances;
+        uint64_t sampled = 0;
+        uint64_t total = 0;
+    };
+}
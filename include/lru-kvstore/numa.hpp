@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+namespace kvstore {
+
+    // NUMA helpers behind Options::numa, for callers too: they talk to the
+    // kernel directly (sysfs, mbind, sched_setaffinity) rather than through
+    // libnuma. On a machine with one node they report that node and place
+    // nothing, and so does a kernel that refuses (built without NUMA, or
+    // seccomp in a container).
+
+    // Memory is placed in pages of this size, so placed regions start on one.
+    static constexpr size_t NUMA_PAGE_BYTES = 4096;
+
+    // Nodes the kernel has online (the highest id + 1), at least 1.
+    size_t numa_node_count();
+    // The node of the CPU the calling thread is running on, 0 if unknown.
+    int numa_current_node();
+    // Asks for the pages of [memory, memory + bytes) to be allocated on
+    // `node` (MPOL_PREFERRED: another node if it is out of memory), or
+    // interleaved over every node. Only affects pages not yet touched;
+    // `memory` must be page-aligned. False if nothing was placed.
+    bool numa_bind(const void* memory, size_t bytes, int node);
+    bool numa_interleave(const void* memory, size_t bytes);
+    // Restricts the calling thread to the CPUs of `node`. False if the node
+    // has no CPUs or the kernel refused.
+    bool numa_run_on_node(int node);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace kvstore {
+
+    // Control bytes: one per bucket. EMPTY has the high bit set; an occupied
+    // bucket holds a 7-bit fragment of its hash, so a group of them can be
+    // compared against a key's tag in one instruction.
+    static constexpr uint8_t CTRL_EMPTY = 0x80;
+
+    // The control array is mirrored this many bytes past its end so a group
+    // load starting at any bucket never has to wrap.
+    static constexpr size_t MAX_GROUP_WIDTH = 32;
+
+    // Each group type loads WIDTH control bytes and returns bitmasks with one
+    // set bit per matching bucket, in bucket order; index() turns the lowest
+    // set bit back into an offset within the group.
+
+    // Portable fallback: eight buckets per 64-bit word (SWAR).
+    struct ScalarGroup {
+        static constexpr size_t WIDTH = 8;
+        static constexpr int STRIDE = 8;
+
+        static constexpr uint64_t LSBS = 0x0101010101010101ull;
+        static constexpr uint64_t MSBS = 0x8080808080808080ull;
+
+        uint64_t word;
+
+        explicit ScalarGroup(const uint8_t* ctrl) { std::memcpy(&word, ctrl, sizeof(word)); }
+
+        // May report a false positive in a byte above a genuine match (borrow
+        // propagation); callers verify every candidate against the bucket.
+        uint64_t match(uint8_t tag) const {
+            uint64_t x = word ^ (LSBS * tag);
+            return (x - LSBS) & ~x & MSBS;
+        }
+
+        uint64_t match_empty() const { return word & MSBS; }
+
+        static size_t index(uint64_t mask) { return std::countr_zero(mask) / STRIDE; }
+    };
+
+#if defined(__AVX2__)
+    struct SimdGroup {
+        static constexpr size_t WIDTH = 32;
+        static constexpr int STRIDE = 1;
+
+        __m256i ctrl;
+
+        explicit SimdGroup(const uint8_t* p)
+            : ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) {}
+
+        uint64_t match(uint8_t tag) const {
+            auto eq = _mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8(static_cast<char>(tag)));
+            return static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+        }
+
+        uint64_t match_empty() const { return static_cast<uint32_t>(_mm256_movemask_epi8(ctrl)); }
+
+        static size_t index(uint64_t mask) { return std::countr_zero(mask); }
+    };
+#elif defined(__SSE2__)
+    struct SimdGroup {
+        static constexpr size_t WIDTH = 16;
+        static constexpr int STRIDE = 1;
+
+        __m128i ctrl;
+
+        explicit SimdGroup(const uint8_t* p)
+            : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+        uint64_t match(uint8_t tag) const {
+            auto eq = _mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(tag)));
+            return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+        }
+
+        // EMPTY is the only control value with the high bit set.
+        uint64_t match_empty() const { return static_cast<uint32_t>(_mm_movemask_epi8(ctrl)); }
+
+        static size_t index(uint64_t mask) { return std::countr_zero(mask); }
+    };
+#else
+    using SimdGroup = ScalarGroup;
+#endif
+
+    static_assert(SimdGroup::WIDTH <= MAX_GROUP_WIDTH);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace kvstore {
+
+    // Lossy record of recent reads, drained in batches by whoever holds the
+    // shard lock (Caffeine-style read buffers). Readers append to one of a few
+    // striped rings with plain stores, no read-modify-write; a ring that
+    // overflows before it is drained, or two readers racing for one slot,
+    // simply lose entries, which only costs some recency precision. Entries are opaque 64-bit values: the caller
+    // validates each one when it drains, since it may be stale by then.
+    class ReadBuffer {
+    public:
+        static constexpr size_t STRIPES = 4;
+        static constexpr size_t SLOTS = 32;                 // per stripe, power of two
+        static constexpr size_t DRAIN_THRESHOLD = SLOTS / 2;
+
+        // Returns true once the caller's stripe holds DRAIN_THRESHOLD or more
+        // undrained entries, i.e. when it should try to take the lock and drain.
+        bool record(uint64_t entry);
+
+        // Caller holds the shard lock. Calls fn(entry) for every recorded entry
+        // still in the rings, oldest first per stripe.
+        template <typename Fn>
+        void drain(Fn&& fn) {
+            for (Stripe& stripe : stripes) {
+                uint32_t write = stripe.write.load(std::memory_order_acquire);
+                uint32_t read = stripe.read.load(std::memory_order_relaxed);
+                if (write - read > SLOTS)
+                    read = write - static_cast<uint32_t>(SLOTS);
+                for (; read != write; ++read)
+                    fn(stripe.entries[read % SLOTS].load(std::memory_order_relaxed));
+                stripe.read.store(write, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        struct alignas(64) Stripe {
+            std::atomic<uint32_t> write{0};
+            std::atomic<uint32_t> read{0};      // advanced only by the drainer
+            std::atomic<uint64_t> entries[SLOTS] = {};
+        };
+
+        Stripe stripes[STRIPES];
+    };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "kv_store.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kvstore {
+
+    struct ServerOptions {
+        std::string address = "127.0.0.1";
+        // 0 = any free port; port() reports which.
+        uint16_t port = 11211;
+        size_t threads = 4;
+        // A connection whose unsent responses reach this many bytes stops
+        // reading requests until the client has taken some (backpressure).
+        size_t max_output = 4 << 20;
+    };
+
+    // A TCP server speaking the memcached text protocol (see memcached.hpp)
+    // over a store. Each worker thread has a listening socket of its own on
+    // the same port (SO_REUSEPORT, so the kernel spreads connections over
+    // them) and an epoll instance that it waits on, edge-triggered, for the
+    // connections it accepted; a connection stays on one thread.
+    //
+    // Per wakeup, a connection reads what arrived into its input buffer,
+    // runs every complete request in it, and sends all the responses with
+    // one writev(), so a client that pipelines N requests costs about one
+    // read and one write, not N of each. Buffers are per connection and
+    // reused; values are copied once, from the store into the output buffer.
+    //
+    // The constructor binds and starts the workers; it throws
+    // std::system_error if it cannot. The destructor stops them and closes
+    // every connection. The store must outlive the server.
+    class Server {
+    public:
+        Server(KVStore& store, const ServerOptions& options);
+        ~Server();
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+
+        uint16_t port() const { return bound_port; }
+        // Stops accepting, closes every connection and joins the workers.
+        void stop();
+
+    private:
+        struct Worker;
+
+        KVStore* store;
+        size_t max_output;
+        uint16_t bound_port = 0;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<std::jthread> threads;
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace kvstore {
+
+    static constexpr uint64_t SHARED_MAGIC = 0x314d48535653564bull;  // "KVSVSHM1"
+    static constexpr uint32_t SHARED_VERSION = 4;
+    // How long attach() waits for a segment's creator to finish setting it up.
+    static constexpr std::chrono::milliseconds SHARED_ATTACH_TIMEOUT{5000};
+
+    // First page of a shared segment (see Options::shared_name):
+    //
+    //   header | store-wide state | shards | arena
+    //
+    // Every process maps the segment at the address its creator chose, so
+    // the shards' pointers into the arena, and into each other, hold in all
+    // of them; the arena itself keeps only indices and offsets. The fields
+    // below the address let an attaching store check that it was built the
+    // same way: same binary types, same layout-determining Options.
+    struct SharedHeader {
+        enum : uint32_t { Building = 0, Ready = 1, Failed = 2 };
+
+        uint64_t magic = SHARED_MAGIC;
+        uint32_t version = SHARED_VERSION;
+        // Building until the creator publishes the segment.
+        std::atomic<uint32_t> status{Building};
+        uint64_t address = 0;
+        uint64_t bytes = 0;
+
+        char policy[64] = {};           // typeid names of the store's Policy,
+        char lock[64] = {};             // Lock and Hasher
+        char hasher[64] = {};
+        uint64_t shard_bytes = 0;       // sizeof(Shard), a layout check
+
+        uint64_t capacity = 0;
+        uint64_t memory_budget = 0;
+        uint64_t num_shards = 0;
+        double load_factor = 0;
+        uint8_t probe_kernel = 0;
+        uint8_t promote_on_read = 0;
+        uint8_t admission = 0;
+        uint8_t expiry = 0;
+
+        uint64_t state_offset = 0;
+        uint64_t shards_offset = 0;
+        uint64_t arena_offset = 0;
+        uint64_t arena_bytes = 0;
+    };
+
+    // A named POSIX shared memory object (shm_open) mapped read-write at one
+    // fixed address. The object outlives every process that maps it until
+    // unlink(). Throws std::system_error on a failed system call and
+    // std::runtime_error on a segment that cannot be used.
+    class SharedSegment {
+    public:
+        // Creates segment `name` (a single path component, as shm_open
+        // wants it) with `bytes` zero bytes and an initialized header, still
+        // Building. Returns null if the name already exists. Until
+        // publish(), destroying the segment unlinks it again.
+        static std::unique_ptr<SharedSegment> create(const std::string& name, size_t bytes);
+        // Maps an existing segment once its creator has published it. Null
+        // if `name` does not exist.
+        static std::unique_ptr<SharedSegment> attach(const std::string& name);
+        // Removes `name`; processes that have it mapped keep their mapping.
+        // Returns false if there was no such segment.
+        static bool unlink(const std::string& name);
+
+        ~SharedSegment();
+
+        SharedSegment(const SharedSegment&) = delete;
+        SharedSegment& operator=(const SharedSegment&) = delete;
+
+        SharedHeader& header() const { return *reinterpret_cast<SharedHeader*>(base); }
+        std::byte* data() const { return base; }
+        size_t size() const { return bytes; }
+        bool created() const { return owner; }
+        // Marks the segment Ready for attach().
+        void publish();
+
+    private:
+        SharedSegment(std::string name, std::byte* base, size_t bytes, bool owner)
+            : name(std::move(name)), base(base), bytes(bytes), owner(owner) {}
+
+        std::string name;
+        std::byte* base = nullptr;
+        size_t bytes = 0;
+        bool owner = false;
+        bool published = false;
+    };
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kvstore {
+
+    // Largest slab page, and so the largest key + value any store takes.
+    static constexpr size_t SLAB_PAGE_SIZE = 64 * 1024;
+    static constexpr size_t SLAB_MIN_PAGE_SIZE = 8 * 1024;
+    // Pages a budget is split into before the page size drops below
+    // SLAB_PAGE_SIZE (see page_size_for()).
+    static constexpr size_t SLAB_MIN_PAGES = 8;
+    static constexpr size_t SLAB_MIN_CHUNK = 16;
+
+    // Per-shard slab allocator for key/value bytes. The shard's byte budget is
+    // split into fixed-size pages; a page is handed to one size class on demand
+    // and carved into equal chunks. Classes grow by ~1.25x, so a chunk wastes at
+    // most about a fifth of its size. Chunks are addressed by their byte offset
+    // from the slab base, so nothing here stores a raw pointer. A page whose
+    // chunks are all freed goes back to the free-page list and can be reused
+    // by any class. No system allocator call happens after init().
+    class SlabAllocator {
+    public:
+        static constexpr uint32_t NONE = UINT32_MAX;
+        static constexpr size_t MAX_CLASSES = 48;
+
+        // The page size for a budget: the largest power of two up to
+        // SLAB_PAGE_SIZE that still splits it into SLAB_MIN_PAGES pages, and
+        // at least SLAB_MIN_PAGE_SIZE. Small budgets get small pages, so a
+        // new size class costs them a page of 8 KiB, not 64.
+        static size_t page_size_for(size_t budget_bytes);
+        // Number of pages of `page_bytes` for a budget; every slab gets at
+        // least two so any entry up to a page always fits once the rest of
+        // the shard is evicted.
+        static size_t pages_for(size_t budget_bytes, size_t page_bytes = SLAB_PAGE_SIZE);
+        static size_t storage_bytes(size_t pages, size_t page_bytes = SLAB_PAGE_SIZE);
+
+        void init(Arena& arena, size_t pages, size_t page_bytes = SLAB_PAGE_SIZE);
+
+        // Returns the chunk offset, or NONE if no chunk of a fitting class is
+        // free and no page is left to start one.
+        uint32_t allocate(size_t bytes);
+        void free(uint32_t offset);
+
+        char* data(uint32_t offset) { return reinterpret_cast<char*>(base + offset); }
+        const char* data(uint32_t offset) const { return reinterpret_cast<const char*>(base + offset); }
+
+        // Bounds check for offsets read without the shard lock.
+        bool contains(uint32_t offset, size_t bytes) const {
+            size_t total = total_bytes();
+            return offset < total && bytes <= total - offset;
+        }
+
+        // Usable size of the chunk at offset (its class size).
+        size_t chunk_size(uint32_t offset) const;
+        // True if an allocate(bytes) would take its chunk from the class
+        // that the chunk at offset belongs to.
+        bool same_class(uint32_t offset, size_t bytes) const;
+
+        // Page reassignment: the in-use page with the fewest chunks handed
+        // out, other than the one holding `keep` (a chunk offset or NONE);
+        // NONE if there is none. Once its chunks are freed, it goes back to
+        // the free-page list for any class.
+        uint32_t emptiest_page(uint32_t keep) const;
+        uint32_t page_of(uint32_t offset) const { return static_cast<uint32_t>(offset >> page_shift); }
+        size_t live_chunks(uint32_t page) const { return pages[page].live; }
+
+        size_t max_allocation() const { return page_size(); }
+        size_t page_size() const { return size_t{1} << page_shift; }
+        size_t total_bytes() const { return page_count << page_shift; }
+        size_t bytes_in_use() const { return chunk_bytes_in_use; }
+        size_t pages_in_use() const { return page_count - free_pages; }
+
+        // Everything outside the arena that a snapshot must keep: list heads
+        // and counters (class sizes follow from the build).
+        struct State {
+            uint32_t partial[MAX_CLASSES];
+            uint32_t free_page_head;
+            uint64_t free_pages;
+            uint64_t chunk_bytes_in_use;
+        };
+        State state() const;
+        // After init() on a snapshot's arena. False if the state or any page
+        // is out of range, including the free-chunk chains inside the pages.
+        bool restore(const State& state);
+        // True if `offset` is a chunk boundary below its page's bump pointer,
+        // in a page that belongs to a class whose chunks hold `bytes`.
+        bool valid_chunk(uint32_t offset, size_t bytes) const;
+
+    private:
+        struct Page {
+            uint32_t size_class = NONE;
+            uint32_t live = 0;          // chunks handed out
+            uint32_t free_chunk = NONE; // offset of first freed chunk in this page
+            uint32_t bump = 0;          // next never-used chunk, relative to page start
+            uint32_t prev = NONE;       // links in the class's partial list or the free list
+            uint32_t next = NONE;
+        };
+
+        struct SizeClass {
+            uint32_t chunk_size = 0;
+            uint32_t chunks_per_page = 0;
+            uint32_t partial = NONE;    // pages with at least one free chunk
+        };
+
+        size_t class_for(size_t bytes) const;
+
+        void push_partial(uint32_t page);
+        void remove_partial(uint32_t page);
+
+        // Set by init() and read by lock-free readers (data(), contains()):
+        // a cache line apart from the lists that allocate() and free() change.
+        std::byte* base = nullptr;
+        Page* pages = nullptr;
+        size_t page_count = 0;
+        size_t page_shift = 0;
+        size_t class_count = 0;
+        alignas(64) SizeClass classes[MAX_CLASSES];
+        uint32_t free_page_head = NONE;
+        size_t free_pages = 0;
+        size_t chunk_bytes_in_use = 0;
+    };
+}
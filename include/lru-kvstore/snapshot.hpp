@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace kvstore {
+
+    static constexpr uint64_t SNAPSHOT_MAGIC = 0x3150414e53564b4cull;  // "LKVSNAP1"
+    static constexpr uint32_t SNAPSHOT_VERSION = 5;
+    // The arena image starts on a page boundary so it can be mapped directly.
+    static constexpr size_t SNAPSHOT_ALIGNMENT = 4096;
+
+    // On-disk snapshot of a store (see BasicKVStore::snapshot()):
+    //
+    //   header | one Shard::Image per shard | padding | arena image
+    //
+    // The arena holds only indices and offsets, so its image is the store's
+    // memory as it was; load() maps it copy-on-write and re-derives the
+    // pointers by carving the mapping up exactly as the constructor did. The
+    // images hold the little outside the arena (queue ends, slab list heads,
+    // counters). Same-machine format: native byte order and struct layout.
+    struct SnapshotHeader {
+        uint64_t magic = SNAPSHOT_MAGIC;
+        uint32_t version = SNAPSHOT_VERSION;
+        uint32_t image_bytes = 0;       // sizeof(Shard::Image), a layout check
+        char policy[64] = {};           // typeid names of the store's Policy
+        char hasher[64] = {};           // and Hasher; both shape the arena
+
+        // The Options that determine the arena's layout, as the store resolved them.
+        uint64_t capacity = 0;
+        uint64_t memory_budget = 0;
+        uint64_t num_shards = 0;
+        double load_factor = 0;
+        uint8_t probe_kernel = 0;
+        uint8_t promote_on_read = 0;
+        uint8_t admission = 0;
+        uint8_t expiry = 0;
+        uint8_t numa = 0;               // PerShard pads each shard's region to a page
+        int64_t expiry_interval_ms = 0;
+
+        uint64_t images_offset = 0;
+        uint64_t arena_offset = 0;
+        uint64_t arena_bytes = 0;
+        uint64_t file_bytes = 0;
+
+        // Both clocks when the snapshot was taken: TTL deadlines are in
+        // monotonic_ms() ticks, which mean nothing in another process.
+        uint64_t monotonic_ms = 0;
+        int64_t wall_ms = 0;
+        // Durable mode: the write-ahead log generation this snapshot
+        // compacts (see WriteAheadLog).
+        uint64_t wal_generation = 0;
+    };
+
+    // Writes a snapshot to a temporary file next to `path` and renames it
+    // over `path` on commit(), so a crash mid-write leaves any previous
+    // snapshot in place. Pages that are all zeros are skipped and stay
+    // holes in the file. Throws std::system_error on I/O failure.
+    class SnapshotWriter {
+    public:
+        SnapshotWriter(const std::string& path, size_t file_bytes);
+        ~SnapshotWriter();
+
+        SnapshotWriter(const SnapshotWriter&) = delete;
+        SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+        void write(size_t offset, const void* data, size_t bytes);
+        // fsync, then rename into place.
+        void commit();
+
+    private:
+        std::string path;
+        std::string temp_path;
+        int fd = -1;
+    };
+
+    // Opens a snapshot and checks its header and size. Throws
+    // std::system_error if the file cannot be read and std::runtime_error
+    // if it is not a snapshot of this version.
+    class SnapshotReader {
+    public:
+        explicit SnapshotReader(const std::string& path);
+        ~SnapshotReader();
+
+        SnapshotReader(const SnapshotReader&) = delete;
+        SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+        const SnapshotHeader& header() const { return head; }
+        int fd() const { return file; }
+        void read(size_t offset, void* data, size_t bytes) const;
+
+    private:
+        SnapshotHeader head;
+        int file = -1;
+    };
+}
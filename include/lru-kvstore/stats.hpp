@@ -0,0 +1,120 @@
+#pragma once
+
+#include "concurrency.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace kvstore {
+
+    // What BasicKVStore::stats() reports: counts since construction, summed
+    // over shards. Lookups are get(), pin(), get_into(), multi_get() and
+    // lookup_many() keys; put() and erase() probes are not counted.
+    struct StoreStats {
+        // Hits by how far the key sat from its home bucket: 0, 1, 2-3, 4-7,
+        // ..., and 64 or more in the last bucket.
+        static constexpr size_t DISTANCE_BUCKETS = 8;
+
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t inserts = 0;        // put() of a key that was not there
+        uint64_t updates = 0;        // put() over a live key
+        uint64_t erases = 0;         // erase() that removed a key
+        uint64_t evictions = 0;      // live entries pushed out to make room
+        uint64_t expirations = 0;    // expired entries reclaimed
+        // Nodes retired right now, not a count since construction.
+        // Backward-shift deletion leaves no tombstones in the table; the
+        // nearest thing is a node unlinked while a ValueHandle may still
+        // read it, which holds its node and chunk until reclaimed.
+        uint64_t retired = 0;
+        std::array<uint64_t, DISTANCE_BUCKETS> hit_distance{};
+        // Always counted, whatever the Stats parameter (see concurrency.hpp).
+        LockCounters locks;
+        // approximate_size() when the stats were read.
+        size_t entries = 0;
+
+        static size_t distance_bucket(size_t distance) {
+            size_t bucket = distance == 0 ? 0 : 64 - static_cast<size_t>(__builtin_clzll(distance));
+            return bucket < DISTANCE_BUCKETS ? bucket : DISTANCE_BUCKETS - 1;
+        }
+    };
+
+    // Per-shard counters, the store's fourth template parameter. Both kinds
+    // have the same calls; NoStats compiles every one of them to nothing.
+    //
+    // Writer-side counters change only under the shard lock, so they take a
+    // relaxed load and store, no read-modify-write, on a cache line of their
+    // own. Lookups can run concurrently, locked or not, so they count with
+    // fetch_add into one of a few striped lines picked per thread, like the
+    // read buffer's rings.
+    class ShardStats {
+    public:
+        static constexpr bool ENABLED = true;
+        static constexpr size_t STRIPES = 4;
+
+        void inserted() { bump(writes.inserts); }
+        void updated() { bump(writes.updates); }
+        void erased() { bump(writes.erases); }
+        void evicted() { bump(writes.evictions); }
+        void expired() { bump(writes.expirations); }
+        // The shard's retired-node count after it changed.
+        void retired(size_t count) { writes.retired.store(count, std::memory_order_relaxed); }
+
+        // A hit is counted only in its distance bucket; hits are their sum.
+        void hit(size_t distance) {
+            stripes[stripe_index()].distance[StoreStats::distance_bucket(distance)].fetch_add(
+                1, std::memory_order_relaxed);
+        }
+        void miss() { stripes[stripe_index()].misses.fetch_add(1, std::memory_order_relaxed); }
+
+        // Adds this shard's counts to `stats`; lock-free, so a count may be
+        // a write or two behind.
+        void add_to(StoreStats& stats) const;
+
+    private:
+        static void bump(std::atomic<uint64_t>& counter) {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        static size_t stripe_index() {
+            // Constant-initialized, so reading it needs no TLS guard check.
+            static thread_local uint32_t stripe = UINT32_MAX;
+            if (stripe == UINT32_MAX) [[unlikely]]
+                stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+            return stripe;
+        }
+
+        static inline std::atomic<uint32_t> next_stripe{0};
+
+        struct alignas(64) Writes {
+            std::atomic<uint64_t> inserts{0};
+            std::atomic<uint64_t> updates{0};
+            std::atomic<uint64_t> erases{0};
+            std::atomic<uint64_t> evictions{0};
+            std::atomic<uint64_t> expirations{0};
+            std::atomic<uint64_t> retired{0};
+        };
+        struct alignas(64) Stripe {
+            std::atomic<uint64_t> misses{0};
+            std::atomic<uint64_t> distance[StoreStats::DISTANCE_BUCKETS] = {};
+        };
+
+        Writes writes;
+        Stripe stripes[STRIPES];
+    };
+
+    struct NoStats {
+        static constexpr bool ENABLED = false;
+
+        void inserted() {}
+        void updated() {}
+        void erased() {}
+        void evicted() {}
+        void expired() {}
+        void retired(size_t) {}
+        void hit(size_t) {}
+        void miss() {}
+        void add_to(StoreStats&) const {}
+    };
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kvstore {
+
+    // Milliseconds on a monotonic clock. On Linux this is the coarse clock
+    // (a vDSO read of the last timer tick, a few ns), so it may lag real
+    // time by one scheduler tick, typically 1-4 ms.
+    uint64_t monotonic_ms();
+
+    // Hierarchical timer wheel over a shard's node indices (Varghese and
+    // Lauck; the cascading scheme of the Linux kernel's old timer wheel).
+    // LEVELS levels of 64 slots: level L holds deadlines 64^L to 64^(L+1)
+    // ticks away, one slot per 64^L ticks. A level-0 slot expires when its
+    // tick comes up; a higher slot is cascaded when its range begins, its
+    // nodes moving to lower levels. Deadlines past the top level (about 12
+    // days at 1 ms a tick) park in the furthest top slot and are placed again
+    // when it cascades. A bitmap per level lets advance() jump straight to
+    // the next occupied slot, so idle time costs nothing.
+    //
+    // Slots are circular lists through per-node prev/next links, with one
+    // sentinel per slot after the last node index, so unlinking a node
+    // does not need to know its slot. Not thread-safe; the shard lock
+    // guards it.
+    class TimerWheel {
+    public:
+        static constexpr int LEVELS = 5;
+        static constexpr int SLOT_BITS = 6;
+        static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+
+        static size_t storage_bytes(size_t capacity);
+        void init(Arena& arena, size_t capacity, uint64_t now);
+
+        bool enabled() const { return deadlines != nullptr; }
+        bool empty() const { return count == 0; }
+        size_t size() const { return count; }
+
+        // The node's deadline in ticks, 0 if it has none.
+        uint64_t deadline(uint32_t node) const { return deadlines[node]; }
+        // Sets or replaces the node's deadline; 0 cancels it.
+        void schedule(uint32_t node, uint64_t deadline);
+        void cancel(uint32_t node);
+
+        // True if advance(now) has anything to expire or cascade.
+        bool due(uint64_t now) const { return count != 0 && next_stop() <= now; }
+        // Moves the wheel up to `now` and takes up to `max` nodes whose
+        // deadline has passed off it, writing them to `expired`. Returns how
+        // many; if that is `max`, more may be due.
+        size_t advance(uint64_t now, uint32_t* expired, size_t max);
+
+        size_t bytes() const;
+
+        // After init() on a snapshot's arena, whose deadlines were taken on
+        // another run's clock: moves every deadline by `shift` ticks (at
+        // least to `now`, when it has passed) and relinks the wheel.
+        void rebuild(uint64_t now, int64_t shift);
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+
+        uint32_t sentinel(int level, uint32_t slot) const {
+            return static_cast<uint32_t>(capacity + level * SLOTS + slot);
+        }
+        void place(uint32_t node);
+        void link(uint32_t node, uint32_t head);
+        void unlink(uint32_t node);
+        void cascade(int level, uint32_t slot);
+        // First tick at or after `current` that has a slot to expire or cascade.
+        uint64_t next_stop() const;
+
+        uint64_t* deadlines = nullptr;
+        uint32_t* prev = nullptr;
+        uint32_t* next = nullptr;
+        uint64_t occupied[LEVELS] = {};
+        size_t capacity = 0;
+        size_t count = 0;
+        // The next tick to process: everything before it has been expired or cascaded.
+        uint64_t current = 0;
+    };
+}
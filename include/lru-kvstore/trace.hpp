@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace kvstore {
+
+    // Access traces for offline replay (tools/replay.cpp): one record per
+    // request a store received, in the order it received them.
+    enum class TraceOp : uint8_t { Get, Put, Erase };
+
+    struct TraceRecord {
+        uint64_t timestamp_us = 0;  // any epoch; only differences are used
+        TraceOp op = TraceOp::Get;
+        uint32_t value_bytes = 0;   // size of the value put; 0 for gets and erases
+        std::string_view key;       // points into the trace's mapping
+    };
+
+    // Two formats, told apart by the first 8 bytes:
+    //
+    //  - Binary: TRACE_MAGIC, then per record one byte of op, then LEB128
+    //    varints of the timestamp's change from the previous record
+    //    (zigzag-encoded, the first from 0), the key's length and
+    //    value_bytes, then the key bytes. A record of a 10-byte key takes
+    //    about 15 bytes.
+    //  - CSV: one "timestamp_us,op,key,value_bytes" line per record, with op
+    //    one of get, put, erase (value_bytes may be left out for get and
+    //    erase). Blank lines and lines starting with '#' are skipped. Keys
+    //    cannot contain commas or newlines.
+    static constexpr uint64_t TRACE_MAGIC = 0x3145435254564b4cull;  // "LKVTRCE1"
+
+    // A trace file mapped read-only. Records are parsed in place: the keys
+    // of the records a Cursor returns point into the mapping and stay valid
+    // as long as the TraceFile. Any number of cursors may walk one file
+    // concurrently. Throws std::system_error if the file cannot be mapped.
+    class TraceFile {
+    public:
+        explicit TraceFile(const std::string& path);
+        ~TraceFile();
+
+        TraceFile(const TraceFile&) = delete;
+        TraceFile& operator=(const TraceFile&) = delete;
+
+        bool binary() const { return is_binary; }
+        size_t bytes() const { return size; }
+
+        // Walks the records from the start. next() throws std::runtime_error,
+        // naming the file and the line or byte offset, on a malformed record.
+        class Cursor {
+        public:
+            bool next(TraceRecord& record);
+
+        private:
+            friend class TraceFile;
+            Cursor(const TraceFile& file, const char* begin)
+                : file(&file), pos(begin) {}
+
+            bool next_binary(TraceRecord& record);
+            bool next_csv(TraceRecord& record);
+            uint64_t read_varint();
+            [[noreturn]] void fail(const char* what) const;
+
+            const TraceFile* file;
+            const char* pos;
+            size_t line = 0;
+            uint64_t timestamp = 0;  // binary: the previous record's
+        };
+
+        Cursor cursor() const;
+
+    private:
+        std::string path;
+        const char* data = nullptr;
+        size_t size = 0;
+        bool is_binary = false;
+    };
+
+    // Writes a binary trace. Throws std::system_error on I/O failure.
+    class TraceWriter {
+    public:
+        explicit TraceWriter(const std::string& path);
+        ~TraceWriter();
+
+        TraceWriter(const TraceWriter&) = delete;
+        TraceWriter& operator=(const TraceWriter&) = delete;
+
+        void write(const TraceRecord& record);
+        // Flushes the buffer and closes the file; the destructor does the
+        // same but cannot report a failure.
+        void close();
+
+    private:
+        void flush();
+        void append_varint(uint64_t value);
+
+        std::string path;
+        std::string buffer;
+        uint64_t timestamp = 0;
+        int fd = -1;
+    };
+}
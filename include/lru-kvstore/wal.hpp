@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kvstore {
+
+    static constexpr uint64_t WAL_MAGIC = 0x31304c4157564b4cull;  // "LKVWAL01"
+
+    // One logged write. deadline_ms is a TTL's deadline in wall-clock ms
+    // since the epoch (the monotonic clock does not survive a restart), 0
+    // for none.
+    struct WalRecord {
+        enum class Type : uint32_t { Put = 1, Erase = 2 };
+
+        Type type = Type::Put;
+        std::string_view key;
+        std::string_view value;
+        int64_t deadline_ms = 0;
+    };
+
+    // A shard's records that are not in the log yet, appended under the
+    // shard lock so that they are in the order the shard applied them.
+    // Each record is a 24-byte header (checksum, key and value lengths,
+    // type, deadline) followed by the key and value bytes; the checksum
+    // covers everything after itself, so replay can tell where a torn
+    // write at the end of the log starts.
+    class WalBuffer {
+    public:
+        void put(std::string_view key, std::string_view value, int64_t deadline_ms);
+        void erase(std::string_view key);
+
+        size_t size() const { return bytes.size(); }
+        bool empty() const { return bytes.empty(); }
+        std::span<const char> data() const { return bytes; }
+        void clear() { bytes.clear(); }
+        void reserve(size_t n) { bytes.reserve(n); }
+        void swap(WalBuffer& other) noexcept { bytes.swap(other.bytes); }
+
+    private:
+        void append(WalRecord::Type type, std::string_view key, std::string_view value, int64_t deadline_ms);
+
+        std::vector<char> bytes;
+    };
+
+    // The append-only log file: a 16-byte header (magic, generation), then
+    // records as WalBuffer lays them out. The generation pairs the log with
+    // the snapshot it continues: compaction writes a snapshot stamped with
+    // the next generation and then restarts the log under it, so a log
+    // older than the snapshot is known to be contained in it. Throws
+    // std::system_error on I/O failure.
+    class WriteAheadLog {
+    public:
+        // Opens `path`, creating it empty if it does not exist.
+        explicit WriteAheadLog(const std::string& path);
+        ~WriteAheadLog();
+
+        WriteAheadLog(const WriteAheadLog&) = delete;
+        WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+        // The header's generation; nullopt for an empty file or a bad header.
+        std::optional<uint64_t> generation() const;
+        // Calls `apply` on every intact record in order, stopping at the
+        // first incomplete or corrupt one. Returns how many were applied.
+        size_t replay(const std::function<void(const WalRecord&)>& apply) const;
+        // Truncates the log to just a header for `generation`, durably.
+        void reset(uint64_t generation);
+        // Appends the buffers in order, in as few writes as it can; durable
+        // only after sync(). A write that fails partway is cut off again, so
+        // replay does not stop at it and lose the appends after it. If even
+        // that fails, the log refuses appends until the next reset().
+        void append(std::span<const WalBuffer> buffers);
+        void sync();
+
+    private:
+        void append_all(std::span<const WalBuffer> buffers);
+
+        std::string path;
+        int fd = -1;
+        bool failed = false;
+    };
+}
@@ -0,0 +1,3 @@
+#!/bin/bash
+set -e
+./build/bin/kvstore_latency "$@"
@@ -0,0 +1,68 @@
+#include "lru-kvstore/arena.hpp"
+
+#include <sys/mman.h>
+#include <utility>
+
+namespace kvstore {
+
+    Arena::Arena(size_t bytes)
+        : size((bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+    {
+        if (size == 0)
+            return;
+
+        // Anonymous mappings are zero-filled and backed lazily, so a store sized
+        // for millions of entries only pays for the pages it actually touches.
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+            throw std::bad_alloc();
+        base = static_cast<std::byte*>(mem);
+    }
+
+    Arena::Arena(int fd, size_t offset, size_t bytes)
+        : size((bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1)), mapped_file(true)
+    {
+        if (size == 0)
+            return;
+
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+        if (mem == MAP_FAILED)
+            throw std::bad_alloc();
+        base = static_cast<std::byte*>(mem);
+    }
+
+    Arena::Arena(std::byte* memory, size_t bytes)
+        : base(memory), size(bytes & ~(ALIGNMENT - 1)), borrowed(true)
+    {
+    }
+
+    Arena::~Arena()
+    {
+        if (base && !borrowed)
+            munmap(base, size);
+    }
+
+    Arena::Arena(Arena&& other) noexcept
+        : base(std::exchange(other.base, nullptr)),
+          size(std::exchange(other.size, 0)),
+          used(std::exchange(other.used, 0)),
+          mapped_file(std::exchange(other.mapped_file, false)),
+          borrowed(std::exchange(other.borrowed, false))
+    {
+    }
+
+    Arena& Arena::operator=(Arena&& other) noexcept
+    {
+        if (this != &other) {
+            if (base && !borrowed)
+                munmap(base, size);
+            base = std::exchange(other.base, nullptr);
+            size = std::exchange(other.size, 0);
+            used = std::exchange(other.used, 0);
+            mapped_file = std::exchange(other.mapped_file, false);
+            borrowed = std::exchange(other.borrowed, false);
+        }
+        return *this;
+    }
+}
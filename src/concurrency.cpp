@@ -0,0 +1,158 @@
+#include "lru-kvstore/concurrency.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace kvstore {
+
+#if defined(__linux__)
+    // Not the _PRIVATE ops: a shard lock may sit in a shared memory segment
+    // (Options::shared_name) with waiters in several processes. Only the
+    // sleeping path pays for it, with a page lookup to key the futex.
+    void futex_wait(std::atomic<uint32_t>& word, uint32_t expected)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, nullptr, nullptr, 0);
+    }
+
+    void futex_wake(std::atomic<uint32_t>& word, int waiters)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, waiters, nullptr, nullptr, 0);
+    }
+#else
+    // Elsewhere C++20 atomic waiting is the closest thing; it has no
+    // wake-n, so any wake of more than one waiter wakes them all.
+    void futex_wait(std::atomic<uint32_t>& word, uint32_t expected)
+    {
+        word.wait(expected, std::memory_order_relaxed);
+    }
+
+    void futex_wake(std::atomic<uint32_t>& word, int waiters)
+    {
+        if (waiters == 1)
+            word.notify_one();
+        else
+            word.notify_all();
+    }
+#endif
+
+    namespace {
+        // Pauses `backoff` times, then doubles it up to MAX_BACKOFF. Returns
+        // the number of pauses.
+        uint32_t back_off(uint32_t& backoff)
+        {
+            uint32_t pauses = backoff;
+            for (uint32_t i = 0; i < pauses; ++i)
+                cpu_relax();
+            backoff = std::min(backoff * 2, MAX_BACKOFF);
+            return pauses;
+        }
+    }
+
+    void BackoffLock::lock_slow()
+    {
+        uint64_t pauses = 0;
+        uint32_t backoff = 1;
+        do {
+            while (locked.load(std::memory_order_relaxed))
+                pauses += back_off(backoff);
+        } while (locked.exchange(true, std::memory_order_acquire));
+        spins.fetch_add(pauses, std::memory_order_relaxed);
+    }
+
+    void AdaptiveLock::lock_slow()
+    {
+        uint64_t pauses = 0;
+        uint32_t backoff = 1;
+        while (pauses < SPIN_LIMIT) {
+            uint32_t expected = state.load(std::memory_order_relaxed);
+            if (expected == 0 &&
+                state.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                spins.fetch_add(pauses, std::memory_order_relaxed);
+                return;
+            }
+            // Someone is already asleep; spinning would only delay joining them.
+            if (expected == 2)
+                break;
+            pauses += back_off(backoff);
+        }
+        spins.fetch_add(pauses, std::memory_order_relaxed);
+
+        // Take the lock as "held with sleepers" from here on, since we cannot
+        // tell whether other sleepers remain once we are woken.
+        while (state.exchange(2, std::memory_order_acquire) != 0) {
+            sleeps.fetch_add(1, std::memory_order_relaxed);
+            futex_wait(state, 2);
+        }
+    }
+
+    void AdaptiveLock::wake()
+    {
+        futex_wake(state, 1);
+    }
+
+    void SharedAdaptiveLock::lock_slow()
+    {
+        uint64_t pauses = 0;
+        uint32_t backoff = 1;
+        while (true) {
+            uint32_t s = state.load(std::memory_order_relaxed);
+            if ((s & ~PENDING) == 0) {
+                // Free (maybe with our own or another writer's PENDING): take
+                // it and clear PENDING; writers still waiting set it again.
+                if (state.compare_exchange_weak(s, WRITER, std::memory_order_acquire, std::memory_order_relaxed))
+                    break;
+                continue;
+            }
+            if (!(s & PENDING))
+                state.fetch_or(PENDING, std::memory_order_relaxed);
+            if (pauses < SPIN_LIMIT)
+                pauses += back_off(backoff);
+            else
+                sleep(s | PENDING);
+        }
+        spins.fetch_add(pauses, std::memory_order_relaxed);
+    }
+
+    void SharedAdaptiveLock::lock_shared_slow()
+    {
+        uint64_t pauses = 0;
+        uint32_t backoff = 1;
+        while (true) {
+            uint32_t s = state.load(std::memory_order_relaxed);
+            if (!(s & (WRITER | PENDING))) {
+                if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                    break;
+                continue;
+            }
+            if (pauses < SPIN_LIMIT)
+                pauses += back_off(backoff);
+            else
+                sleep(s);
+        }
+        spins.fetch_add(pauses, std::memory_order_relaxed);
+    }
+
+    // Registers as a sleeper before the last look at the state, and unlockers
+    // change the state before checking for sleepers (both seq_cst), so either
+    // the unlocker sees us or we see its change and the futex returns at once.
+    void SharedAdaptiveLock::sleep(uint32_t seen)
+    {
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (state.load(std::memory_order_seq_cst) == seen) {
+            sleeps.fetch_add(1, std::memory_order_relaxed);
+            futex_wait(state, seen);
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void SharedAdaptiveLock::wake()
+    {
+        futex_wake(state, INT_MAX);
+    }
+}
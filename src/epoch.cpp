@@ -0,0 +1,45 @@
+#include "lru-kvstore/epoch.hpp"
+
+#include <stdexcept>
+
+namespace kvstore {
+
+    namespace {
+        // Threads start probing at different slots so their pins do not share
+        // a cache line; the hint then sticks to the last slot the thread used.
+        std::atomic<uint32_t> next_thread_slot{0};
+    }
+
+    uint32_t EpochDomain::pin()
+    {
+        thread_local uint32_t hint = next_thread_slot.fetch_add(1, std::memory_order_relaxed) % MAX_SLOTS;
+
+        for (size_t i = 0; i < MAX_SLOTS; ++i) {
+            uint32_t slot = static_cast<uint32_t>((hint + i) % MAX_SLOTS);
+            uint64_t expected = 0;
+            // An epoch that advanced between the load and the claim only makes
+            // this reader look older than it is, which is safe.
+            uint64_t now = epoch.load(std::memory_order_acquire);
+            if (slots[slot].epoch.compare_exchange_strong(expected, now, std::memory_order_seq_cst)) {
+                hint = slot;
+                uint32_t used = slots_used.load(std::memory_order_relaxed);
+                while (used <= slot &&
+                       !slots_used.compare_exchange_weak(used, slot + 1, std::memory_order_seq_cst)) {}
+                return slot;
+            }
+        }
+        throw std::runtime_error("kvstore: too many live ValueHandles");
+    }
+
+    uint64_t EpochDomain::oldest_pinned() const
+    {
+        uint64_t oldest = NONE;
+        uint32_t used = slots_used.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < used; ++i) {
+            uint64_t pinned = slots[i].epoch.load(std::memory_order_acquire);
+            if (pinned != 0 && pinned < oldest)
+                oldest = pinned;
+        }
+        return oldest;
+    }
+}
@@ -0,0 +1,211 @@
+#include "lru-kvstore/eviction.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace kvstore {
+
+    void NodeQueue::push_front(NodeMeta* meta, uint32_t node)
+    {
+        meta[node].prev = NIL_NODE;
+        meta[node].next = head;
+
+        if (head != NIL_NODE)
+            meta[head].prev = node;
+        else
+            tail = node;
+
+        head = node;
+        ++size;
+    }
+
+    void NodeQueue::unlink(NodeMeta* meta, uint32_t node)
+    {
+        NodeMeta& m = meta[node];
+        if (m.prev != NIL_NODE)
+            meta[m.prev].next = m.next;
+        else
+            head = m.next;
+
+        if (m.next != NIL_NODE)
+            meta[m.next].prev = m.prev;
+        else
+            tail = m.prev;
+
+        m.prev = NIL_NODE;
+        m.next = NIL_NODE;
+        --size;
+    }
+
+    bool NodeQueue::valid(const NodeMeta* meta, size_t capacity) const
+    {
+        if ((head == NIL_NODE) != (tail == NIL_NODE) || size > capacity)
+            return false;
+
+        uint32_t prev = NIL_NODE;
+        size_t steps = 0;
+        for (uint32_t node = head; node != NIL_NODE; node = meta[node].next) {
+            if (node >= capacity || meta[node].prev != prev || ++steps > size)
+                return false;
+            prev = node;
+        }
+        return prev == tail && steps == size;
+    }
+
+
+    size_t ClockPolicy::storage_bytes(size_t capacity)
+    {
+        return Arena::bytes_for<Slot>(capacity);
+    }
+
+    void ClockPolicy::init(Arena& arena, size_t capacity, NodeMeta*)
+    {
+        slots = arena.allocate<Slot>(capacity);
+        this->capacity = capacity;
+    }
+
+    // The first lap honours reference bits; if readers keep setting them
+    // faster than the hand clears them, the second lap ignores them.
+    uint32_t ClockPolicy::victim(uint32_t keep)
+    {
+        for (size_t scanned = 0; scanned < 2 * capacity; ++scanned) {
+            auto node = static_cast<uint32_t>(hand);
+            hand = hand + 1 == capacity ? 0 : hand + 1;
+
+            if (!slots[node].resident || node == keep)
+                continue;
+            if (scanned < capacity && slots[node].referenced.load(std::memory_order_relaxed)) {
+                slots[node].referenced.store(0, std::memory_order_relaxed);
+                continue;
+            }
+            return node;
+        }
+        return NIL_NODE;
+    }
+
+
+    size_t SievePolicy::storage_bytes(size_t capacity)
+    {
+        return Arena::bytes_for<std::atomic<uint8_t>>(capacity);
+    }
+
+    void SievePolicy::init(Arena& arena, size_t capacity, NodeMeta* meta)
+    {
+        this->meta = meta;
+        visited = arena.allocate<std::atomic<uint8_t>>(capacity);
+    }
+
+    void SievePolicy::on_remove(uint32_t node)
+    {
+        if (hand == node)
+            hand = meta[node].prev;
+        queue.unlink(meta, node);
+    }
+
+    uint32_t SievePolicy::victim(uint32_t keep)
+    {
+        uint32_t node = hand != NIL_NODE ? hand : queue.tail;
+        for (size_t scanned = 0; node != NIL_NODE && scanned <= 2 * queue.size; ++scanned) {
+            bool second_lap = scanned >= queue.size;
+            if (node != keep &&
+                (second_lap || !visited[node].load(std::memory_order_relaxed))) {
+                hand = node;
+                return node;
+            }
+            if (node != keep)
+                visited[node].store(0, std::memory_order_relaxed);
+            node = meta[node].prev != NIL_NODE ? meta[node].prev : queue.tail;
+        }
+        return NIL_NODE;
+    }
+
+
+    size_t S3FifoPolicy::storage_bytes(size_t capacity)
+    {
+        return Arena::bytes_for<Slot>(capacity) + Arena::bytes_for<uint64_t>(std::bit_ceil(capacity));
+    }
+
+    void S3FifoPolicy::init(Arena& arena, size_t capacity, NodeMeta* meta)
+    {
+        this->meta = meta;
+        slots = arena.allocate<Slot>(capacity);
+        size_t ghost_slots = std::bit_ceil(capacity);
+        ghosts = arena.allocate<uint64_t>(ghost_slots);
+        ghost_mask = ghost_slots - 1;
+        small_target = std::max<size_t>(1, capacity / 10);
+    }
+
+    void S3FifoPolicy::on_insert(uint32_t node)
+    {
+        uint64_t hash = meta[node].hash;
+        uint64_t& ghost = ghosts[hash & ghost_mask];
+        slots[node].freq.store(0, std::memory_order_relaxed);
+        if (ghost == hash) {
+            ghost = 0;
+            slots[node].queue = MAIN;
+            main.push_front(meta, node);
+        } else {
+            slots[node].queue = SMALL;
+            small.push_front(meta, node);
+        }
+    }
+
+    void S3FifoPolicy::on_remove(uint32_t node)
+    {
+        queue_of(node).unlink(meta, node);
+        slots[node].queue = NONE;
+    }
+
+    void S3FifoPolicy::move_to(NodeQueue& to, uint8_t which, uint32_t node)
+    {
+        queue_of(node).unlink(meta, node);
+        slots[node].queue = which;
+        to.push_front(meta, node);
+    }
+
+    // Each step either returns or moves one node to a queue head while
+    // lowering its counter, so the loop ends; the budget only guards against
+    // readers bumping counters as fast as they are lowered.
+    uint32_t S3FifoPolicy::victim(uint32_t keep)
+    {
+        size_t budget = 4 * (small.size + main.size) + 4;
+        for (size_t step = 0; step < budget; ++step) {
+            bool forced = step + 1 >= budget / 2;
+
+            if (!small.empty() && (small.size > small_target || main.empty())) {
+                uint32_t node = small.tail;
+                if (node == keep) {
+                    if (small.size == 1 && main.empty())
+                        return NIL_NODE;
+                    move_to(main, MAIN, node);
+                    continue;
+                }
+                if (!forced && slots[node].freq.load(std::memory_order_relaxed) > 1) {
+                    slots[node].freq.store(0, std::memory_order_relaxed);
+                    move_to(main, MAIN, node);
+                    continue;
+                }
+                ghosts[meta[node].hash & ghost_mask] = meta[node].hash;
+                return node;
+            }
+
+            uint32_t node = main.tail;
+            if (node == NIL_NODE)
+                return NIL_NODE;
+            if (node == keep) {
+                if (main.size == 1 && small.empty())
+                    return NIL_NODE;
+                move_to(main, MAIN, node);
+                continue;
+            }
+            uint8_t freq = slots[node].freq.load(std::memory_order_relaxed);
+            if (!forced && freq > 0) {
+                slots[node].freq.store(freq - 1, std::memory_order_relaxed);
+                move_to(main, MAIN, node);
+                continue;
+            }
+            return node;
+        }
+        return NIL_NODE;
+    }
+}
@@ -0,0 +1,77 @@
+#include "lru-kvstore/frequency_sketch.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace kvstore {
+
+    namespace {
+        constexpr uint64_t ROW_SEEDS[4] = {
+            0xc3a5c85c97cb3127ull, 0xb492b66fbe98f273ull,
+            0x9ae16a3b2f90404full, 0xcbf29ce484222325ull,
+        };
+    }
+
+    size_t FrequencySketch::words_for(size_t capacity)
+    {
+        return std::max<size_t>(std::bit_ceil(std::max<size_t>(capacity, 1)) / 4, 4);
+    }
+
+    size_t FrequencySketch::storage_bytes(size_t capacity)
+    {
+        return Arena::bytes_for<uint64_t>(words_for(capacity));
+    }
+
+    void FrequencySketch::init(Arena& arena, size_t capacity)
+    {
+        words = words_for(capacity);
+        table = arena.allocate<uint64_t>(words);
+        counter_mask = words * 16 - 1;
+        sample_size = std::max<size_t>(capacity, 1) * 10;
+    }
+
+    // Rows rehash the (already well-mixed) key hash with their own odd
+    // multiplier, so the four counters of a key are independent of each other.
+    size_t FrequencySketch::index(uint64_t hash, int row) const
+    {
+        uint64_t h = (hash ^ ROW_SEEDS[row]) * 0x9e3779b97f4a7c15ull;
+        return static_cast<size_t>(h >> 32) & counter_mask;
+    }
+
+    uint32_t FrequencySketch::estimate(uint64_t hash) const
+    {
+        uint32_t count = MAX_COUNT;
+        for (int row = 0; row < DEPTH; ++row)
+            count = std::min(count, counter(index(hash, row)));
+        return count;
+    }
+
+    void FrequencySketch::increment(uint64_t hash)
+    {
+        size_t idx[DEPTH];
+        uint32_t least = MAX_COUNT;
+        for (int row = 0; row < DEPTH; ++row) {
+            idx[row] = index(hash, row);
+            least = std::min(least, counter(idx[row]));
+        }
+        if (least == MAX_COUNT)
+            return;
+
+        for (int row = 0; row < DEPTH; ++row) {
+            if (counter(idx[row]) == least)
+                table[idx[row] >> 4] += uint64_t{1} << ((idx[row] & 15) * 4);
+        }
+
+        if (++additions >= sample_size)
+            age();
+    }
+
+    // Halve every counter at once: shift each word right and drop the bit
+    // that crossed into the neighbouring nibble.
+    void FrequencySketch::age()
+    {
+        for (size_t i = 0; i < words; ++i)
+            table[i] = (table[i] >> 1) & 0x7777777777777777ull;
+        additions /= 2;
+    }
+}
@@ -1,297 +1,2102 @@
  #include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/numa.hpp"
+#include "lru-kvstore/shared_memory.hpp"
+#include "lru-kvstore/snapshot.hpp"
 
 #include <cstring>
 #include <string>
 #include <algorithm>
+#include <charconv>
 #include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <typeinfo>
 
 
 namespace kvstore{
 
+    namespace {
+        // Failed optimistic attempts before get_into() takes the shard lock.
+        constexpr int MAX_OPTIMISTIC_READS = 8;
 
-    KVStore::~KVStore()
+        size_t next_pow2(size_t n)
+        {
+            size_t p = 1;
+            while (p < n)
+                p <<= 1;
+            return p;
+        }
+    }
+
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    BasicKVStore<Policy, Lock, Hasher, Stats>::BasicKVStore() : BasicKVStore(Options{})
     {
     }
 
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    BasicKVStore<Policy, Lock, Hasher, Stats>::BasicKVStore(const Options& options)
+        : BasicKVStore(options, open_snapshot(options).get())
+    {
+    }
 
-    size_t KVStore::fnv1a(std::string_view key)
+    // With a snapshot, the arena is the snapshot's and every shard is
+    // restored from its image right after init(); the layout computed here
+    // must come out exactly as it did for the store that wrote it.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    BasicKVStore<Policy, Lock, Hasher, Stats>::BasicKVStore(const Options& options, const SnapshotReader* snapshot)
     {
-        constexpr size_t FNV_OFFSET = 14695981039346656037ull;
-        constexpr size_t FNV_PRIME  = 1099511628211ull;
+        if (options.num_shards == 0)
+            throw std::invalid_argument("kvstore: num_shards must be at least 1");
+        if (options.capacity == 0 && options.memory_budget == 0)
+            throw std::invalid_argument("kvstore: capacity or memory_budget must be set");
+        if (!(options.load_factor > 0.0 && options.load_factor <= 1.0))
+            throw std::invalid_argument("kvstore: load_factor must be in (0, 1]");
+        if (options.expiry_interval.count() < 0 || (options.expiry_interval.count() > 0 && !options.expiry))
+            throw std::invalid_argument("kvstore: expiry_interval must be non-negative and needs expiry");
+        if (!options.wal_path.empty() && (options.wal_commit_bytes == 0 || options.wal_commit_interval.count() <= 0))
+            throw std::invalid_argument("kvstore: wal_commit_bytes and wal_commit_interval must be positive");
+        if (!options.shared_name.empty() && !options.wal_path.empty())
+            throw std::invalid_argument("kvstore: shared_name and wal_path cannot be combined");
+        if (!options.shard_nodes.empty() && options.numa != NumaPlacement::PerShard)
+            throw std::invalid_argument("kvstore: shard_nodes needs NumaPlacement::PerShard");
+        if (!options.shard_nodes.empty() && options.shard_nodes.size() != options.num_shards)
+            throw std::invalid_argument("kvstore: shard_nodes must name a node for every shard");
+
+        num_shards = options.num_shards;
+        total_capacity = options.capacity ? options.capacity
+                                          : options.memory_budget / DEFAULT_ENTRY_BYTES;
+        total_budget = options.memory_budget ? options.memory_budget
+                                             : total_capacity * DEFAULT_ENTRY_BYTES;
+        if (total_capacity < num_shards)
+            throw std::invalid_argument("kvstore: capacity must be at least num_shards");
+
+        // Shards split the capacity as evenly as possible; the first
+        // `capacity % num_shards` shards take one extra entry.
+        size_t base = total_capacity / num_shards;
+        size_t extra = total_capacity % num_shards;
+        auto local_capacity = [&](size_t i) { return base + (i < extra ? 1 : 0); };
+        if (local_capacity(0) >= ShardType::NIL)
+            throw std::invalid_argument("kvstore: per-shard capacity must fit in 32 bits");
+        // Always keep at least one empty bucket so probe runs terminate.
+        auto local_table_size = [&](size_t i) {
+            auto wanted = static_cast<size_t>(std::ceil(local_capacity(i) / options.load_factor));
+            return next_pow2(std::max(wanted, local_capacity(i) + 1));
+        };
+
+        size_t shard_budget = (total_budget + num_shards - 1) / num_shards;
+        size_t slab_page_bytes = SlabAllocator::page_size_for(shard_budget);
+        size_t slab_pages = SlabAllocator::pages_for(shard_budget, slab_page_bytes);
+
+        // With PerShard placement every shard's region starts on a page of
+        // its own, since pages are what a node is chosen for.
+        bool per_shard = options.numa == NumaPlacement::PerShard;
+        if (per_shard) {
+            size_t nodes = numa_node_count();
+            shard_nodes.resize(num_shards);
+            for (size_t i = 0; i < num_shards; ++i) {
+                int node = options.shard_nodes.empty() ? static_cast<int>(i * nodes / num_shards)
+                                                       : options.shard_nodes[i];
+                if (node < 0 || static_cast<size_t>(node) >= nodes)
+                    throw std::invalid_argument("kvstore: shard_nodes names a node that is not online");
+                shard_nodes[i] = node;
+            }
+        }
+        size_t region_alignment = per_shard ? NUMA_PAGE_BYTES : Arena::ALIGNMENT;
+        auto padded_bytes = [&](size_t i) {
+            size_t bytes = ShardType::storage_bytes(local_capacity(i), local_table_size(i), slab_pages,
+                                                    slab_page_bytes, options.admission, options.expiry);
+            return (bytes + region_alignment - 1) & ~(region_alignment - 1);
+        };
+        size_t bytes = 0;
+        for (size_t i = 0; i < num_shards; ++i)
+            bytes += padded_bytes(i);
+
+        if (snapshot) {
+            const SnapshotHeader& header = snapshot->header();
+            if (std::strncmp(header.policy, typeid(Policy).name(), sizeof(header.policy) - 1) != 0 ||
+                std::strncmp(header.hasher, typeid(Hasher).name(), sizeof(header.hasher) - 1) != 0 ||
+                header.image_bytes != sizeof(typename ShardType::Image))
+                throw std::runtime_error("kvstore: snapshot was written by a different store type");
+            if (header.num_shards != num_shards || header.arena_bytes != Arena::bytes_for<std::byte>(bytes) ||
+                header.images_offset + num_shards * sizeof(typename ShardType::Image) > header.arena_offset)
+                throw std::runtime_error("kvstore: snapshot does not match these options");
+        }
+        // A store attaching to a shared segment finds its shards built.
+        bool fresh = true;
+        if (!options.shared_name.empty()) {
+            fresh = open_shared(options, Arena::bytes_for<std::byte>(bytes));
+        } else {
+            arena = snapshot ? Arena(snapshot->fd(), snapshot->header().arena_offset, bytes) : Arena(bytes);
+            own_common = std::make_unique<Common>();
+            common = own_common.get();
+            own_shards = std::make_unique<ShardType[]>(num_shards);
+            shards = own_shards.get();
+        }
+        // Placement has to come before init(), which touches the tables and
+        // nodes and so gives them their pages. The Shard structs stay where
+        // they are: a thread that routes its keys to its own node's shards
+        // keeps their few hot lines in that node's caches anyway.
+        if (fresh && options.numa == NumaPlacement::Interleave)
+            numa_interleave(arena.data(), arena.capacity());
+        for (size_t i = 0; i < num_shards && fresh; ++i) {
+            arena.align(region_alignment);
+            if (per_shard)
+                numa_bind(arena.data() + arena.bytes_used(), padded_bytes(i), shard_nodes[i]);
+            shards[i].init(arena, local_capacity(i), local_table_size(i), slab_pages, slab_page_bytes, options.probe_kernel,
+                           common->epochs, options.promote_on_read, options.admission, options.expiry);
+        }
 
-        size_t hash = FNV_OFFSET;
-        for (char c : key) {
-            hash ^= static_cast<size_t>(c);
-            hash *= FNV_PRIME;
+        if (snapshot) {
+            const SnapshotHeader& header = snapshot->header();
+            std::vector<typename ShardType::Image> images(num_shards);
+            snapshot->read(header.images_offset, images.data(), images.size() * sizeof(images[0]));
+
+            // Deadlines keep the time they had left when the snapshot was
+            // taken, less the wall-clock time since.
+            auto wall_now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            uint64_t now = monotonic_ms();
+            int64_t shift = (static_cast<int64_t>(now) - wall_now) -
+                            (static_cast<int64_t>(header.monotonic_ms) - header.wall_ms);
+
+            for (size_t i = 0; i < num_shards; ++i)
+                if (!shards[i].restore(images[i], now, shift))
+                    throw std::runtime_error("kvstore: snapshot is corrupt");
+        }
+
+        load_factor = options.load_factor;
+        numa = options.numa;
+        expiry = options.expiry;
+        expiry_interval = options.expiry_interval;
+        if (!options.wal_path.empty())
+            open_log(options, snapshot ? snapshot->header().wal_generation : 0);
+        if (segment && segment->created())
+            segment->publish();
+        if (options.expiry_interval.count() > 0) {
+            maintenance = std::jthread([this, interval = options.expiry_interval](std::stop_token stop) {
+                std::unique_lock<std::mutex> lock(maintenance_mutex);
+                while (!stop.stop_requested()) {
+                    maintenance_wake.wait_for(lock, stop, interval, [] { return false; });
+                    if (!stop.stop_requested())
+                        expire();
+                }
+            });
         }
-        return hash;
     }
 
-    std::pair<bool, size_t> Shard::find(std::string_view key, size_t hash) const {
-        size_t idx = hash % LOCAL_CAPACITY;
-        size_t start = idx;
-        std::optional<size_t> first_deleted;
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    BasicKVStore<Policy, Lock, Hasher, Stats>::~BasicKVStore()
+    {
+        if (durable) {
+            committer.request_stop();
+            committer.join();
+            commit_log();
+        }
+    }
 
-        while (true) {
-            const auto& bucket = table[idx];
+    template <typename Policy, typename Lock, typename Stats>
+    size_t Shard<Policy, Lock, Stats>::storage_bytes(size_t capacity, size_t table_size, size_t slab_pages,
+                                              size_t slab_page_bytes, Admission admission, bool expiry)
+    {
+        size_t admission_bytes = admission == Admission::TinyLfu
+            ? FrequencySketch::storage_bytes(capacity) + Arena::bytes_for<uint8_t>(capacity)
+            : 0;
+        return Arena::bytes_for<uint8_t>(table_size + MAX_GROUP_WIDTH) +
+               Arena::bytes_for<std::atomic<uint32_t>>(table_size) +
+               Arena::bytes_for<NodeMeta>(capacity) +
+               Arena::bytes_for<NodeData>(capacity) +
+               Arena::bytes_for<RetiredChunk>(retired_slots_for(capacity)) +
+               SlabAllocator::storage_bytes(slab_pages, slab_page_bytes) +
+               Policy::storage_bytes(capacity) +
+               admission_bytes +
+               (expiry ? TimerWheel::storage_bytes(capacity) : 0);
+    }
 
-            if (bucket.state == BucketState::Empty)
-                return {false, first_deleted.value_or(idx)};
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::init(Arena& arena, size_t capacity, size_t table_size, size_t slab_pages,
+                             size_t slab_page_bytes, ProbeKernel kernel, EpochDomain& epochs, bool promote_on_read, Admission admission, bool expiry)
+    {
+        this->epochs = &epochs;
+        this->promote_on_read = promote_on_read;
+        this->capacity = capacity;
+        this->table_size = table_size;
+        mask = table_size - 1;
+        probe_kernel = kernel;
+        region_offset = arena.bytes_used();
+        // A snapshot's arena (see restore()) already holds the contents;
+        // only the pointers into it are set up here.
+        bool fresh = !arena.restored();
+        ctrl = arena.allocate<uint8_t>(table_size + MAX_GROUP_WIDTH);
+        if (fresh)
+            std::memset(ctrl, CTRL_EMPTY, table_size + MAX_GROUP_WIDTH);
+        table = arena.allocate<std::atomic<uint32_t>>(table_size);
+        for (size_t i = 0; i < table_size && fresh; ++i)
+            table[i].store(NIL, std::memory_order_relaxed);
+        meta = arena.allocate<NodeMeta>(capacity);
+        nodes = arena.allocate<NodeData>(capacity);
+        retired_slots = retired_slots_for(capacity);
+        retired_chunks = arena.allocate<RetiredChunk>(retired_slots);
+        slab.init(arena, slab_pages, slab_page_bytes);
+        policy.init(arena, capacity, meta);
+        if (admission == Admission::TinyLfu) {
+            sketch.init(arena, capacity);
+            in_window = arena.allocate<uint8_t>(capacity);
+            window_capacity = std::max<size_t>(1, capacity / 100);
+        }
+        if (expiry)
+            timers.init(arena, capacity, monotonic_ms());
+        region_bytes = arena.bytes_used() - region_offset;
+
+        // Every node starts on the free list, threaded through NodeMeta::next.
+        for (size_t i = 0; i + 1 < capacity && fresh; ++i)
+            meta[i].next = static_cast<uint32_t>(i + 1);
+        free_head = 0;
+    }
 
-            if (bucket.state == BucketState::Deleted) {
-                if (!first_deleted)
-                    first_deleted = idx;
-            } else {
-                Node* node = bucket.node.load(std::memory_order_acquire);
-                if (     node &&
-                           bucket.hash == hash &&
-                           node->key_len == key.size() &&
-                           std::memcmp(node->key, key.data(), key.size()) == 0) {
+    template <typename Policy, typename Lock, typename Stats>
+    typename Shard<Policy, Lock, Stats>::Image Shard<Policy, Lock, Stats>::image() const
+    {
+        Image image{};
+        image.policy = policy.state();
+        image.slab = slab.state();
+        image.sketch_additions = in_window ? sketch.additions_since_aging() : 0;
+        image.window = window;
+        image.free_head = free_head;
+        image.retired_head = retired_head;
+        image.retired_first = retired_first;
+        image.retired_chunk_count = retired_chunk_count;
+        image.current_size = current_size.load(std::memory_order_relaxed);
+        image.payload_bytes = payload_bytes;
+        image.region_offset = region_offset;
+        image.region_bytes = region_bytes;
+        image.version_clock = version_clock;
+        return image;
+    }
+
+    // Every index and offset the shard follows is range-checked here: the
+    // table against ctrl, every live node's chunk against the slab, every
+    // link against the node range, and that live, free and retired nodes
+    // partition the pool (which also rules out cycles in the free lists).
+    template <typename Policy, typename Lock, typename Stats>
+    bool Shard<Policy, Lock, Stats>::restore(const Image& image, uint64_t now, int64_t shift)
+    {
+        if (image.region_offset != region_offset || image.region_bytes != region_bytes ||
+            image.current_size > capacity)
+            return false;
+        if (!policy.restore(image.policy, capacity) || !slab.restore(image.slab))
+            return false;
+        if (in_window ? !image.window.valid(meta, capacity) : !image.window.empty())
+            return false;
+
+        for (size_t m = 0; m < MAX_GROUP_WIDTH; ++m)
+            if (ctrl[table_size + m] != ctrl[m % table_size])
+                return false;
+
+        std::vector<uint8_t> seen(capacity, 0);
+        size_t live = 0;
+        size_t payload = 0;
+        for (size_t idx = 0; idx < table_size; ++idx) {
+            uint32_t node = table[idx].load(std::memory_order_relaxed);
+            if (node == NIL) {
+                if (ctrl[idx] != CTRL_EMPTY)
+                    return false;
+                continue;
+            }
+            if (node >= capacity || seen[node] || ctrl[idx] != tag(meta[node].hash))
+                return false;
+            const NodeData& entry = nodes[node];
+            if (!slab.valid_chunk(entry.data, size_t{entry.key_len} + entry.value_len) ||
+                entry.version > image.version_clock)
+                return false;
+            seen[node] = 1;
+            ++live;
+            payload += entry.key_len + entry.value_len;
+        }
+        if (live != image.current_size || payload != image.payload_bytes)
+            return false;
+
+        // The free and retired lists are chained through NodeMeta::next.
+        size_t listed[2] = {};
+        uint32_t heads[2] = {image.free_head, image.retired_head};
+        for (int list = 0; list < 2; ++list) {
+            for (uint32_t node = heads[list]; node != NIL; node = meta[node].next) {
+                if (node >= capacity || seen[node])
+                    return false;
+                seen[node] = 1;
+                ++listed[list];
+            }
+        }
+        if (live + listed[0] + listed[1] != capacity)
+            return false;
+        if (image.retired_first >= retired_slots || image.retired_chunk_count > retired_slots)
+            return false;
+        for (size_t i = 0; i < image.retired_chunk_count; ++i)
+            if (!slab.valid_chunk(retired_chunks[(image.retired_first + i) % retired_slots].data, 0))
+                return false;
+        for (size_t node = 0; node < capacity; ++node) {
+            if ((meta[node].prev != NIL && meta[node].prev >= capacity) ||
+                (meta[node].next != NIL && meta[node].next >= capacity))
+                return false;
+            if (timers.enabled() && timers.deadline(static_cast<uint32_t>(node)) != 0 &&
+                !resident(static_cast<uint32_t>(node)))
+                return false;
+        }
+
+        window = image.window;
+        free_head = image.free_head;
+        current_size.store(image.current_size, std::memory_order_relaxed);
+        payload_bytes = image.payload_bytes;
+        version_clock = image.version_clock;
+        if (in_window)
+            sketch.restore(image.sketch_additions);
+
+        // Retired nodes and chunks are held until freed; their payload was
+        // already taken off payload_bytes when they were retired.
+        retired_head = image.retired_head;
+        retired_count = listed[1];
+        retired_first = image.retired_first;
+        retired_chunk_count = image.retired_chunk_count;
+        reclaim(EpochDomain::NONE);
+        if (timers.enabled())
+            timers.rebuild(now, shift);
+        return true;
+    }
+
+    // The shard comes from the high 32 bits (multiply-shift, so any shard count
+    // works) and the bucket from the low bits, so the two choices are independent.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    typename BasicKVStore<Policy, Lock, Hasher, Stats>::ShardType& BasicKVStore<Policy, Lock, Hasher, Stats>::shard_for(size_t hash)
+    {
+        return shards[shard_index(hash)];
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::shard_of(std::string_view key) const
+    {
+        return shard_index(Hasher{}(key));
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    int BasicKVStore<Policy, Lock, Hasher, Stats>::shard_node(size_t shard) const
+    {
+        return shard_nodes.empty() ? -1 : shard_nodes[shard];
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    std::pair<bool, size_t> Shard<Policy, Lock, Stats>::find(std::string_view key, size_t hash) const {
+        if (probe_kernel == ProbeKernel::Scalar)
+            return find_in_groups<ScalarGroup>(key, hash);
+        return find_in_groups<SimdGroup>(key, hash);
+    }
+
+    // Returns {true, idx} on a hit and {false, table_size} on a miss. The key
+    // can only sit before the first empty bucket after its home, so each group
+    // only checks tag matches below that point.
+    template <typename Policy, typename Lock, typename Stats>
+    template <typename Group>
+    std::pair<bool, size_t> Shard<Policy, Lock, Stats>::find_in_groups(std::string_view key, size_t hash) const {
+        const uint8_t key_tag = tag(hash);
+        size_t pos = home(hash);
+
+        for (size_t scanned = 0; scanned < table_size; scanned += Group::WIDTH) {
+            Group group(ctrl + pos);
+            uint64_t candidates = group.match(key_tag);
+            uint64_t empty = group.match_empty();
+            if (empty)
+                candidates &= (empty & -empty) - 1;
+
+            while (candidates) {
+                size_t idx = (pos + Group::index(candidates)) & mask;
+                uint32_t node = table[idx].load(std::memory_order_acquire);
+                if (key_matches(node, key, hash))
                     return {true, idx};
-                           }
+                candidates &= candidates - 1;
             }
 
+            if (empty)
+                break;
+            pos = (pos + Group::WIDTH) & mask;
+        }
+        return {false, table_size};
+    }
 
+    // Also safe on torn state seen by an optimistic reader: every index and
+    // offset is range-checked before it is followed.
+    template <typename Policy, typename Lock, typename Stats>
+    bool Shard<Policy, Lock, Stats>::key_matches(uint32_t node, std::string_view key, size_t hash) const
+    {
+        if (node >= capacity || meta[node].hash != hash)
+            return false;
+        uint32_t data = nodes[node].data;
+        return nodes[node].key_len == key.size() &&
+               slab.contains(data, key.size()) &&
+               std::memcmp(slab.data(data), key.data(), key.size()) == 0;
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    std::optional<size_t> Shard<Policy, Lock, Stats>::copy_value(std::string_view key, size_t hash, std::span<char> buffer,
+                                            uint32_t& node, size_t& distance) const
+    {
+        auto [found, idx] = find(key, hash);
+        if (!found)
+            return std::nullopt;
+        distance = this->distance(idx, hash);
 
-            idx = (idx + 1) % LOCAL_CAPACITY;
-            if (idx == start)
-               break;
+        node = table[idx].load(std::memory_order_acquire);
+        if (node >= capacity || expired(node))
+            return std::nullopt;
+
+        NodeData entry = nodes[node];
+        if (!slab.contains(entry.data, size_t{entry.key_len} + entry.value_len))
+            return std::nullopt;
+
+        size_t n = std::min<size_t>(entry.value_len, buffer.size());
+        std::memcpy(buffer.data(), slab.data(entry.data) + entry.key_len, n);
+        return entry.value_len;
+    }
+
+    // find_in_groups() plus the copy, validated like get_into(). Every line a
+    // probe touches after the first is a dependent load (bucket, then node,
+    // then key bytes), so each is prefetched and the task yields before
+    // reading it. Indices and offsets are range-checked before use, as in
+    // copy_value(), since a writer may be moving things underneath.
+    template <typename Policy, typename Lock, typename Stats>
+    template <typename Group>
+    LookupTask Shard<Policy, Lock, Stats>::lookup(std::string_view key, size_t hash, std::span<char> buffer,
+                                           LookupResult& result) const
+    {
+        const uint8_t key_tag = tag(hash);
+
+        for (int attempt = 0; attempt < MAX_OPTIMISTIC_READS; ++attempt) {
+            size_t pos = home(hash);
+            co_await Prefetch{ctrl + pos, table + pos};
+            uint64_t version = seq.read_begin();
+            if (version & 1)
+                continue;
+
+            // An expired match is still the key's only bucket: stop there and
+            // report a miss, as get_into() does.
+            uint32_t hit = NIL;
+            size_t hit_idx = 0;
+            bool matched = false;
+            for (size_t scanned = 0; scanned < table_size; scanned += Group::WIDTH) {
+                Group group(ctrl + pos);
+                uint64_t candidates = group.match(key_tag);
+                uint64_t empty = group.match_empty();
+                if (empty)
+                    candidates &= (empty & -empty) - 1;
+
+                while (candidates) {
+                    size_t idx = (pos + Group::index(candidates)) & mask;
+                    candidates &= candidates - 1;
+                    uint32_t node = table[idx].load(std::memory_order_acquire);
+                    if (node >= capacity)
+                        continue;
+                    co_await Prefetch{meta + node, nodes + node};
+                    if (meta[node].hash != hash)
+                        continue;
+                    uint32_t data = nodes[node].data;
+                    if (slab.contains(data, key.size()))
+                        co_await Prefetch{slab.data(data)};
+                    if (key_matches(node, key, hash)) {
+                        hit = expired(node) ? NIL : node;
+                        hit_idx = idx;
+                        matched = true;
+                        break;
+                    }
+                }
+
+                if (empty || matched)
+                    break;
+                pos = (pos + Group::WIDTH) & mask;
+                co_await Prefetch{ctrl + pos, table + pos};
+            }
+
+            std::optional<size_t> size;
+            if (hit != NIL) {
+                NodeData entry = nodes[hit];
+                if (slab.contains(entry.data, size_t{entry.key_len} + entry.value_len)) {
+                    size_t n = std::min<size_t>(entry.value_len, buffer.size());
+                    std::memcpy(buffer.data(), slab.data(entry.data) + entry.key_len, n);
+                    size = entry.value_len;
+                }
+            }
+            if (!seq.read_retry(version)) {
+                result.size = size;
+                result.node = hit;
+                result.distance = distance(hit_idx, hash);
+                co_return;
+            }
         }
-        return {false, first_deleted.value_or(LOCAL_CAPACITY)};
+        result.fallback = true;
     }
 
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::set_ctrl(size_t idx, uint8_t value)
+    {
+        ctrl[idx] = value;
+        // Keep the mirrored tail in sync. Tables smaller than a group repeat
+        // themselves, so one bucket may have several mirror bytes.
+        for (size_t mirror = idx; mirror < MAX_GROUP_WIDTH; mirror += table_size)
+            ctrl[table_size + mirror] = value;
+    }
+
+    // Robin Hood insertion: walk from home and take the first bucket that is
+    // empty or whose entry is closer to its own home, carrying the displaced
+    // entry forward the same way.
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::insert(uint32_t node)
+    {
+        size_t idx = home(meta[node].hash);
+        size_t dist = 0;
 
+        while (true) {
+            uint32_t current = table[idx].load(std::memory_order_relaxed);
 
-    std::optional<std::string_view> KVStore::get(std::string_view key) {
-        size_t hash = fnv1a(key);
-        size_t shard_idx = hash % NUM_SHARDS;
-        Shard& shard = shards[shard_idx];
+            if (current == NIL) {
+                table[idx].store(node, std::memory_order_release);
+                set_ctrl(idx, tag(meta[node].hash));
+                return;
+            }
 
-        std::lock_guard<SpinLock> guard(shard.lock);
+            size_t current_dist = bucket_distance(idx, current);
+            if (current_dist < dist) {
+                table[idx].store(node, std::memory_order_release);
+                set_ctrl(idx, tag(meta[node].hash));
+                node = current;
+                dist = current_dist;
+            }
 
-        auto [found, idx] = shard.find(key, hash);
-        if (!found) return std::nullopt;
+            idx = (idx + 1) & mask;
+            ++dist;
+        }
+    }
+
+    // Backward-shift deletion: pull each following displaced entry one bucket
+    // closer to home until reaching an empty bucket or one already at home.
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::remove_at(size_t idx)
+    {
+        size_t next = (idx + 1) & mask;
 
-        Shard::Node* node = shard.table[idx].node.load(std::memory_order_acquire);
-        if (!node) return std::nullopt;
+        while (true) {
+            uint32_t node = table[next].load(std::memory_order_relaxed);
+            if (node == NIL || bucket_distance(next, node) == 0)
+                break;
 
-        if (node->key_len != key.size()) return std::nullopt;
-        if (memcmp(node->key, key.data(), key.size()) != 0) return std::nullopt;
+            table[idx].store(node, std::memory_order_release);
+            set_ctrl(idx, ctrl[next]);
+            idx = next;
+            next = (next + 1) & mask;
+        }
 
-        return std::string_view{node->value};
+        table[idx].store(NIL, std::memory_order_release);
+        set_ctrl(idx, CTRL_EMPTY);
     }
 
-    void KVStore::put(std::string_view key, std::string_view value) {
-        size_t hash = fnv1a(key);
-        size_t shard_idx = hash % NUM_SHARDS;
-        Shard& shard = shards[shard_idx];
+    template <typename Policy, typename Lock, typename Stats>
+    size_t Shard<Policy, Lock, Stats>::locate(uint32_t node) const
+    {
+        size_t idx = home(meta[node].hash);
+        for (size_t n = 0; n < table_size; ++n) {
+            if (table[idx].load(std::memory_order_relaxed) == node)
+                return idx;
+            idx = (idx + 1) & mask;
+        }
+        std::abort();
+    }
+
+
 
-        // if (key.size() >= sizeof(Shard::Node::key) || value.size() >= sizeof(Shard::Node::value)) {
-        //     return;
-        // }
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    std::optional<std::string_view> BasicKVStore<Policy, Lock, Hasher, Stats>::get(HashedKey hashed) {
+        auto [key, hash] = hashed;
+        ShardType& shard = shard_for(hash);
 
-        std::lock_guard<SpinLock> guard(shard.lock);
+        typename ShardType::ReadGuard guard(shard.lock);
 
         auto [found, idx] = shard.find(key, hash);
+        if (!found) {
+            shard.stats.miss();
+            return std::nullopt;
+        }
 
-        if (found) {
-            auto* node = shard.table[idx].node.load();
-            size_t val_len = std::min(value.size(), sizeof(node->value) - 1);
-            memcpy(node->value, value.data(), val_len);
-            node->value[val_len] = '\0';
-            node->hash = hash;
-            shard.moveToFront(node);
-            return;
+        uint32_t node = shard.table[idx].load(std::memory_order_acquire);
+        if (shard.expired(node)) {
+            shard.stats.miss();
+            return std::nullopt;
         }
+        shard.stats.hit(shard.distance(idx, hash));
+        shard.on_guarded_hit(node, hash);
+        return shard.value_of(node);
+    }
+
+    // The pin is published before the lookup takes the shard lock, so any
+    // writer that later unlinks this chunk (under the same lock) sees it.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    ValueHandle BasicKVStore<Policy, Lock, Hasher, Stats>::pin(HashedKey hashed) {
+        auto [key, hash] = hashed;
+        ShardType& shard = shard_for(hash);
+        uint32_t slot = common->epochs.pin();
 
-        if (shard.current_size >= LOCAL_CAPACITY) {
-            shard.evict();
-            std::tie(found, idx) = shard.find(key, hash);
-            // if (idx >= LOCAL_CAPACITY) {
-            //     std::abort();
-            // }
+        typename ShardType::ReadGuard guard(shard.lock);
+        auto [found, idx] = shard.find(key, hash);
+        uint32_t node = found ? shard.table[idx].load(std::memory_order_relaxed) : ShardType::NIL;
+        if (!found || shard.expired(node)) {
+            common->epochs.unpin(slot);
+            shard.stats.miss();
+            return {};
         }
 
-        Shard::Node *node = shard.allocate_node();
-        if (!node) {
-            return;
+        shard.stats.hit(shard.distance(idx, hash));
+        shard.on_guarded_hit(node, hash);
+        // Under a shared ReadGuard other pins may set it at the same time.
+        std::atomic_ref<uint8_t>(shard.nodes[node].pinned).store(1, std::memory_order_relaxed);
+        return ValueHandle(&common->epochs, slot, shard.value_of(node));
+    }
+
+    // The entry's version is read alongside its value, so the sequence
+    // check that validates the one validates the other.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    std::optional<size_t> BasicKVStore<Policy, Lock, Hasher, Stats>::read_into(HashedKey hashed, std::span<char> buffer,
+                                                                               uint64_t* version) {
+        auto [key, hash] = hashed;
+        ShardType& shard = shard_for(hash);
+
+        for (int attempt = 0; attempt < MAX_OPTIMISTIC_READS; ++attempt) {
+            uint64_t sequence = shard.seq.read_begin();
+            if (sequence & 1) {
+                cpu_relax();
+                continue;
+            }
+            uint32_t node = ShardType::NIL;
+            size_t distance = 0;
+            auto result = shard.copy_value(key, hash, buffer, node, distance);
+            uint64_t seen = result ? shard.nodes[node].version : 0;
+            if (!shard.seq.read_retry(sequence)) {
+                if (result) {
+                    shard.stats.hit(distance);
+                    shard.record_read(node, hash);
+                } else {
+                    shard.stats.miss();
+                }
+                if (version)
+                    *version = seen;
+                return result;
+            }
+        }
+
+        typename ShardType::ReadGuard guard(shard.lock);
+        uint32_t node = ShardType::NIL;
+        size_t distance = 0;
+        auto result = shard.copy_value(key, hash, buffer, node, distance);
+        if (result) {
+            shard.stats.hit(distance);
+            shard.on_guarded_hit(node, hash);
+        } else {
+            shard.stats.miss();
+        }
+        if (version)
+            *version = result ? shard.nodes[node].version : 0;
+        return result;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    bool BasicKVStore<Policy, Lock, Hasher, Stats>::get_into(HashedKey key, std::string& out) {
+        out.resize(out.capacity());
+        auto size = get_into(key, std::span<char>(out.data(), out.size()));
+        while (size && *size > out.size()) {
+            out.resize(*size);
+            size = get_into(key, std::span<char>(out.data(), out.size()));
+        }
+        out.resize(size.value_or(0));
+        return size.has_value();
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    bool BasicKVStore<Policy, Lock, Hasher, Stats>::get_versioned(HashedKey key, std::string& out, uint64_t& version) {
+        out.resize(out.capacity());
+        auto size = get_versioned(key, std::span<char>(out.data(), out.size()), version);
+        while (size && *size > out.size()) {
+            out.resize(*size);
+            size = get_versioned(key, std::span<char>(out.data(), out.size()), version);
+        }
+        out.resize(size.value_or(0));
+        return size.has_value();
+    }
+
+    // Hashes up to MULTI_BATCH keys and orders them by (shard, position), so
+    // each shard's keys form one run and keep their relative order.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::plan_batch(std::span<const std::string_view> keys, size_t* hashes,
+                                                  uint64_t* order) const {
+        size_t count = std::min(keys.size(), MULTI_BATCH);
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = Hasher{}(keys[i]);
+            order[i] = (static_cast<uint64_t>(shard_index(hashes[i])) << 32) | i;
+        }
+        std::sort(order, order + count);
+        return count;
+    }
+
+    // Each shard's run is looked up under one ReadGuard. The run's home
+    // buckets are prefetched first so the probes overlap their cache misses.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::multi_get(std::span<const std::string_view> keys,
+                                                 std::span<std::optional<std::string>> values) {
+        size_t hits = 0;
+        size_t hashes[MULTI_BATCH];
+        uint64_t order[MULTI_BATCH];
+
+        for (size_t base = 0; base < keys.size(); base += MULTI_BATCH) {
+            size_t count = plan_batch(keys.subspan(base), hashes, order);
+
+            for (size_t run = 0; run < count;) {
+                size_t shard_idx = order[run] >> 32;
+                size_t end = run;
+                while (end < count && (order[end] >> 32) == shard_idx)
+                    ++end;
+
+                ShardType& shard = shards[shard_idx];
+                for (size_t j = run; j < end; ++j)
+                    shard.prefetch(hashes[static_cast<uint32_t>(order[j])]);
+
+                typename ShardType::ReadGuard guard(shard.lock);
+                for (size_t j = run; j < end; ++j) {
+                    auto i = static_cast<uint32_t>(order[j]);
+                    auto [found, idx] = shard.find(keys[base + i], hashes[i]);
+                    std::optional<std::string>& out = values[base + i];
+                    uint32_t node = found ? shard.table[idx].load(std::memory_order_acquire) : ShardType::NIL;
+                    if (!found || shard.expired(node)) {
+                        shard.stats.miss();
+                        out.reset();
+                        continue;
+                    }
+                    shard.stats.hit(shard.distance(idx, hashes[i]));
+                    shard.on_guarded_hit(node, hashes[i]);
+                    if (!out)
+                        out.emplace();
+                    out->assign(shard.value_of(node));
+                    ++hits;
+                }
+                run = end;
+            }
+        }
+        return hits;
+    }
+
+    // Round-robin over up to `depth` suspended lookups. A slot keeps its
+    // position for its whole life, since the running task points at the
+    // slot's result. Values go straight into the caller's strings at their
+    // current capacity; a value that does not fit, or a lookup that fell
+    // back, is redone through get_into().
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::lookup_many(std::span<const std::string_view> keys,
+                                                   std::span<std::optional<std::string>> values, size_t depth) {
+        struct InFlight {
+            LookupTask task;
+            typename ShardType::LookupResult result;
+            size_t index = 0;
+            size_t hash = 0;
+        };
+        InFlight flight[MAX_INTERLEAVE];
+        depth = std::clamp<size_t>(depth, 1, MAX_INTERLEAVE);
+        size_t next = 0;
+        size_t hits = 0;
+
+        auto start = [&](InFlight& slot) {
+            slot.index = next++;
+            slot.hash = Hasher{}(keys[slot.index]);
+            slot.result = {};
+            std::optional<std::string>& out = values[slot.index];
+            if (!out)
+                out.emplace();
+            out->resize(out->capacity());
+            ShardType& shard = shard_for(slot.hash);
+            std::span<char> buffer(out->data(), out->size());
+            if (shard.probe_kernel == ProbeKernel::Scalar)
+                slot.task = shard.template lookup<ScalarGroup>(keys[slot.index], slot.hash, buffer, slot.result);
+            else
+                slot.task = shard.template lookup<SimdGroup>(keys[slot.index], slot.hash, buffer, slot.result);
+        };
+
+        auto finish = [&](InFlight& slot) {
+            std::optional<std::string>& out = values[slot.index];
+            const auto& result = slot.result;
+            if (result.fallback || (result.size && *result.size > out->size())) {
+                if (get_into(keys[slot.index], *out))
+                    ++hits;
+                else
+                    out.reset();
+            } else if (result.size) {
+                out->resize(*result.size);
+                ShardType& shard = shard_for(slot.hash);
+                shard.stats.hit(result.distance);
+                shard.record_read(result.node, slot.hash);
+                ++hits;
+            } else {
+                shard_for(slot.hash).stats.miss();
+                out.reset();
+            }
+        };
+
+        size_t active = 0;
+        for (; active < depth && next < keys.size(); ++active)
+            start(flight[active]);
+
+        while (active > 0) {
+            for (size_t s = 0; s < depth; ++s) {
+                InFlight& slot = flight[s];
+                if (!slot.task)
+                    continue;
+                slot.task.resume();
+                if (!slot.task.done())
+                    continue;
+                finish(slot);
+                if (next < keys.size()) {
+                    start(slot);
+                } else {
+                    slot.task = {};
+                    --active;
+                }
+            }
         }
+        return hits;
+    }
+
+    // Like multi_get, with one lock, write section and read-buffer drain per
+    // shard run. Entries for the same key are applied in input order.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::multi_put(
+        std::span<const std::pair<std::string_view, std::string_view>> entries) {
+        size_t stored = 0;
+        std::string_view keys[MULTI_BATCH];
+        size_t hashes[MULTI_BATCH];
+        uint64_t order[MULTI_BATCH];
+
+        for (size_t base = 0; base < entries.size(); base += MULTI_BATCH) {
+            size_t batch = std::min(entries.size() - base, MULTI_BATCH);
+            for (size_t i = 0; i < batch; ++i)
+                keys[i] = entries[base + i].first;
+            size_t count = plan_batch(std::span<const std::string_view>(keys, batch), hashes, order);
+
+            for (size_t run = 0; run < count;) {
+                size_t shard_idx = order[run] >> 32;
+                size_t end = run;
+                while (end < count && (order[end] >> 32) == shard_idx)
+                    ++end;
+
+                ShardType& shard = shards[shard_idx];
+                for (size_t j = run; j < end; ++j)
+                    shard.prefetch(hashes[static_cast<uint32_t>(order[j])]);
+
+                size_t buffered = 0;
+                {
+                    std::lock_guard<Lock> guard(shard.lock);
+                    SeqLock::WriteSection section(shard.seq);
+                    shard.drain_reads();
+                    shard.expire_due(EXPIRE_BATCH);
+                    for (size_t j = run; j < end; ++j) {
+                        auto i = static_cast<uint32_t>(order[j]);
+                        auto [key, value] = entries[base + i];
+                        if (key.size() + value.size() > max_entry_bytes()) {
+                            auto [found, idx] = shard.find(key, hashes[i]);
+                            if (found)
+                                shard.remove_found(idx);
+                            if (durable)
+                                shard.wal.erase(key);
+                        } else if (put_locked(shard, key, value, hashes[i], 0)) {
+                            ++stored;
+                            if (durable)
+                                shard.wal.put(key, value, 0);
+                        }
+                    }
+                    buffered = shard.wal.size();
+                }
+                if (durable)
+                    logged(buffered);
+                run = end;
+            }
+        }
+        return stored;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    bool BasicKVStore<Policy, Lock, Hasher, Stats>::put(HashedKey key, std::string_view value, std::chrono::milliseconds ttl) {
+        if (!expiry)
+            throw std::logic_error("kvstore: put() with a TTL needs Options::expiry");
+        if (ttl.count() <= 0)
+            throw std::invalid_argument("kvstore: ttl must be positive");
+        return put_until(key, value, monotonic_ms() + static_cast<uint64_t>(ttl.count()));
+    }
 
-        size_t key_len = std::min(key.size(), sizeof(node->key) - 1);
-        memcpy(node->key, key.data(), key_len);
-        node->key[key_len] = '\0';
-        node->key_len = key_len;
-        node->hash = hash;
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    bool BasicKVStore<Policy, Lock, Hasher, Stats>::put_until(HashedKey hashed, std::string_view value, uint64_t deadline) {
+        auto [key, hash] = hashed;
+        ShardType& shard = shard_for(hash);
 
-        size_t val_len = std::min(value.size(), sizeof(node->value) - 1);
-        memcpy(node->value, value.data(), val_len);
-        node->value[val_len] = '\0';
+        if (key.size() + value.size() > max_entry_bytes()) {
+            size_t buffered = 0;
+            shard.erase(key, hash, buffered);
+            if (durable)
+                logged(buffered);
+            return false;
+        }
 
-        shard.insertToFront(node);
+        bool stored;
+        size_t buffered = 0;
+        {
+            std::lock_guard<Lock> guard(shard.lock);
+            SeqLock::WriteSection section(shard.seq);
+            shard.drain_reads();
+            shard.expire_due(EXPIRE_BATCH);
+            stored = put_locked(shard, key, value, hash, deadline);
+            if (durable) {
+                // A put that failed changed nothing a replay would see.
+                if (stored)
+                    shard.wal.put(key, value, wall_deadline(deadline));
+                buffered = shard.wal.size();
+            }
+        }
+        if (durable)
+            logged(buffered);
+        return stored;
+    }
 
-        auto &bucket = shard.table[idx];
-        bucket.hash = hash;
-        bucket.node.store(node);
-        bucket.state = Shard::BucketState::Occupied;
+    // The body of put() for a key that fits, once the caller holds the shard
+    // lock inside a write section. An expired entry is replaced rather than
+    // updated, so the key comes back as new.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    bool BasicKVStore<Policy, Lock, Hasher, Stats>::put_locked(ShardType& shard, std::string_view key, std::string_view value,
+                                                size_t hash, uint64_t deadline) {
+        auto [found, idx] = shard.find(key, hash);
 
-        ++shard.current_size;
+        if (found) {
+            uint32_t node = shard.table[idx].load(std::memory_order_relaxed);
+            if (!shard.expired(node)) {
+                shard.on_hit(node, true);
+                // store_value() fails before it evicts or frees anything, so
+                // the old value stays, and nothing is logged.
+                if (!shard.store_value(node, value))
+                    return false;
+                if (shard.timers.enabled())
+                    shard.timers.schedule(node, deadline);
+                shard.stats.updated();
+                return true;
+            }
+            shard.remove_found(idx);
+        }
+        return insert_locked(shard, key, value, hash, deadline) != ShardType::NIL;
     }
 
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    uint32_t BasicKVStore<Policy, Lock, Hasher, Stats>::insert_locked(ShardType& shard, std::string_view key,
+                                                                      std::string_view value, size_t hash,
+                                                                      uint64_t deadline) {
+        // An eviction frees a node unless it has to park it (see
+        // retire_node()); fail before evicting if it might.
+        if (shard.free_head == ShardType::NIL && !shard.can_retire_chunk(2))
+            return ShardType::NIL;
+        if (shard.current_size.load(std::memory_order_relaxed) >= shard.capacity)
+            shard.make_room();
+
+        uint32_t chunk = shard.allocate_chunk(key.size() + value.size(), ShardType::NIL);
+        if (chunk == SlabAllocator::NONE) {
+            return ShardType::NIL;
+        }
 
-    void Shard::insertToFront(Node* node)
+        uint32_t node = shard.allocate_node();
+        if (node == ShardType::NIL) {
+            shard.slab.free(chunk);
+            return ShardType::NIL;
+        }
+
+        shard.meta[node].hash = hash;
+        shard.nodes[node] = {chunk, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())};
+        shard.stamp(node);
+        char* bytes = shard.slab.data(chunk);
+        std::memcpy(bytes, key.data(), key.size());
+        std::memcpy(bytes + key.size(), value.data(), value.size());
+        shard.payload_bytes += key.size() + value.size();
+
+        shard.admit(node);
+        shard.insert(node);
+        if (deadline)
+            shard.timers.schedule(node, deadline);
+
+        shard.current_size.store(shard.current_size.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        shard.stats.inserted();
+        return node;
+    }
+
+    // Finds a chunk for `bytes`, evicting the policy's victims until one frees
+    // up, expired entries first. `keep` (the entry being updated) is never
+    // evicted; since it may have just expired, updates skip the expired
+    // entries. A victim whose chunk is in another size class would free
+    // nothing `bytes` can use, so instead the emptiest page is cleared and
+    // goes back to the free-page list for this class (memcached's slab
+    // mover, done inline): a new size class costs one page of entries, not
+    // the shard's LRU tail. Every shard has at least two slab pages, so an
+    // allocation no larger than a page only fails once nothing but `keep` is
+    // left, or once a quarter of the shard's nodes are retired behind pinned
+    // ValueHandles (evicting more would free nothing).
+    template <typename Policy, typename Lock, typename Stats>
+    uint32_t Shard<Policy, Lock, Stats>::allocate_chunk(size_t bytes, uint32_t keep)
     {
-        node->prev = nullptr;
-        node->next = head;
+        while (true) {
+            uint32_t chunk = slab.allocate(bytes);
+            if (chunk != SlabAllocator::NONE)
+                return chunk;
+            if (retired_head != NIL || retired_chunk_count != 0) {
+                reclaim(epochs->oldest_pinned());
+                if ((chunk = slab.allocate(bytes)) != SlabAllocator::NONE)
+                    return chunk;
+            }
+            if (retired_count > capacity / 4)
+                return chunk;
+            if (keep == NIL && expire_due(1))
+                continue;
+            uint32_t victim = this->victim(keep);
+            if (victim == NIL)
+                return chunk;
+            if (!slab.same_class(nodes[victim].data, bytes)) {
+                uint32_t page = slab.emptiest_page(keep == NIL ? SlabAllocator::NONE : nodes[keep].data);
+                if (page != SlabAllocator::NONE && evict_page(page) != 0)
+                    continue;
+            }
+            evict_node(victim);
+            stats.evicted();
+        }
+    }
 
-        if (head)
-            head->prev = node;
-        else
-            tail = node;
+    // Evicts the entries whose chunks are on `page`. There is no map from a
+    // chunk back to its node, so this scans the nodes, stopping once the
+    // page's live count is accounted for; chunks of retired nodes stay until
+    // reclaim() frees them.
+    template <typename Policy, typename Lock, typename Stats>
+    size_t Shard<Policy, Lock, Stats>::evict_page(uint32_t page)
+    {
+        size_t live = slab.live_chunks(page);
+        size_t evicted = 0;
+        for (uint32_t node = 0; node < capacity && evicted < live; ++node) {
+            uint32_t data = nodes[node].data;
+            if (data == SlabAllocator::NONE || slab.page_of(data) != page || !resident(node))
+                continue;
+            evict_node(node);
+            stats.evicted();
+            ++evicted;
+        }
+        return evicted;
+    }
+
+    // Overwrites in place when the new value still fits the entry's chunk and
+    // no ValueHandle can be reading it, otherwise moves the entry to a new
+    // chunk. A chunk that handles may be reading is retired to the ring; a
+    // slot for it is found before anything is evicted, so a write that fails
+    // leaves the shard as it was.
+    template <typename Policy, typename Lock, typename Stats>
+    bool Shard<Policy, Lock, Stats>::store_value(uint32_t node, std::string_view value, size_t keep)
+    {
+        NodeData& entry = nodes[node];
+        size_t value_len = keep + value.size();
+        size_t needed = entry.key_len + value_len;
+        bool shared = entry.pinned && epochs->oldest_pinned() != EpochDomain::NONE;
+
+        if (!shared && needed <= slab.chunk_size(entry.data)) {
+            std::memcpy(slab.data(entry.data) + entry.key_len + keep, value.data(), value.size());
+            payload_bytes += value_len;
+            payload_bytes -= entry.value_len;
+        } else {
+            if (shared && !can_retire_chunk())
+                return false;
+            uint32_t chunk = allocate_chunk(needed, node);
+            if (chunk == SlabAllocator::NONE)
+                return false;
+            char* bytes = slab.data(chunk);
+            std::memcpy(bytes, slab.data(entry.data), entry.key_len + keep);
+            std::memcpy(bytes + entry.key_len + keep, value.data(), value.size());
+            if (shared)
+                retire_chunk(entry.data);
+            else
+                slab.free(entry.data);
+            payload_bytes -= entry.key_len + entry.value_len;
+            payload_bytes += needed;
+            entry.data = chunk;
+        }
 
-        head = node;
+        entry.pinned = 0;
+        entry.value_len = static_cast<uint32_t>(value_len);
+        stamp(node);
+        return true;
     }
 
 
+    // Policies with CONCURRENT_ACCESS take the hit directly. Everything else
+    // (LRU splices, sketch counts) is buffered: an entry is the node index plus
+    // the top half of its hash, and since the node may have been evicted or
+    // reused by the time it is drained, draining checks both first.
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::record_read(uint32_t node, size_t hash)
+    {
+        if constexpr (Policy::CONCURRENT_ACCESS) {
+            if (promote_on_read)
+                policy.on_access(node);
+        }
+        bool buffered = in_window || (promote_on_read && !Policy::CONCURRENT_ACCESS);
+        if (!buffered)
+            return;
 
-    void Shard::unlink(Node* node)
+        uint64_t entry = (hash & 0xFFFFFFFF00000000ull) | node;
+        if (reads.record(entry) && lock.try_lock()) {
+            drain_reads();
+            lock.unlock();
+        }
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::drain_reads()
     {
-        if (node->prev)
-            node->prev->next = node->next;
-        else
-            head = node->next;
+        reads.drain([this](uint64_t entry) {
+            auto node = static_cast<uint32_t>(entry);
+            if (node >= capacity ||
+                (meta[node].hash & 0xFFFFFFFF00000000ull) != (entry & 0xFFFFFFFF00000000ull) ||
+                !resident(node))
+                return;
+            if (in_window)
+                sketch.increment(meta[node].hash);
+            if (promote_on_read && !Policy::CONCURRENT_ACCESS)
+                promote(node);
+        });
+    }
 
-        if (node->next)
-            node->next->prev = node->prev;
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::on_guarded_hit(uint32_t node, size_t hash)
+    {
+        if constexpr (SharedLockable<Lock>)
+            record_read(node, hash);
         else
-            tail = node->prev;
+            on_hit(node, promote_on_read);
+    }
 
-        node->prev = nullptr;
-        node->next = nullptr;
+    // A read or overwrite hit seen under the lock.
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::on_hit(uint32_t node, bool promote)
+    {
+        if (in_window)
+            sketch.increment(meta[node].hash);
+        if (promote)
+            this->promote(node);
     }
 
-    void Shard::moveToFront(Node* node)
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::promote(uint32_t node)
     {
-        if (node == head)
-            return;
-        unlink(node);
-        insertToFront(node);
+        if (in_window && in_window[node]) {
+            window.unlink(meta, node);
+            window.push_front(meta, node);
+        } else {
+            policy.on_access(node);
+        }
     }
 
+    template <typename Policy, typename Lock, typename Stats>
+    bool Shard<Policy, Lock, Stats>::resident(uint32_t node) const
+    {
+        if (in_window && in_window[node])
+            return true;
+        return policy.contains(node);
+    }
 
-    void Shard::evict() {
-        if (!tail)
+    // New keys always enter: straight into the policy, or into the window,
+    // whose overflow moves on to the policy while the shard still has room.
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::admit(uint32_t node)
+    {
+        if (!in_window) {
+            policy.on_insert(node);
             return;
+        }
 
-        Node* node = tail;
+        sketch.increment(meta[node].hash);
+        window.push_front(meta, node);
+        in_window[node] = 1;
+        if (window.size > window_capacity) {
+            uint32_t oldest = window.tail;
+            window.unlink(meta, oldest);
+            in_window[oldest] = 0;
+            policy.on_insert(oldest);
+        }
+    }
 
-        size_t hash = node->hash;
-        size_t idx = hash % LOCAL_CAPACITY;
-        size_t start = idx;
+    // Frees one entry before an insert into a full shard: an expired one if
+    // there is any. Otherwise, with TinyLFU the window's oldest key and the
+    // policy's victim compete; the one the sketch has seen less often goes
+    // (the incumbent wins ties).
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::make_room()
+    {
+        if (expire_due(1))
+            return;
+        if (!in_window || window.empty()) {
+            evict();
+            return;
+        }
 
-        bool removed = false;
+        uint32_t candidate = window.tail;
+        uint32_t incumbent = policy.victim(NIL);
+        if (incumbent == NIL ||
+            sketch.estimate(meta[candidate].hash) <= sketch.estimate(meta[incumbent].hash)) {
+            evict_node(candidate);
+            stats.evicted();
+            return;
+        }
 
-        while (true) {
-            auto& bucket = table[idx];
-            Node* current = bucket.node.load(std::memory_order_acquire);
+        evict_node(incumbent);
+        stats.evicted();
+        window.unlink(meta, candidate);
+        in_window[candidate] = 0;
+        policy.on_insert(candidate);
+    }
 
-            if (current &&
-                bucket.hash == hash &&
-                current->key_len == node->key_len &&
-                std::memcmp(current->key, node->key, node->key_len) == 0) {
+    // The policy's victim, or the window's oldest key once the policy is empty.
+    template <typename Policy, typename Lock, typename Stats>
+    uint32_t Shard<Policy, Lock, Stats>::victim(uint32_t keep)
+    {
+        uint32_t node = policy.victim(keep);
+        if (node != NIL || !in_window)
+            return node;
+        node = window.tail;
+        return node != keep ? node : meta[node].prev;
+    }
 
-                bucket.node.store(nullptr, std::memory_order_release);
-                bucket.state = BucketState::Deleted;
-                removed = true;
-                break;
-                }
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::detach(uint32_t node)
+    {
+        if (timers.enabled())
+            timers.cancel(node);
+        if (in_window && in_window[node]) {
+            window.unlink(meta, node);
+            in_window[node] = 0;
+        } else {
+            policy.on_remove(node);
+        }
+    }
 
-            idx = (idx + 1) % LOCAL_CAPACITY;
-            if (idx == start)
+    template <typename Policy, typename Lock, typename Stats>
+    size_t Shard<Policy, Lock, Stats>::expire_due(size_t max) {
+        if (!timers.enabled() || timers.empty())
+            return 0;
+        uint32_t due[EXPIRE_BATCH];
+        size_t total = 0;
+        uint64_t now = monotonic_ms();
+        while (total < max) {
+            size_t batch = std::min(max - total, EXPIRE_BATCH);
+            size_t n = timers.advance(now, due, batch);
+            for (size_t i = 0; i < n; ++i) {
+                evict_node(due[i]);
+                stats.expired();
+            }
+            total += n;
+            if (n < batch)
                 break;
         }
+        return total;
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::evict() {
+        uint32_t node = victim(NIL);
+        if (node != NIL) {
+            evict_node(node);
+            stats.evicted();
+        }
+    }
 
-        if (!removed) {
-            std::abort();
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::evict_node(uint32_t node) {
+        remove_at(locate(node));
+        detach(node);
+        retire_node(node);
+        current_size.store(current_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    bool BasicKVStore<Policy, Lock, Hasher, Stats>::erase(HashedKey hashed) {
+        auto [key, hash] = hashed;
+        ShardType& shard = shard_for(hash);
+        size_t buffered = 0;
+        bool erased = shard.erase(key, hash, buffered);
+        if (durable)
+            logged(buffered);
+        return erased;
+    }
+
+    // One probe finds the entry the update reads and writes; an expired one
+    // is removed first, as put_locked() does, so that an update inserting
+    // the key finds the slot free.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    template <typename Update>
+    RmwStatus BasicKVStore<Policy, Lock, Hasher, Stats>::modify(HashedKey hashed, Update&& update) {
+        auto [key, hash] = hashed;
+        ShardType& shard = shard_for(hash);
+
+        RmwStatus status;
+        uint32_t written = ShardType::NIL;
+        size_t buffered = 0;
+        {
+            std::lock_guard<Lock> guard(shard.lock);
+            SeqLock::WriteSection section(shard.seq);
+            shard.drain_reads();
+            shard.expire_due(EXPIRE_BATCH);
+            auto [found, idx] = shard.find(key, hash);
+            uint32_t node = found ? shard.table[idx].load(std::memory_order_relaxed) : ShardType::NIL;
+            if (node != ShardType::NIL && shard.expired(node)) {
+                shard.remove_found(idx);
+                node = ShardType::NIL;
+            }
+            if (node != ShardType::NIL)
+                shard.on_hit(node, true);
+            status = update(shard, node, written);
+            if (written != ShardType::NIL) {
+                if (written == node)
+                    shard.stats.updated();
+                if (durable) {
+                    uint64_t deadline = shard.timers.enabled() ? shard.timers.deadline(written) : 0;
+                    shard.wal.put(key, shard.value_of(written), wall_deadline(deadline));
+                    buffered = shard.wal.size();
+                }
+            }
         }
+        if (written != ShardType::NIL && durable)
+            logged(buffered);
+        return status;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    RmwStatus BasicKVStore<Policy, Lock, Hasher, Stats>::compare_and_swap(HashedKey key, uint64_t& version,
+                                                                         std::string_view value) {
+        if (key.key.size() + value.size() > max_entry_bytes())
+            return RmwStatus::NotStored;
+        return modify(key, [&](ShardType& shard, uint32_t node, uint32_t& written) {
+            if (node == ShardType::NIL) {
+                version = 0;
+                return RmwStatus::NotFound;
+            }
+            if (shard.nodes[node].version != version) {
+                version = shard.nodes[node].version;
+                return RmwStatus::Mismatch;
+            }
+            if (!shard.store_value(node, value))
+                return RmwStatus::NotStored;
+            written = node;
+            version = shard.nodes[node].version;
+            return RmwStatus::Ok;
+        });
+    }
+
+    // The value is parsed where it lies in the chunk and the result, at
+    // most 20 digits, formatted on the stack; it goes back into the same
+    // chunk unless a ValueHandle is out.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    RmwStatus BasicKVStore<Policy, Lock, Hasher, Stats>::add(HashedKey key, uint64_t delta, bool subtract,
+                                                            uint64_t& result, std::optional<uint64_t> initial) {
+        return modify(key, [&](ShardType& shard, uint32_t node, uint32_t& written) {
+            char digits[20];
+            if (node == ShardType::NIL) {
+                if (!initial)
+                    return RmwStatus::NotFound;
+                char* end = std::to_chars(digits, digits + sizeof(digits), *initial).ptr;
+                if (key.key.size() + (end - digits) > max_entry_bytes())
+                    return RmwStatus::NotStored;
+                written = insert_locked(shard, key.key, std::string_view(digits, end - digits), key.hash, 0);
+                if (written == ShardType::NIL)
+                    return RmwStatus::NotStored;
+                result = *initial;
+                return RmwStatus::Ok;
+            }
+
+            std::string_view text = shard.value_of(node);
+            uint64_t current = 0;
+            auto [parsed, error] = std::from_chars(text.data(), text.data() + text.size(), current);
+            if (text.empty() || error != std::errc{} || parsed != text.data() + text.size())
+                return RmwStatus::NotNumeric;
+            uint64_t next = !subtract ? current + delta : current > delta ? current - delta : 0;
+            char* end = std::to_chars(digits, digits + sizeof(digits), next).ptr;
+            if (key.key.size() + (end - digits) > max_entry_bytes() ||
+                !shard.store_value(node, std::string_view(digits, end - digits)))
+                return RmwStatus::NotStored;
+            written = node;
+            result = next;
+            return RmwStatus::Ok;
+        });
+    }
 
-        unlink(node);
-        free_node(node);
-        --current_size;
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    RmwStatus BasicKVStore<Policy, Lock, Hasher, Stats>::append(HashedKey key, std::string_view suffix) {
+        return modify(key, [&](ShardType& shard, uint32_t node, uint32_t& written) {
+            if (node == ShardType::NIL)
+                return RmwStatus::NotFound;
+            size_t kept = shard.nodes[node].value_len;
+            if (key.key.size() + kept + suffix.size() > max_entry_bytes() ||
+                !shard.store_value(node, suffix, kept))
+                return RmwStatus::NotStored;
+            written = node;
+            return RmwStatus::Ok;
+        });
     }
 
-    bool KVStore::erase(std::string_view key) {
-        size_t hash = fnv1a(key);
-        Shard& shard = shards[hash % NUM_SHARDS];
-        return shard.erase(key, hash);
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    RmwStatus BasicKVStore<Policy, Lock, Hasher, Stats>::get_and_set(HashedKey key, std::string_view value,
+                                                                    std::string& previous) {
+        previous.clear();
+        bool fits = key.key.size() + value.size() <= max_entry_bytes();
+        return modify(key, [&](ShardType& shard, uint32_t node, uint32_t& written) {
+            if (node == ShardType::NIL) {
+                if (fits)
+                    written = insert_locked(shard, key.key, value, key.hash, 0);
+                return written != ShardType::NIL ? RmwStatus::NotFound : RmwStatus::NotStored;
+            }
+            previous.assign(shard.value_of(node));
+            if (!fits || !shard.store_value(node, value))
+                return RmwStatus::NotStored;
+            written = node;
+            return RmwStatus::Ok;
+        });
     }
 
 
-    bool Shard::erase(std::string_view key, size_t hash) {
-        lock.lock();
+    template <typename Policy, typename Lock, typename Stats>
+    bool Shard<Policy, Lock, Stats>::erase(std::string_view key, size_t hash, size_t& buffered) {
+        std::lock_guard<Lock> guard(lock);
+        // Logged even on a miss: replay may not have evicted the key.
+        if (logging) {
+            wal.erase(key);
+            buffered = wal.size();
+        }
         auto [found, idx] = find(key, hash);
-        if (!found) {
-            lock.unlock();
+        if (!found)
             return false;
+
+        bool live = !expired(table[idx].load(std::memory_order_relaxed));
+        SeqLock::WriteSection section(seq);
+        remove_found(idx);
+        return live;
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::remove_found(size_t idx) {
+        uint32_t node = table[idx].load(std::memory_order_relaxed);
+        if (expired(node))
+            stats.expired();
+        else
+            stats.erased();
+
+        remove_at(idx);
+        detach(node);
+        retire_node(node);
+
+        current_size.store(current_size.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    }
+
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::expire() {
+        size_t total = 0;
+        for (size_t i = 0; i < num_shards && expiry; ++i) {
+            ShardType& shard = shards[i];
+            while (true) {
+                std::lock_guard<Lock> guard(shard.lock);
+                if (!shard.timers.due(monotonic_ms()))
+                    break;
+                SeqLock::WriteSection section(shard.seq);
+                size_t n = shard.expire_due(EXPIRE_BATCH);
+                total += n;
+                if (n < EXPIRE_BATCH)
+                    break;
+            }
         }
+        return total;
+    }
 
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < num_shards; ++i) {
+            const ShardType& shard = shards[i];
+            std::lock_guard<Lock> guard(shard.lock);
+            total += shard.current_size.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
 
-        Node* node = table[idx].node.load(std::memory_order_acquire);
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::approximate_size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < num_shards; ++i)
+            total += shards[i].current_size.load(std::memory_order_relaxed);
+        return total;
+    }
 
-        if (!node) {
-            lock.unlock();
-            return false;
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::capacity() const {
+        return total_capacity;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::shard_count() const {
+        return num_shards;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    size_t BasicKVStore<Policy, Lock, Hasher, Stats>::memory_budget() const {
+        return total_budget;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    MemoryUsage BasicKVStore<Policy, Lock, Hasher, Stats>::memory_usage() const {
+        MemoryUsage usage;
+        for (size_t i = 0; i < num_shards; ++i) {
+            const ShardType& shard = shards[i];
+            std::lock_guard<Lock> guard(shard.lock);
+            usage.entries += shard.current_size.load(std::memory_order_relaxed);
+            usage.index_bytes += shard.table_size + MAX_GROUP_WIDTH +
+                                 shard.table_size * sizeof(uint32_t) +
+                                 shard.capacity * (sizeof(NodeMeta) + sizeof(typename ShardType::NodeData)) +
+                                 Policy::storage_bytes(shard.capacity);
+            if (shard.in_window) {
+                size_t admission = shard.sketch.bytes() + shard.capacity;
+                usage.index_bytes += admission;
+                usage.admission_bytes += admission;
+            }
+            if (shard.timers.enabled())
+                usage.index_bytes += shard.timers.bytes();
+            usage.data_bytes_reserved += shard.slab.pages_in_use() * shard.slab.page_size();
+            usage.data_bytes_used += shard.slab.bytes_in_use();
+            usage.payload_bytes += shard.payload_bytes;
         }
+        return usage;
+    }
 
-        unlink(node);
-        free_node(node);
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    void BasicKVStore<Policy, Lock, Hasher, Stats>::snapshot(const std::string& path) {
+        write_snapshot(path, wal_generation, false);
+    }
 
-        table[idx].node.store(nullptr, std::memory_order_release);
-        table[idx].state = BucketState::Deleted;
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    void BasicKVStore<Policy, Lock, Hasher, Stats>::write_snapshot(const std::string& path, uint64_t generation,
+                                                            bool compacting) {
+        using Image = typename ShardType::Image;
+
+        SnapshotHeader header;
+        header.image_bytes = sizeof(Image);
+        std::strncpy(header.policy, typeid(Policy).name(), sizeof(header.policy) - 1);
+        std::strncpy(header.hasher, typeid(Hasher).name(), sizeof(header.hasher) - 1);
+        const ShardType& first = shards[0];
+        header.capacity = total_capacity;
+        header.memory_budget = total_budget;
+        header.num_shards = num_shards;
+        header.load_factor = load_factor;
+        header.probe_kernel = static_cast<uint8_t>(first.probe_kernel);
+        header.promote_on_read = first.promote_on_read;
+        header.admission = static_cast<uint8_t>(first.in_window ? Admission::TinyLfu : Admission::Always);
+        header.expiry = expiry;
+        header.numa = static_cast<uint8_t>(numa);
+        header.expiry_interval_ms = expiry_interval.count();
+        header.images_offset = Arena::bytes_for<SnapshotHeader>(1);
+        header.arena_offset = (header.images_offset + num_shards * sizeof(Image) + SNAPSHOT_ALIGNMENT - 1) /
+                              SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+        header.arena_bytes = arena.capacity();
+        header.file_bytes = header.arena_offset + header.arena_bytes;
+        header.monotonic_ms = monotonic_ms();
+        header.wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        header.wal_generation = generation;
+
+        SnapshotWriter writer(path, header.file_bytes);
+        std::vector<Image> images(num_shards);
+        std::vector<std::byte> region;
+        for (size_t i = 0; i < num_shards; ++i) {
+            ShardType& shard = shards[i];
+            {
+                std::lock_guard<Lock> guard(shard.lock);
+                SeqLock::WriteSection section(shard.seq);
+                shard.drain_reads();
+                region.resize(shard.region_bytes);
+                std::memcpy(region.data(), arena.data() + shard.region_offset, shard.region_bytes);
+                images[i] = shard.image();
+                if (compacting)
+                    wal_batch[i].swap(shard.wal);
+            }
+            writer.write(header.arena_offset + shard.region_offset, region.data(), region.size());
+        }
+        writer.write(0, &header, sizeof(header));
+        writer.write(header.images_offset, images.data(), images.size() * sizeof(Image));
+        writer.commit();
+    }
 
-        --current_size;
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    std::unique_ptr<BasicKVStore<Policy, Lock, Hasher, Stats>> BasicKVStore<Policy, Lock, Hasher, Stats>::load(
+        const std::string& path) {
+        SnapshotReader reader(path);
+        const SnapshotHeader& header = reader.header();
+        Options options;
+        options.capacity = header.capacity;
+        options.memory_budget = header.memory_budget;
+        options.num_shards = header.num_shards;
+        options.load_factor = header.load_factor;
+        options.probe_kernel = static_cast<ProbeKernel>(header.probe_kernel);
+        options.promote_on_read = header.promote_on_read != 0;
+        options.admission = static_cast<Admission>(header.admission);
+        options.expiry = header.expiry != 0;
+        options.numa = static_cast<NumaPlacement>(header.numa);
+        options.expiry_interval = std::chrono::milliseconds{header.expiry_interval_ms};
+        return std::unique_ptr<BasicKVStore>(new BasicKVStore(options, &reader));
+    }
 
-        lock.unlock();
-        return true;
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    std::unique_ptr<SnapshotReader> BasicKVStore<Policy, Lock, Hasher, Stats>::open_snapshot(const Options& options) {
+        if (options.wal_path.empty() || !std::filesystem::exists(options.wal_path + ".snap"))
+            return nullptr;
+        return std::make_unique<SnapshotReader>(options.wal_path + ".snap");
+    }
+
+    // The layout after the header page: Common, the shards, and from the
+    // next page on the arena. Every field of the header but the segment's
+    // own bookkeeping must match for an attaching store to use it.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    bool BasicKVStore<Policy, Lock, Hasher, Stats>::open_shared(const Options& options, size_t arena_bytes) {
+        static_assert(alignof(ShardType) <= Arena::ALIGNMENT && alignof(Common) <= Arena::ALIGNMENT);
+        constexpr size_t PAGE = 4096;
+        static_assert(sizeof(SharedHeader) <= PAGE);
+
+        SharedHeader layout;
+        std::strncpy(layout.policy, typeid(Policy).name(), sizeof(layout.policy) - 1);
+        std::strncpy(layout.lock, typeid(Lock).name(), sizeof(layout.lock) - 1);
+        std::strncpy(layout.hasher, typeid(Hasher).name(), sizeof(layout.hasher) - 1);
+        layout.shard_bytes = sizeof(ShardType);
+        layout.capacity = total_capacity;
+        layout.memory_budget = total_budget;
+        layout.num_shards = num_shards;
+        layout.load_factor = options.load_factor;
+        layout.probe_kernel = static_cast<uint8_t>(options.probe_kernel);
+        layout.promote_on_read = options.promote_on_read;
+        layout.admission = static_cast<uint8_t>(options.admission);
+        layout.expiry = options.expiry;
+        layout.state_offset = PAGE;
+        layout.shards_offset = layout.state_offset + Arena::bytes_for<Common>(1);
+        layout.arena_offset = (layout.shards_offset + num_shards * sizeof(ShardType) + PAGE - 1) / PAGE * PAGE;
+        layout.arena_bytes = arena_bytes;
+
+        // Create, or attach if the name exists; a segment whose creator
+        // failed may vanish in between, so try again a few times.
+        for (int attempt = 0; attempt < 3 && !segment; ++attempt) {
+            segment = SharedSegment::create(options.shared_name, layout.arena_offset + arena_bytes);
+            if (!segment)
+                segment = SharedSegment::attach(options.shared_name);
+        }
+        if (!segment)
+            throw std::runtime_error("kvstore: cannot create or attach shared segment " + options.shared_name);
+
+        SharedHeader& header = segment->header();
+        std::byte* base = segment->data();
+        if (segment->created()) {
+            std::memcpy(header.policy, layout.policy, sizeof(layout.policy));
+            std::memcpy(header.lock, layout.lock, sizeof(layout.lock));
+            std::memcpy(header.hasher, layout.hasher, sizeof(layout.hasher));
+            header.shard_bytes = layout.shard_bytes;
+            header.capacity = layout.capacity;
+            header.memory_budget = layout.memory_budget;
+            header.num_shards = layout.num_shards;
+            header.load_factor = layout.load_factor;
+            header.probe_kernel = layout.probe_kernel;
+            header.promote_on_read = layout.promote_on_read;
+            header.admission = layout.admission;
+            header.expiry = layout.expiry;
+            header.state_offset = layout.state_offset;
+            header.shards_offset = layout.shards_offset;
+            header.arena_offset = layout.arena_offset;
+            header.arena_bytes = layout.arena_bytes;
+
+            common = new (base + layout.state_offset) Common;
+            shards = reinterpret_cast<ShardType*>(base + layout.shards_offset);
+            for (size_t i = 0; i < num_shards; ++i)
+                new (shards + i) ShardType;
+        } else {
+            auto fields = [](const SharedHeader& h) {
+                return std::tie(h.shard_bytes, h.capacity, h.memory_budget, h.num_shards, h.load_factor,
+                                h.probe_kernel, h.promote_on_read, h.admission, h.expiry,
+                                h.state_offset, h.shards_offset, h.arena_offset, h.arena_bytes);
+            };
+            if (std::memcmp(header.policy, layout.policy, sizeof(layout.policy)) != 0 ||
+                std::memcmp(header.lock, layout.lock, sizeof(layout.lock)) != 0 ||
+                std::memcmp(header.hasher, layout.hasher, sizeof(layout.hasher)) != 0 ||
+                fields(header) != fields(layout) || header.arena_offset + arena_bytes > segment->size())
+                throw std::runtime_error("kvstore: shared segment " + options.shared_name +
+                                         " was created by a different store type or Options");
+            common = reinterpret_cast<Common*>(base + layout.state_offset);
+            shards = reinterpret_cast<ShardType*>(base + layout.shards_offset);
+        }
+        arena = Arena(base + layout.arena_offset, arena_bytes);
+        return segment->created();
     }
 
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    int64_t BasicKVStore<Policy, Lock, Hasher, Stats>::wall_deadline(uint64_t deadline) {
+        if (deadline == 0)
+            return 0;
+        auto wall_now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        return wall_now + (static_cast<int64_t>(deadline) - static_cast<int64_t>(monotonic_ms()));
+    }
 
-    size_t KVStore::size() const {
-        size_t total = 0;
-        for (const auto& shard : shards) {
-            std::lock_guard<SpinLock> guard(shard.lock);
-            total += shard.current_size;
+    // Replay goes through put() and erase() before logging is switched on.
+    // A record whose TTL ran out while the store was down erases the key,
+    // like any later write would have. Replayed eviction may differ from
+    // the original run's (reads are not logged), which only changes which
+    // entries a full store kept.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    void BasicKVStore<Policy, Lock, Hasher, Stats>::open_log(const Options& options, uint64_t generation) {
+        wal_path = options.wal_path;
+        auto log = std::make_unique<WriteAheadLog>(wal_path);
+        auto log_generation = log->generation();
+        if (log_generation && *log_generation > generation)
+            throw std::runtime_error("kvstore: " + wal_path + " is newer than its snapshot");
+
+        size_t replayed = 0;
+        if (log_generation == generation) {
+            auto wall_now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            uint64_t now = monotonic_ms();
+            replayed = log->replay([&](const WalRecord& record) {
+                HashedKey key = prehash(record.key);
+                if (record.type == WalRecord::Type::Erase ||
+                    (record.deadline_ms != 0 && expiry && record.deadline_ms <= wall_now))
+                    erase(key);
+                else if (record.deadline_ms != 0 && expiry)
+                    put_until(key, record.value, now + static_cast<uint64_t>(record.deadline_ms - wall_now));
+                else
+                    put(key, record.value);
+            });
         }
-        return total;
+
+        wal_batch = std::make_unique<WalBuffer[]>(num_shards);
+        if (replayed > 0)
+            write_snapshot(wal_path + ".snap", ++generation, false);
+        log->reset(generation);
+        wal = std::move(log);
+        wal_generation = generation;
+
+        wal_shard_bytes = std::max<size_t>(4096, options.wal_commit_bytes / num_shards);
+        for (size_t i = 0; i < num_shards; ++i) {
+            // The two buffers trade places on every commit, so both are
+            // sized up front.
+            shards[i].wal.reserve(2 * wal_shard_bytes);
+            wal_batch[i].reserve(2 * wal_shard_bytes);
+            shards[i].logging = true;
+        }
+        durable = true;
+        committer = std::jthread([this, interval = options.wal_commit_interval](std::stop_token stop) {
+            std::unique_lock<std::mutex> lock(commit_mutex);
+            while (!stop.stop_requested()) {
+                commit_wake.wait_for(lock, stop, interval,
+                                     [this] { return commit_requested.load(std::memory_order_relaxed); });
+                lock.unlock();
+                commit_log();
+                lock.lock();
+            }
+        });
     }
 
+    // A failure is kept for sync() to report; the records of a failed
+    // commit are lost.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    void BasicKVStore<Policy, Lock, Hasher, Stats>::commit_log() {
+        std::lock_guard<std::mutex> guard(wal_mutex);
+        commit_requested.store(false, std::memory_order_relaxed);
+        size_t bytes = 0;
+        for (size_t i = 0; i < num_shards; ++i) {
+            std::lock_guard<Lock> shard_guard(shards[i].lock);
+            wal_batch[i].swap(shards[i].wal);
+            bytes += wal_batch[i].size();
+        }
+        if (bytes == 0)
+            return;
 
+        try {
+            wal->append(std::span<const WalBuffer>(wal_batch.get(), num_shards));
+            wal->sync();
+        } catch (const std::system_error&) {
+            wal_failure = std::current_exception();
+        }
+        for (size_t i = 0; i < num_shards; ++i)
+            wal_batch[i].clear();
+    }
 
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    void BasicKVStore<Policy, Lock, Hasher, Stats>::logged(size_t buffered) {
+        if (buffered < wal_shard_bytes)
+            return;
+        if (buffered >= WAL_BACKPRESSURE * wal_shard_bytes) {
+            commit_log();
+            return;
+        }
+        if (!commit_requested.load(std::memory_order_relaxed) &&
+            !commit_requested.exchange(true, std::memory_order_relaxed)) {
+            // Taking the mutex orders this with the commit thread's check of
+            // the flag, so the wakeup cannot slip in before it waits.
+            { std::lock_guard<std::mutex> guard(commit_mutex); }
+            commit_wake.notify_one();
+        }
+    }
 
-    Shard::Node* Shard::allocate_node()
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    void BasicKVStore<Policy, Lock, Hasher, Stats>::sync() {
+        if (!durable)
+            throw std::logic_error("kvstore: sync() needs Options::wal_path");
+        commit_log();
+        std::lock_guard<std::mutex> guard(wal_mutex);
+        if (wal_failure)
+            std::rethrow_exception(std::exchange(wal_failure, nullptr));
+    }
+
+    // Holding wal_mutex keeps commits off the log until it is reset, so
+    // everything it loses is in the new snapshot: up to each shard's copy
+    // from the log itself, and the shard's buffer at that point from
+    // wal_batch. Should the snapshot fail, the batch is committed instead.
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    void BasicKVStore<Policy, Lock, Hasher, Stats>::compact() {
+        if (!durable)
+            throw std::logic_error("kvstore: compact() needs Options::wal_path");
+        std::lock_guard<std::mutex> guard(wal_mutex);
+        try {
+            write_snapshot(wal_path + ".snap", wal_generation + 1, true);
+        } catch (...) {
+            wal->append(std::span<const WalBuffer>(wal_batch.get(), num_shards));
+            wal->sync();
+            for (size_t i = 0; i < num_shards; ++i)
+                wal_batch[i].clear();
+            throw;
+        }
+        for (size_t i = 0; i < num_shards; ++i)
+            wal_batch[i].clear();
+        wal->reset(++wal_generation);
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    LockCounters BasicKVStore<Policy, Lock, Hasher, Stats>::lock_counters() const {
+        LockCounters total;
+        for (size_t i = 0; i < num_shards; ++i)
+            total += shards[i].lock.counters();
+        return total;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    StoreStats BasicKVStore<Policy, Lock, Hasher, Stats>::stats() const {
+        StoreStats stats;
+        for (size_t i = 0; i < num_shards; ++i) {
+            shards[i].stats.add_to(stats);
+            stats.locks += shards[i].lock.counters();
+            stats.entries += shards[i].current_size.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+    template <typename Policy, typename Lock, typename Hasher, typename Stats>
+    ProbeHistogram BasicKVStore<Policy, Lock, Hasher, Stats>::probe_histogram() const {
+        ProbeHistogram histogram;
+        for (size_t i = 0; i < num_shards; ++i) {
+            const ShardType& shard = shards[i];
+            std::lock_guard<Lock> guard(shard.lock);
+            shard.collect_probe_lengths(histogram);
+        }
+        return histogram;
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::collect_probe_lengths(ProbeHistogram& histogram) const
     {
-        for (size_t i = 0; i < LOCAL_CAPACITY; ++i) {
-            if (!node_used[i]) {
-                node_used[i] = true;
-                return &node_pool[i];
+        for (size_t idx = 0; idx < table_size; ++idx) {
+            uint32_t node = table[idx].load(std::memory_order_relaxed);
+            if (node != NIL)
+                histogram.record_hit(bucket_distance(idx, node) + 1);
+
+            // A miss whose home is idx stops at the first empty bucket or the
+            // first entry closer to its own home than the probe distance so far.
+            size_t probe = idx;
+            size_t dist = 0;
+            while ((node = table[probe].load(std::memory_order_relaxed)) != NIL &&
+                   bucket_distance(probe, node) >= dist) {
+                probe = (probe + 1) & mask;
+                ++dist;
             }
+            histogram.record_miss(dist + 1);
         }
-        return nullptr;
     }
 
-    void Shard::free_node(Node* node)
+    void ProbeHistogram::record_hit(size_t probes)
     {
-        size_t idx = node - node_pool;
-        if (idx < LOCAL_CAPACITY) {
-            node_used[idx] = false;
-            *node = Node{};
-            node->prev = nullptr;
-            node->next = nullptr;
-            node->key_len = 0;
-            node->hash = 0;
+        ++hit[std::min(probes, BUCKETS) - 1];
+        max_hit = std::max(max_hit, probes);
+    }
 
+    void ProbeHistogram::record_miss(size_t probes)
+    {
+        ++miss[std::min(probes, BUCKETS) - 1];
+        max_miss = std::max(max_miss, probes);
+    }
+
+    double ProbeHistogram::mean(const std::array<uint64_t, BUCKETS>& histogram)
+    {
+        uint64_t count = 0;
+        uint64_t total = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            count += histogram[i];
+            total += histogram[i] * (i + 1);
         }
+        return count ? static_cast<double>(total) / count : 0.0;
+    }
+
+    size_t ProbeHistogram::percentile(const std::array<uint64_t, BUCKETS>& histogram, double q)
+    {
+        uint64_t count = 0;
+        for (auto c : histogram)
+            count += c;
+        if (count == 0)
+            return 0;
+
+        auto rank = static_cast<uint64_t>(std::ceil(q * count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += histogram[i];
+            if (seen >= rank)
+                return i + 1;
+        }
+        return BUCKETS;
+    }
+
+
+
+
+    template <typename Policy, typename Lock, typename Stats>
+    uint32_t Shard<Policy, Lock, Stats>::allocate_node()
+    {
+        if (free_head == NIL && retired_head != NIL)
+            reclaim(epochs->oldest_pinned());
+
+        uint32_t node = free_head;
+        if (node != NIL) {
+            free_head = meta[node].next;
+            meta[node].next = NIL;
+        }
+        return node;
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::free_node(uint32_t node)
+    {
+        NodeData& entry = nodes[node];
+        if (entry.data != SlabAllocator::NONE) {
+            slab.free(entry.data);
+            payload_bytes -= entry.key_len + entry.value_len;
+        }
+        entry = NodeData{};
+
+        meta[node] = NodeMeta{};
+        meta[node].next = free_head;
+        free_head = node;
     }
-}
 
+    // Frees a node that has left the table and LRU list. If a ValueHandle
+    // could still be reading its chunk, the chunk goes to the retired ring
+    // and only the node is freed; once the ring is down to its last slot,
+    // the node is parked on the retired list with its chunk instead.
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::retire_node(uint32_t node)
+    {
+        NodeData& entry = nodes[node];
+        uint64_t oldest = epochs->oldest_pinned();
+        if (oldest == EpochDomain::NONE) {
+            reclaim(oldest);
+            free_node(node);
+            return;
+        }
+        if (!entry.pinned) {
+            free_node(node);
+            return;
+        }
 
+        payload_bytes -= entry.key_len + entry.value_len;
+        if (retired_chunk_count + 1 < retired_slots) {
+            retire_chunk(entry.data);
+            entry.data = SlabAllocator::NONE;
+            free_node(node);
+            return;
+        }
+        entry.key_len = 0;
+        entry.value_len = 0;
+
+        meta[node].hash = epochs->retire();
+        meta[node].prev = NIL;
+        meta[node].next = NIL;
+        if (retired_tail != NIL)
+            meta[retired_tail].next = node;
+        else
+            retired_head = node;
+        retired_tail = node;
+        ++retired_count;
+        stats.retired(retired_count + retired_chunk_count);
+    }
 
+    template <typename Policy, typename Lock, typename Stats>
+    bool Shard<Policy, Lock, Stats>::can_retire_chunk(size_t slots)
+    {
+        if (retired_chunk_count + slots > retired_slots)
+            reclaim(epochs->oldest_pinned());
+        return retired_chunk_count + slots <= retired_slots;
+    }
+
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::retire_chunk(uint32_t data)
+    {
+        size_t slot = (retired_first + retired_chunk_count) % retired_slots;
+        retired_chunks[slot] = {epochs->retire(), data};
+        ++retired_chunk_count;
+        stats.retired(retired_count + retired_chunk_count);
+    }
+
+    // Frees retired chunks and nodes no pinned reader can still see. Retire
+    // epochs only grow, so the ring and the list are each in epoch order and
+    // each scan stops at the first entry that is still visible.
+    template <typename Policy, typename Lock, typename Stats>
+    void Shard<Policy, Lock, Stats>::reclaim(uint64_t oldest_pinned)
+    {
+        while (retired_chunk_count != 0 && retired_chunks[retired_first].epoch < oldest_pinned) {
+            slab.free(retired_chunks[retired_first].data);
+            retired_first = (retired_first + 1) % retired_slots;
+            --retired_chunk_count;
+        }
+        while (retired_head != NIL && meta[retired_head].hash < oldest_pinned) {
+            uint32_t node = retired_head;
+            retired_head = meta[node].next;
+            free_node(node);
+            --retired_count;
+        }
+        if (retired_head == NIL)
+            retired_tail = NIL;
+        stats.retired(retired_count + retired_chunk_count);
+    }
+
+    template class BasicKVStore<LruPolicy>;
+    template class BasicKVStore<ClockPolicy>;
+    template class BasicKVStore<SievePolicy>;
+    template class BasicKVStore<S3FifoPolicy>;
+    template class BasicKVStore<LruPolicy, BackoffLock>;
+    template class BasicKVStore<LruPolicy, AdaptiveLock>;
+    template class BasicKVStore<LruPolicy, SharedAdaptiveLock>;
+    template class BasicKVStore<LruPolicy, SpinLock, FnvHasher>;
+    template class BasicKVStore<LruPolicy, SpinLock, WyHasher, NoStats>;
+}
@@ -0,0 +1,48 @@
+#include "lru-kvstore/lookup_task.hpp"
+
+#include <new>
+#include <utility>
+
+namespace kvstore {
+
+    namespace {
+        // Freed frames, linked through their first word. A thread keeps as many
+        // as it has ever had lookups in flight at once, until it exits.
+        struct FreeFrame {
+            FreeFrame* next;
+        };
+
+        struct FrameList {
+            FreeFrame* head = nullptr;
+
+            ~FrameList() {
+                while (head)
+                    ::operator delete(std::exchange(head, head->next));
+            }
+        };
+
+        thread_local FrameList free_frames;
+    }
+
+    void* LookupTask::promise_type::operator new(size_t bytes)
+    {
+        if (bytes > FRAME_BYTES)
+            return ::operator new(bytes);
+        if (FreeFrame* frame = free_frames.head) {
+            free_frames.head = frame->next;
+            return frame;
+        }
+        return ::operator new(FRAME_BYTES);
+    }
+
+    void LookupTask::promise_type::operator delete(void* frame, size_t bytes)
+    {
+        if (bytes > FRAME_BYTES) {
+            ::operator delete(frame);
+            return;
+        }
+        auto* free = static_cast<FreeFrame*>(frame);
+        free->next = free_frames.head;
+        free_frames.head = free;
+    }
+}
@@ -0,0 +1,348 @@
+#include "lru-kvstore/memcached.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace kvstore {
+
+    namespace {
+        // Value bytes get_into() is first offered; a larger value is read again.
+        constexpr size_t MIN_VALUE_ROOM = 4096;
+        // "VALUE " <key> " " <flags> " " <bytes> " " <cas> "\r\n", key aside.
+        constexpr size_t MAX_HEADER = 6 + 1 + 10 + 1 + 20 + 1 + 20 + 2;
+
+        // The next space-separated token of `rest`, empty at the end.
+        std::string_view token(std::string_view& rest)
+        {
+            size_t begin = rest.find_first_not_of(' ');
+            if (begin == std::string_view::npos) {
+                rest = {};
+                return {};
+            }
+            size_t end = rest.find(' ', begin);
+            if (end == std::string_view::npos)
+                end = rest.size();
+            std::string_view word = rest.substr(begin, end - begin);
+            rest.remove_prefix(end);
+            return word;
+        }
+
+        template <typename T>
+        bool parse_number(std::string_view text, T& value)
+        {
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return !text.empty() && error == std::errc{} && end == text.data() + text.size();
+        }
+
+        McParse client_error(McRequest& request, const char* error)
+        {
+            request.error = error;
+            return McParse::ClientError;
+        }
+
+        char* append(char* out, std::string_view text)
+        {
+            std::memcpy(out, text.data(), text.size());
+            return out + text.size();
+        }
+
+        template <typename T>
+        char* append_number(char* out, T value)
+        {
+            return std::to_chars(out, out + 20, value).ptr;
+        }
+    }
+
+    McParse parse_request(char* begin, char* end, McRequest& request, size_t& consumed)
+    {
+        consumed = 0;
+        size_t available = static_cast<size_t>(end - begin);
+        auto* newline = static_cast<char*>(std::memchr(begin, '\n', std::min(available, MC_MAX_LINE)));
+        if (!newline) {
+            if (available < MC_MAX_LINE)
+                return McParse::Incomplete;
+            request.error = "line too long";
+            consumed = available;
+            return McParse::Fatal;
+        }
+        size_t line_bytes = static_cast<size_t>(newline + 1 - begin);
+        std::string_view rest(begin, static_cast<size_t>(newline - begin));
+        if (!rest.empty() && rest.back() == '\r')
+            rest.remove_suffix(1);
+
+        request = McRequest{};
+        consumed = line_bytes;
+        std::string_view command = token(rest);
+        if (command == "get" || command == "gets") {
+            request.command = command == "get" ? McCommand::Get : McCommand::Gets;
+            std::string_view keys = rest;
+            size_t count = 0;
+            for (std::string_view key = token(keys); !key.empty(); key = token(keys), ++count)
+                if (key.size() > MC_MAX_KEY)
+                    return client_error(request, "key too long");
+            if (count == 0)
+                return client_error(request, "bad command line format");
+            request.keys = rest.substr(rest.find_first_not_of(' '));
+            return McParse::Request;
+        }
+        if (command == "set") {
+            request.command = McCommand::Set;
+            request.keys = token(rest);
+            std::string_view flags = token(rest);
+            std::string_view exptime = token(rest);
+            std::string_view bytes = token(rest);
+            std::string_view option = token(rest);
+            if (request.keys.size() > MC_MAX_KEY)
+                return client_error(request, "key too long");
+            if (!parse_number(flags, request.flags) || !parse_number(exptime, request.exptime) ||
+                !parse_number(bytes, request.bytes) || (!option.empty() && option != "noreply") ||
+                !token(rest).empty())
+                return client_error(request, "bad command line format");
+            // The data block's length cannot be trusted to skip it by.
+            if (request.bytes > MC_MAX_VALUE) {
+                request.error = "object too large for cache";
+                consumed = available;
+                return McParse::Fatal;
+            }
+            request.noreply = !option.empty();
+            if (available - line_bytes < request.bytes + 2) {
+                consumed = 0;
+                return McParse::Incomplete;
+            }
+            request.data = begin + line_bytes;
+            consumed = line_bytes + request.bytes + 2;
+            if (request.data[request.bytes] != '\r' || request.data[request.bytes + 1] != '\n')
+                return client_error(request, "bad data chunk");
+            return McParse::Request;
+        }
+        if (command == "delete") {
+            request.command = McCommand::Delete;
+            request.keys = token(rest);
+            if (request.keys.empty() || request.keys.size() > MC_MAX_KEY)
+                return client_error(request, "bad command line format");
+            // Old clients send a hold time of 0 first.
+            std::string_view option = token(rest);
+            if (option == "0")
+                option = token(rest);
+            if ((!option.empty() && option != "noreply") || !token(rest).empty())
+                return client_error(request, "bad command line format");
+            request.noreply = !option.empty();
+            return McParse::Request;
+        }
+        if (command == "quit") {
+            request.command = McCommand::Quit;
+            return McParse::Request;
+        }
+        return McParse::Error;
+    }
+
+    void McOutput::append_constant(std::string_view text)
+    {
+        if (text.empty())
+            return;
+        segments.push_back({text.data(), 0, text.size()});
+        pending += text.size();
+    }
+
+    void McOutput::append_copy(std::string_view text)
+    {
+        std::memcpy(space(text.size()), text.data(), text.size());
+        queue(commit(text.size()), text.size());
+    }
+
+    char* McOutput::space(size_t bytes)
+    {
+        if (capacity - used < bytes) {
+            size_t grown = std::max({capacity * 2, used + bytes, MIN_VALUE_ROOM});
+            auto larger = std::make_unique_for_overwrite<char[]>(grown);
+            if (used > 0)
+                std::memcpy(larger.get(), buffer.get(), used);
+            buffer = std::move(larger);
+            capacity = grown;
+        }
+        return buffer.get() + used;
+    }
+
+    size_t McOutput::commit(size_t bytes)
+    {
+        size_t offset = used;
+        used += bytes;
+        return offset;
+    }
+
+    void McOutput::queue(size_t offset, size_t length)
+    {
+        if (length == 0)
+            return;
+        if (segments.size() > first && !segments.back().constant &&
+            segments.back().offset + segments.back().length == offset)
+            segments.back().length += length;
+        else
+            segments.push_back({nullptr, offset, length});
+        pending += length;
+    }
+
+    size_t McOutput::gather(iovec* iov, size_t max) const
+    {
+        size_t count = 0;
+        for (size_t i = first; i < segments.size() && count < max; ++i, ++count) {
+            const Segment& segment = segments[i];
+            const char* data = segment.constant ? segment.constant : buffer.get() + segment.offset;
+            size_t skip = i == first ? first_sent : 0;
+            iov[count].iov_base = const_cast<char*>(data + skip);
+            iov[count].iov_len = segment.length - skip;
+        }
+        return count;
+    }
+
+    void McOutput::consume(size_t bytes)
+    {
+        pending -= bytes;
+        while (bytes > 0) {
+            size_t left = segments[first].length - first_sent;
+            if (bytes < left) {
+                first_sent += bytes;
+                break;
+            }
+            bytes -= left;
+            ++first;
+            first_sent = 0;
+        }
+        if (first == segments.size()) {
+            segments.clear();
+            first = 0;
+            used = 0;
+        }
+    }
+
+    size_t McSession::execute(char* begin, char* end, size_t max_output)
+    {
+        char* pos = begin;
+        while (!close_requested && out.pending_bytes() < max_output) {
+            McRequest request;
+            size_t consumed = 0;
+            McParse result = parse_request(pos, end, request, consumed);
+            if (result == McParse::Incomplete)
+                break;
+            pos += consumed;
+            switch (result) {
+                case McParse::Request:
+                    switch (request.command) {
+                        case McCommand::Get:
+                        case McCommand::Gets:
+                            get(request.keys, request.command == McCommand::Gets);
+                            break;
+                        case McCommand::Set:
+                            set(request);
+                            break;
+                        case McCommand::Delete:
+                            reply(request.noreply, store->erase(request.keys) ? "DELETED\r\n" : "NOT_FOUND\r\n");
+                            break;
+                        case McCommand::Quit:
+                            close_requested = true;
+                            break;
+                    }
+                    break;
+                case McParse::Error:
+                    out.append_constant("ERROR\r\n");
+                    break;
+                case McParse::ClientError:
+                case McParse::Fatal:
+                    out.append_constant("CLIENT_ERROR ");
+                    out.append_constant(request.error);
+                    out.append_constant("\r\n");
+                    close_requested = result == McParse::Fatal;
+                    break;
+                case McParse::Incomplete:
+                    break;
+            }
+        }
+        return static_cast<size_t>(pos - begin);
+    }
+
+    // Each value is copied once, from the shard into the output buffer,
+    // with room for the \r\n after it; its VALUE line is written after it
+    // in the buffer but queued before it.
+    void McSession::get(std::string_view keys, bool with_cas)
+    {
+        for (std::string_view key = token(keys); !key.empty(); key = token(keys)) {
+            HashedKey hashed = KVStore::prehash(key);
+            size_t room = std::max(out.space_bytes(), MIN_VALUE_ROOM) - 2;
+            char* value = nullptr;
+            std::optional<size_t> size;
+            uint64_t version = 0;
+            for (;;) {
+                value = out.space(room + 2);
+                size = with_cas ? store->get_versioned(hashed, std::span<char>(value, room), version)
+                                : store->get_into(hashed, std::span<char>(value, room));
+                if (!size || *size <= room)
+                    break;
+                room = *size;
+            }
+            if (!size)
+                continue;
+            size_t value_offset = out.commit(*size + 2);
+            value[*size] = '\r';
+            value[*size + 1] = '\n';
+            // A value shorter than the flags was not put by set: no flags.
+            uint32_t flags = 0;
+            size_t flag_bytes = *size >= MC_FLAG_BYTES ? MC_FLAG_BYTES : 0;
+            std::memcpy(&flags, value, flag_bytes);
+
+            char* header = out.space(MAX_HEADER + key.size());
+            char* p = append(header, "VALUE ");
+            p = append(p, key);
+            *p++ = ' ';
+            p = append_number(p, flags);
+            *p++ = ' ';
+            p = append_number(p, *size - flag_bytes);
+            if (with_cas) {
+                *p++ = ' ';
+                p = append_number(p, version);
+            }
+            p = append(p, "\r\n");
+            size_t header_bytes = static_cast<size_t>(p - header);
+            out.queue(out.commit(header_bytes), header_bytes);
+            out.queue(value_offset + flag_bytes, *size - flag_bytes + 2);
+        }
+        out.append_constant("END\r\n");
+    }
+
+    void McSession::set(const McRequest& request)
+    {
+        char* value = request.data - MC_FLAG_BYTES;
+        std::memcpy(value, &request.flags, MC_FLAG_BYTES);
+        std::string_view stored(value, request.bytes + MC_FLAG_BYTES);
+
+        int64_t ttl = request.exptime;
+        if (ttl > MC_RELATIVE_EXPTIME) {
+            auto now = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            ttl = ttl > now ? ttl - now : -1;
+        }
+        // Stored and expired at once, as memcached has it.
+        if (ttl < 0) {
+            store->erase(request.keys);
+            reply(request.noreply, "STORED\r\n");
+            return;
+        }
+        bool stored_ok = false;
+        try {
+            stored_ok = ttl == 0 ? store->put(request.keys, stored)
+                                 : store->put(request.keys, stored, std::chrono::seconds(ttl));
+        } catch (const std::logic_error&) {
+            reply(request.noreply, "SERVER_ERROR expiry is not enabled\r\n");
+            return;
+        }
+        reply(request.noreply, stored_ok ? "STORED\r\n" : "SERVER_ERROR object too large for cache\r\n");
+    }
+
+    void McSession::reply(bool noreply, std::string_view text)
+    {
+        if (!noreply)
+            out.append_constant(text);
+    }
+}
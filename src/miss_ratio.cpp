@@ -0,0 +1,109 @@
+#include "lru-kvstore/miss_ratio.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace kvstore {
+
+    namespace {
+        constexpr size_t MIN_TREE_SIZE = 1024;
+    }
+
+    MissRatioCurve::MissRatioCurve(double sampling_rate)
+        : rate(sampling_rate)
+    {
+        if (!(rate > 0.0 && rate <= 1.0))
+            throw std::invalid_argument("kvstore: sampling_rate must be in (0, 1]");
+        threshold = rate == 1.0 ? UINT64_MAX : static_cast<uint64_t>(std::ldexp(rate, 64));
+        tree.assign(MIN_TREE_SIZE + 1, 0);
+    }
+
+    void MissRatioCurve::access(uint64_t hash)
+    {
+        ++total;
+        if (!is_sampled(hash))
+            return;
+        ++sampled;
+        if (clock + 1 == tree.size())
+            compact();
+        uint64_t now = ++clock;
+
+        // A key's first access misses at any size and has no distance.
+        auto [it, inserted] = last_access.try_emplace(hash, now);
+        if (!inserted) {
+            // Every live key has one mark; those after this key's previous
+            // access are the distinct keys touched since.
+            auto distance = static_cast<size_t>(last_access.size() - marks_up_to(it->second));
+            if (distance >= distances.size())
+                distances.resize(distance + 1);
+            ++distances[distance];
+            mark(it->second, -1);
+            it->second = now;
+        }
+        mark(now, 1);
+    }
+
+    void MissRatioCurve::erase(uint64_t hash)
+    {
+        if (!is_sampled(hash))
+            return;
+        auto it = last_access.find(hash);
+        if (it == last_access.end())
+            return;
+        mark(it->second, -1);
+        last_access.erase(it);
+    }
+
+    double MissRatioCurve::miss_ratio(size_t capacity) const
+    {
+        if (sampled == 0 || capacity == 0)
+            return 1.0;
+        // SHARDS-adj: the sample holds more or fewer accesses than the rate
+        // predicts, mostly from a few hot keys that fell in or out of it.
+        // The surplus or shortfall is charged to the smallest distance.
+        double expected = static_cast<double>(total) * rate;
+        double hits = expected - static_cast<double>(sampled);
+        double limit = static_cast<double>(capacity) * rate;
+        for (size_t d = 0; d < distances.size() && static_cast<double>(d) < limit; ++d)
+            hits += static_cast<double>(distances[d]);
+        return std::clamp(1.0 - hits / expected, 0.0, 1.0);
+    }
+
+    void MissRatioCurve::mark(uint64_t time, int delta)
+    {
+        for (size_t i = time; i < tree.size(); i += i & (~i + 1))
+            tree[i] += delta;
+    }
+
+    uint64_t MissRatioCurve::marks_up_to(uint64_t time) const
+    {
+        int64_t sum = 0;
+        for (size_t i = time; i > 0; i -= i & (~i + 1))
+            sum += tree[i];
+        return static_cast<uint64_t>(sum);
+    }
+
+    void MissRatioCurve::compact()
+    {
+        std::vector<std::pair<uint64_t, uint64_t*>> live;
+        live.reserve(last_access.size());
+        for (auto& [hash, time] : last_access)
+            live.emplace_back(time, &time);
+        std::sort(live.begin(), live.end());
+
+        size_t count = live.size();
+        tree.assign(std::max(MIN_TREE_SIZE, 2 * count) + 1, 0);
+        for (size_t i = 1; i < tree.size(); ++i) {
+            if (i <= count) {
+                *live[i - 1].second = i;
+                tree[i] += 1;
+            }
+            size_t parent = i + (i & (~i + 1));
+            if (parent < tree.size())
+                tree[parent] += tree[i];
+        }
+        clock = count;
+    }
+}
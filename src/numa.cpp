@@ -0,0 +1,111 @@
+#include "lru-kvstore/numa.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace kvstore {
+
+    namespace {
+        // <numaif.h> comes with libnuma, so its constants are repeated here.
+        constexpr int MPOL_PREFERRED_MODE = 1;
+        constexpr int MPOL_INTERLEAVE_MODE = 3;
+        constexpr size_t MASK_BITS = 64;
+
+        std::string read_line(const std::string& path)
+        {
+            std::string line;
+            if (FILE* file = std::fopen(path.c_str(), "r")) {
+                char buffer[4096];
+                if (std::fgets(buffer, sizeof(buffer), file))
+                    line = buffer;
+                std::fclose(file);
+            }
+            return line;
+        }
+
+        // Calls `each` for every id in a sysfs list such as "0-3,8,10-11".
+        template <typename Each>
+        void for_each_in_list(const std::string& list, Each each)
+        {
+            const char* p = list.c_str();
+            while (*p >= '0' && *p <= '9') {
+                char* end = nullptr;
+                unsigned long first = std::strtoul(p, &end, 10);
+                unsigned long last = first;
+                if (*end == '-')
+                    last = std::strtoul(end + 1, &end, 10);
+                for (unsigned long id = first; id <= last; ++id)
+                    each(id);
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+
+        bool set_policy(const void* memory, size_t bytes, int mode, unsigned long mask)
+        {
+            if (bytes == 0 || reinterpret_cast<uintptr_t>(memory) % NUMA_PAGE_BYTES != 0)
+                return false;
+            bytes = (bytes + NUMA_PAGE_BYTES - 1) & ~(NUMA_PAGE_BYTES - 1);
+            return ::syscall(SYS_mbind, const_cast<void*>(memory), bytes, mode, &mask, MASK_BITS + 1, 0) == 0;
+        }
+    }
+
+    size_t numa_node_count()
+    {
+        static const size_t count = [] {
+            size_t highest = 0;
+            for_each_in_list(read_line("/sys/devices/system/node/online"),
+                             [&](unsigned long id) { highest = std::max<size_t>(highest, id); });
+            return std::min(highest + 1, MASK_BITS);
+        }();
+        return count;
+    }
+
+    int numa_current_node()
+    {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+            return 0;
+        return static_cast<int>(node);
+    }
+
+    bool numa_bind(const void* memory, size_t bytes, int node)
+    {
+        if (numa_node_count() < 2 || node < 0 || static_cast<size_t>(node) >= numa_node_count())
+            return false;
+        return set_policy(memory, bytes, MPOL_PREFERRED_MODE, 1ul << node);
+    }
+
+    bool numa_interleave(const void* memory, size_t bytes)
+    {
+        size_t nodes = numa_node_count();
+        if (nodes < 2)
+            return false;
+        unsigned long mask = nodes == MASK_BITS ? ~0ul : (1ul << nodes) - 1;
+        return set_policy(memory, bytes, MPOL_INTERLEAVE_MODE, mask);
+    }
+
+    bool numa_run_on_node(int node)
+    {
+        if (node < 0)
+            return false;
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        size_t count = 0;
+        for_each_in_list(read_line("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"),
+                         [&](unsigned long cpu) {
+                             if (cpu < CPU_SETSIZE) {
+                                 CPU_SET(cpu, &cpus);
+                                 ++count;
+                             }
+                         });
+        return count > 0 && ::sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+    }
+}
@@ -0,0 +1,22 @@
+#include "lru-kvstore/read_buffer.hpp"
+
+namespace kvstore {
+
+    namespace {
+        std::atomic<uint32_t> next_thread_stripe{0};
+    }
+
+    bool ReadBuffer::record(uint64_t entry)
+    {
+        thread_local uint32_t stripe_hint = next_thread_stripe.fetch_add(1, std::memory_order_relaxed);
+        Stripe& stripe = stripes[stripe_hint % STRIPES];
+
+        uint32_t slot = stripe.write.load(std::memory_order_relaxed);
+        stripe.entries[slot % SLOTS].store(entry, std::memory_order_relaxed);
+        // Publish after the entry so a drainer that sees the new write index
+        // sees the entry too. Concurrent recorders on one stripe may overwrite
+        // each other's slot; that is the lossy part.
+        stripe.write.store(slot + 1, std::memory_order_release);
+        return slot + 1 - stripe.read.load(std::memory_order_relaxed) >= DRAIN_THRESHOLD;
+    }
+}
@@ -0,0 +1,281 @@
+#include "lru-kvstore/server.hpp"
+#include "lru-kvstore/memcached.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace kvstore {
+
+    namespace {
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), "kvstore: " + what);
+        }
+
+        constexpr size_t INPUT_BYTES = 16 * 1024;
+        constexpr int MAX_EVENTS = 64;
+        constexpr size_t MAX_IOVECS = 64;
+
+        struct Connection {
+            Connection(int fd, KVStore& store)
+                : fd(fd), session(store), input(std::make_unique_for_overwrite<char[]>(INPUT_BYTES)),
+                  capacity(INPUT_BYTES) {}
+            ~Connection() { ::close(fd); }
+
+            Connection(const Connection&) = delete;
+            Connection& operator=(const Connection&) = delete;
+
+            int fd;
+            McSession session;
+            // Received bytes not run yet: [begin, end) of input.
+            std::unique_ptr<char[]> input;
+            size_t capacity;
+            size_t begin = 0;
+            size_t end = 0;
+            bool eof = false;
+            size_t index = 0;  // in Worker::connections
+        };
+
+        int listen_on(const std::string& address, uint16_t port)
+        {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+                throw std::invalid_argument("kvstore: bad server address " + address);
+
+            int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+                throw_errno("cannot create socket");
+            int one = 1;
+            if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+                ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0 ||
+                ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                ::listen(fd, SOMAXCONN) != 0) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(),
+                                        "kvstore: cannot listen on " + address + ":" + std::to_string(port));
+            }
+            return fd;
+        }
+
+        void watch(int epoll, int fd, uint32_t events, void* tag)
+        {
+            epoll_event event{};
+            event.events = events;
+            event.data.ptr = tag;
+            if (::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0)
+                throw_errno("epoll_ctl failed");
+        }
+    }
+
+    struct Server::Worker {
+        int epoll = -1;
+        int listener = -1;
+        int wake = -1;
+        std::vector<std::unique_ptr<Connection>> connections;
+
+        ~Worker()
+        {
+            connections.clear();
+            for (int fd : {epoll, listener, wake})
+                if (fd >= 0)
+                    ::close(fd);
+        }
+
+        void run(KVStore& store, size_t max_output);
+        void accept_all(KVStore& store);
+        bool serve(Connection& connection, size_t max_output);
+        bool flush(Connection& connection);
+        void close(Connection& connection);
+    };
+
+    Server::Server(KVStore& store, const ServerOptions& options)
+        : store(&store), max_output(options.max_output)
+    {
+        if (options.threads == 0)
+            throw std::invalid_argument("kvstore: server threads must be at least 1");
+        if (options.max_output == 0)
+            throw std::invalid_argument("kvstore: server max_output must be positive");
+
+        uint16_t port = options.port;
+        for (size_t i = 0; i < options.threads; ++i) {
+            auto worker = std::make_unique<Worker>();
+            worker->listener = listen_on(options.address, port);
+            // The first socket picks the port for the rest.
+            if (port == 0) {
+                sockaddr_in addr{};
+                socklen_t length = sizeof(addr);
+                if (::getsockname(worker->listener, reinterpret_cast<sockaddr*>(&addr), &length) != 0)
+                    throw_errno("getsockname failed");
+                port = ntohs(addr.sin_port);
+            }
+            worker->epoll = ::epoll_create1(EPOLL_CLOEXEC);
+            if (worker->epoll < 0)
+                throw_errno("epoll_create1 failed");
+            worker->wake = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (worker->wake < 0)
+                throw_errno("eventfd failed");
+            watch(worker->epoll, worker->listener, EPOLLIN, &worker->listener);
+            watch(worker->epoll, worker->wake, EPOLLIN, &worker->wake);
+            workers.push_back(std::move(worker));
+        }
+        bound_port = port;
+        for (auto& worker : workers)
+            threads.emplace_back([this, worker = worker.get()] { worker->run(*this->store, max_output); });
+    }
+
+    Server::~Server()
+    {
+        stop();
+    }
+
+    void Server::stop()
+    {
+        uint64_t one = 1;
+        for (size_t i = 0; i < threads.size(); ++i)
+            [[maybe_unused]] ssize_t n = ::write(workers[i]->wake, &one, sizeof(one));
+        for (auto& thread : threads)
+            thread.join();
+        threads.clear();
+        workers.clear();
+    }
+
+    // The listener and the wakeup eventfd are level-triggered; connections
+    // are edge-triggered for both directions, so serve() must run each
+    // until it would block.
+    void Server::Worker::run(KVStore& store, size_t max_output)
+    {
+        epoll_event events[MAX_EVENTS];
+        for (;;) {
+            int count = ::epoll_wait(epoll, events, MAX_EVENTS, -1);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count < 0)
+                return;
+            for (int i = 0; i < count; ++i) {
+                void* tag = events[i].data.ptr;
+                if (tag == &wake)
+                    return;
+                if (tag == &listener) {
+                    accept_all(store);
+                    continue;
+                }
+                auto* connection = static_cast<Connection*>(tag);
+                if (!serve(*connection, max_output))
+                    close(*connection);
+            }
+        }
+    }
+
+    void Server::Worker::accept_all(KVStore& store)
+    {
+        for (;;) {
+            int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0 && errno == EINTR)
+                continue;
+            // EAGAIN, or out of descriptors: the backlog keeps the rest.
+            if (fd < 0)
+                return;
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            auto connection = std::make_unique<Connection>(fd, store);
+            connection->index = connections.size();
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            event.data.ptr = connection.get();
+            if (::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) == 0)
+                connections.push_back(std::move(connection));
+        }
+    }
+
+    // Returns false once the connection should be closed. Each round sends
+    // what is queued, runs what has arrived and reads more, until the
+    // socket has nothing to read or no room to write.
+    bool Server::Worker::serve(Connection& c, size_t max_output)
+    {
+        McOutput& out = c.session.output();
+        for (;;) {
+            if (!flush(c))
+                return false;
+            // Backpressure: wait for EPOLLOUT before reading more.
+            if (out.pending_bytes() >= max_output)
+                return true;
+            if (c.session.closing())
+                return !out.empty();
+
+            size_t consumed = c.session.execute(c.input.get() + c.begin, c.input.get() + c.end, max_output);
+            c.begin += consumed;
+            if (consumed > 0)
+                continue;
+            // What is left is an incomplete request, and no more is coming.
+            if (c.eof)
+                return !out.empty();
+
+            if (c.begin == c.end) {
+                c.begin = c.end = 0;
+            } else if (c.end == c.capacity) {
+                // parse_request() bounds a request, and so this growth.
+                if (c.begin > 0) {
+                    std::memmove(c.input.get(), c.input.get() + c.begin, c.end - c.begin);
+                    c.end -= c.begin;
+                    c.begin = 0;
+                } else {
+                    auto larger = std::make_unique_for_overwrite<char[]>(c.capacity * 2);
+                    std::memcpy(larger.get(), c.input.get(), c.end);
+                    c.input = std::move(larger);
+                    c.capacity *= 2;
+                }
+            }
+            ssize_t n = ::read(c.fd, c.input.get() + c.end, c.capacity - c.end);
+            if (n > 0)
+                c.end += static_cast<size_t>(n);
+            else if (n == 0)
+                c.eof = true;
+            else if (errno != EINTR)
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+
+    // Sends the queued responses, as many per call as fit in MAX_IOVECS.
+    // sendmsg() is writev() plus MSG_NOSIGNAL: a client that went away
+    // fails the call with EPIPE instead of killing the process.
+    bool Server::Worker::flush(Connection& c)
+    {
+        McOutput& out = c.session.output();
+        iovec iov[MAX_IOVECS];
+        while (!out.empty()) {
+            msghdr message{};
+            message.msg_iov = iov;
+            message.msg_iovlen = out.gather(iov, MAX_IOVECS);
+            ssize_t n = ::sendmsg(c.fd, &message, MSG_NOSIGNAL);
+            if (n >= 0)
+                out.consume(static_cast<size_t>(n));
+            else if (errno != EINTR)
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        return true;
+    }
+
+    void Server::Worker::close(Connection& c)
+    {
+        size_t index = c.index;
+        if (index + 1 != connections.size()) {
+            connections[index] = std::move(connections.back());
+            connections[index]->index = index;
+        }
+        connections.pop_back();
+    }
+}
@@ -0,0 +1,180 @@
+#include "lru-kvstore/shared_memory.hpp"
+#include "lru-kvstore/hash.hpp"
+
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kvstore {
+
+    namespace {
+        constexpr size_t PAGE_SIZE = 4096;
+        // Where create() places segments: a stretch of the 47-bit user address
+        // space that neither the heap (just above the executable) nor default
+        // mmap()s (just below the stack) grow into, in 1 GiB slots.
+        constexpr uintptr_t PLACEMENT_START = uintptr_t{0x2000} << 32;
+        constexpr uintptr_t PLACEMENT_END = uintptr_t{0x6000} << 32;
+        constexpr uintptr_t PLACEMENT_SLOT = uintptr_t{1} << 30;
+        constexpr int PLACEMENT_ATTEMPTS = 32;
+
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), "kvstore: " + what);
+        }
+
+        std::string object_name(const std::string& name)
+        {
+            if (name.empty() || name.find('/') != std::string::npos)
+                throw std::invalid_argument("kvstore: shared_name must be a non-empty name without '/'");
+            return "/" + name;
+        }
+
+        // The mapping at exactly `address`, or null if anything is in the way.
+        void* map_at(uintptr_t address, size_t bytes, int fd)
+        {
+            void* want = reinterpret_cast<void*>(address);
+            void* mem = ::mmap(want, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+            if (mem == MAP_FAILED)
+                return nullptr;
+            // Kernels before 4.17 take the flag as a mere hint.
+            if (mem != want) {
+                ::munmap(mem, bytes);
+                return nullptr;
+            }
+            return mem;
+        }
+
+        struct Descriptor {
+            int fd = -1;
+            ~Descriptor() { if (fd >= 0) ::close(fd); }
+        };
+    }
+
+    std::unique_ptr<SharedSegment> SharedSegment::create(const std::string& name, size_t bytes)
+    {
+        std::string object = object_name(name);
+        bytes = (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        if (bytes < sizeof(SharedHeader) || bytes > PLACEMENT_END - PLACEMENT_START)
+            throw std::invalid_argument("kvstore: shared segment size out of range");
+
+        Descriptor file{::shm_open(object.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600)};
+        if (file.fd < 0) {
+            if (errno == EEXIST)
+                return nullptr;
+            throw_errno("cannot create shared segment " + name);
+        }
+        if (::ftruncate(file.fd, static_cast<off_t>(bytes)) != 0) {
+            int error = errno;
+            ::shm_unlink(object.c_str());
+            errno = error;
+            throw_errno("cannot size shared segment " + name);
+        }
+
+        // Start from a slot picked by the name, so that segments created
+        // side by side do not all contend for the first one.
+        uintptr_t slots = (PLACEMENT_END - PLACEMENT_START - bytes) / PLACEMENT_SLOT + 1;
+        uint64_t pick = WyHasher{}(name);
+        void* mem = nullptr;
+        for (int attempt = 0; attempt < PLACEMENT_ATTEMPTS && !mem; ++attempt)
+            mem = map_at(PLACEMENT_START + (pick + attempt * 0x9E3779B97F4A7C15ull) % slots * PLACEMENT_SLOT,
+                         bytes, file.fd);
+        if (!mem) {
+            ::shm_unlink(object.c_str());
+            throw std::runtime_error("kvstore: no free address range for shared segment " + name);
+        }
+
+        auto* base = static_cast<std::byte*>(mem);
+        auto* header = new (base) SharedHeader;
+        header->address = reinterpret_cast<uintptr_t>(base);
+        header->bytes = bytes;
+        return std::unique_ptr<SharedSegment>(new SharedSegment(name, base, bytes, true));
+    }
+
+    std::unique_ptr<SharedSegment> SharedSegment::attach(const std::string& name)
+    {
+        std::string object = object_name(name);
+        Descriptor file{::shm_open(object.c_str(), O_RDWR | O_CLOEXEC, 0)};
+        if (file.fd < 0) {
+            if (errno == ENOENT)
+                return nullptr;
+            throw_errno("cannot open shared segment " + name);
+        }
+
+        // The creator sizes the object right after creating it and fills
+        // the header in before anything else; wait for both, then for it
+        // to publish.
+        auto deadline = std::chrono::steady_clock::now() + SHARED_ATTACH_TIMEOUT;
+        auto wait = [&] {
+            if (std::chrono::steady_clock::now() > deadline)
+                throw std::runtime_error("kvstore: shared segment " + name + " was never published");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        };
+        struct stat st {};
+        for (;;) {
+            if (::fstat(file.fd, &st) != 0)
+                throw_errno("cannot stat shared segment " + name);
+            if (static_cast<size_t>(st.st_size) >= PAGE_SIZE)
+                break;
+            wait();
+        }
+        void* first = ::mmap(nullptr, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+        if (first == MAP_FAILED)
+            throw_errno("cannot map shared segment " + name);
+        auto* peek = static_cast<SharedHeader*>(first);
+        uint32_t status;
+        while ((status = peek->status.load(std::memory_order_acquire)) == SharedHeader::Building) {
+            try {
+                wait();
+            } catch (...) {
+                ::munmap(first, PAGE_SIZE);
+                throw;
+            }
+        }
+        bool usable = status == SharedHeader::Ready && peek->magic == SHARED_MAGIC &&
+                      peek->version == SHARED_VERSION && peek->bytes == static_cast<size_t>(st.st_size);
+        uintptr_t address = peek->address;
+        size_t bytes = peek->bytes;
+        ::munmap(first, PAGE_SIZE);
+        if (!usable)
+            throw std::runtime_error("kvstore: " + name + " is not a usable shared segment");
+
+        void* mem = map_at(address, bytes, file.fd);
+        if (!mem)
+            throw std::runtime_error("kvstore: the address of shared segment " + name +
+                                     " is already in use in this process");
+        return std::unique_ptr<SharedSegment>(new SharedSegment(name, static_cast<std::byte*>(mem), bytes, false));
+    }
+
+    bool SharedSegment::unlink(const std::string& name)
+    {
+        if (::shm_unlink(object_name(name).c_str()) == 0)
+            return true;
+        if (errno == ENOENT)
+            return false;
+        throw_errno("cannot unlink shared segment " + name);
+    }
+
+    SharedSegment::~SharedSegment()
+    {
+        // A creator that never published failed to build the store; tell
+        // waiting attachers and take the name back.
+        if (owner && !published) {
+            header().status.store(SharedHeader::Failed, std::memory_order_release);
+            ::shm_unlink(object_name(name).c_str());
+        }
+        ::munmap(base, bytes);
+    }
+
+    void SharedSegment::publish()
+    {
+        header().status.store(SharedHeader::Ready, std::memory_order_release);
+        published = true;
+    }
+}
@@ -0,0 +1,287 @@
+#include "lru-kvstore/slab.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace kvstore {
+
+    namespace {
+        struct ClassTable {
+            size_t count = 0;
+            uint32_t sizes[SlabAllocator::MAX_CLASSES] = {};
+
+            ClassTable()
+            {
+                size_t size = SLAB_MIN_CHUNK;
+                while (size < SLAB_PAGE_SIZE && count < SlabAllocator::MAX_CLASSES - 1) {
+                    sizes[count++] = static_cast<uint32_t>(size);
+                    size_t next = (size * 5 / 4 + 7) & ~size_t{7};
+                    size = next > size ? next : size + 8;
+                }
+                sizes[count++] = static_cast<uint32_t>(SLAB_PAGE_SIZE);
+            }
+        };
+
+        const ClassTable& classes_by_size()
+        {
+            static const ClassTable table;
+            return table;
+        }
+    }
+
+    size_t SlabAllocator::page_size_for(size_t budget_bytes)
+    {
+        size_t size = SLAB_PAGE_SIZE;
+        while (size > SLAB_MIN_PAGE_SIZE && budget_bytes / size < SLAB_MIN_PAGES)
+            size /= 2;
+        return size;
+    }
+
+    size_t SlabAllocator::pages_for(size_t budget_bytes, size_t page_bytes)
+    {
+        size_t pages = (budget_bytes + page_bytes - 1) / page_bytes;
+        if (pages < 2)
+            pages = 2;
+        // Chunk offsets are 32-bit.
+        if (pages > UINT32_MAX / page_bytes)
+            throw std::invalid_argument("kvstore: per-shard memory budget must be below 4 GiB");
+        return pages;
+    }
+
+    size_t SlabAllocator::storage_bytes(size_t pages, size_t page_bytes)
+    {
+        return pages * page_bytes + Arena::bytes_for<Page>(pages);
+    }
+
+    // The classes are the build's table cut off at the page size, which
+    // becomes the last class.
+    void SlabAllocator::init(Arena& arena, size_t pages, size_t page_bytes)
+    {
+        if ((page_bytes & (page_bytes - 1)) != 0 || page_bytes < SLAB_MIN_PAGE_SIZE || page_bytes > SLAB_PAGE_SIZE)
+            throw std::invalid_argument("kvstore: slab page size must be a power of two in [8 KiB, 64 KiB]");
+        page_count = pages;
+        page_shift = static_cast<size_t>(__builtin_ctzll(page_bytes));
+        base = arena.allocate_bytes(pages * page_bytes);
+        this->pages = arena.allocate<Page>(pages);
+
+        const auto& table = classes_by_size();
+        class_count = 0;
+        while (table.sizes[class_count] < page_bytes)
+            ++class_count;
+        for (size_t c = 0; c <= class_count; ++c) {
+            uint32_t size = c < class_count ? table.sizes[c] : static_cast<uint32_t>(page_bytes);
+            classes[c].chunk_size = size;
+            classes[c].chunks_per_page = static_cast<uint32_t>(page_bytes / size);
+            classes[c].partial = NONE;
+        }
+        ++class_count;
+
+        // Thread every page onto the free list in address order.
+        for (size_t p = 0; p < pages && !arena.restored(); ++p) {
+            this->pages[p].prev = p == 0 ? NONE : static_cast<uint32_t>(p - 1);
+            this->pages[p].next = p + 1 == pages ? NONE : static_cast<uint32_t>(p + 1);
+        }
+        free_page_head = 0;
+        free_pages = pages;
+        chunk_bytes_in_use = 0;
+    }
+
+    size_t SlabAllocator::class_for(size_t bytes) const
+    {
+        size_t lo = 0;
+        size_t hi = class_count;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (classes[mid].chunk_size < bytes)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    void SlabAllocator::push_partial(uint32_t page)
+    {
+        auto& cls = classes[pages[page].size_class];
+        pages[page].prev = NONE;
+        pages[page].next = cls.partial;
+        if (cls.partial != NONE)
+            pages[cls.partial].prev = page;
+        cls.partial = page;
+    }
+
+    void SlabAllocator::remove_partial(uint32_t page)
+    {
+        auto& cls = classes[pages[page].size_class];
+        Page& p = pages[page];
+        if (p.prev != NONE)
+            pages[p.prev].next = p.next;
+        else
+            cls.partial = p.next;
+        if (p.next != NONE)
+            pages[p.next].prev = p.prev;
+        p.prev = NONE;
+        p.next = NONE;
+    }
+
+    uint32_t SlabAllocator::allocate(size_t bytes)
+    {
+        size_t c = class_for(bytes == 0 ? 1 : bytes);
+        if (c >= class_count)
+            return NONE;
+
+        SizeClass& cls = classes[c];
+        uint32_t page = cls.partial;
+
+        if (page == NONE) {
+            if (free_page_head == NONE)
+                return NONE;
+
+            page = free_page_head;
+            free_page_head = pages[page].next;
+            if (free_page_head != NONE)
+                pages[free_page_head].prev = NONE;
+            --free_pages;
+
+            pages[page] = Page{};
+            pages[page].size_class = static_cast<uint32_t>(c);
+            push_partial(page);
+        }
+
+        Page& p = pages[page];
+        uint32_t offset;
+        if (p.free_chunk != NONE) {
+            offset = p.free_chunk;
+            std::memcpy(&p.free_chunk, base + offset, sizeof(uint32_t));
+        } else {
+            offset = static_cast<uint32_t>(size_t{page} << page_shift) + p.bump;
+            p.bump += cls.chunk_size;
+        }
+
+        if (++p.live == cls.chunks_per_page)
+            remove_partial(page);
+
+        chunk_bytes_in_use += cls.chunk_size;
+        return offset;
+    }
+
+    void SlabAllocator::free(uint32_t offset)
+    {
+        uint32_t page = page_of(offset);
+        Page& p = pages[page];
+        const SizeClass& cls = classes[p.size_class];
+
+        bool was_full = p.live == cls.chunks_per_page;
+        chunk_bytes_in_use -= cls.chunk_size;
+
+        if (--p.live == 0) {
+            // Whole page is free again: give it back for any class to use.
+            if (!was_full)
+                remove_partial(page);
+            p = Page{};
+            p.next = free_page_head;
+            if (free_page_head != NONE)
+                pages[free_page_head].prev = page;
+            free_page_head = page;
+            ++free_pages;
+            return;
+        }
+
+        std::memcpy(base + offset, &p.free_chunk, sizeof(uint32_t));
+        p.free_chunk = offset;
+        if (was_full)
+            push_partial(page);
+    }
+
+    size_t SlabAllocator::chunk_size(uint32_t offset) const
+    {
+        return classes[pages[page_of(offset)].size_class].chunk_size;
+    }
+
+    bool SlabAllocator::same_class(uint32_t offset, size_t bytes) const
+    {
+        return pages[page_of(offset)].size_class == class_for(bytes == 0 ? 1 : bytes);
+    }
+
+    uint32_t SlabAllocator::emptiest_page(uint32_t keep) const
+    {
+        uint32_t kept = keep == NONE ? NONE : page_of(keep);
+        uint32_t best = NONE;
+        for (uint32_t page = 0; page < page_count; ++page) {
+            const Page& p = pages[page];
+            if (p.size_class == NONE || page == kept)
+                continue;
+            if (best == NONE || p.live < pages[best].live)
+                best = page;
+        }
+        return best;
+    }
+
+    SlabAllocator::State SlabAllocator::state() const
+    {
+        State state{};
+        for (size_t c = 0; c < MAX_CLASSES; ++c)
+            state.partial[c] = c < class_count ? classes[c].partial : NONE;
+        state.free_page_head = free_page_head;
+        state.free_pages = free_pages;
+        state.chunk_bytes_in_use = chunk_bytes_in_use;
+        return state;
+    }
+
+    bool SlabAllocator::restore(const State& state)
+    {
+        auto page_or_none = [&](uint32_t page) { return page == NONE || page < page_count; };
+
+        size_t free_count = 0;
+        size_t chunk_bytes = 0;
+        for (size_t page = 0; page < page_count; ++page) {
+            const Page& p = pages[page];
+            if (!page_or_none(p.prev) || !page_or_none(p.next))
+                return false;
+            if (p.size_class == NONE) {
+                ++free_count;
+                continue;
+            }
+            if (p.size_class >= class_count)
+                return false;
+            const SizeClass& cls = classes[p.size_class];
+            if (p.live > cls.chunks_per_page || p.bump % cls.chunk_size != 0 ||
+                p.bump / cls.chunk_size > cls.chunks_per_page)
+                return false;
+            // Freed chunks are chained through their first four bytes.
+            uint32_t start = static_cast<uint32_t>(page << page_shift);
+            uint32_t chunk = p.free_chunk;
+            for (uint32_t n = 0; chunk != NONE; ++n) {
+                if (n > cls.chunks_per_page || chunk < start || chunk - start >= p.bump ||
+                    (chunk - start) % cls.chunk_size != 0)
+                    return false;
+                std::memcpy(&chunk, base + chunk, sizeof(uint32_t));
+            }
+            chunk_bytes += size_t{p.live} * cls.chunk_size;
+        }
+
+        for (size_t c = 0; c < class_count; ++c) {
+            if (!page_or_none(state.partial[c]))
+                return false;
+            classes[c].partial = state.partial[c];
+        }
+        if (!page_or_none(state.free_page_head) || state.free_pages != free_count ||
+            state.chunk_bytes_in_use != chunk_bytes)
+            return false;
+        free_page_head = state.free_page_head;
+        free_pages = state.free_pages;
+        chunk_bytes_in_use = state.chunk_bytes_in_use;
+        return true;
+    }
+
+    bool SlabAllocator::valid_chunk(uint32_t offset, size_t bytes) const
+    {
+        size_t page = page_of(offset);
+        if (page >= page_count || pages[page].size_class >= class_count)
+            return false;
+        const Page& p = pages[page];
+        size_t within = offset & (page_size() - 1);
+        size_t size = classes[p.size_class].chunk_size;
+        return within % size == 0 && within < p.bump && bytes <= size;
+    }
+}
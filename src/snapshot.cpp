@@ -0,0 +1,142 @@
+#include "lru-kvstore/snapshot.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kvstore {
+
+    namespace {
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), "kvstore: " + what);
+        }
+
+        bool all_zero(const std::byte* data, size_t bytes)
+        {
+            return std::all_of(data, data + bytes, [](std::byte b) { return b == std::byte{0}; });
+        }
+
+        void write_all(int fd, const std::byte* data, size_t bytes, size_t offset)
+        {
+            while (bytes > 0) {
+                ssize_t n = ::pwrite(fd, data, bytes, static_cast<off_t>(offset));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    throw_errno("snapshot write failed");
+                data += n;
+                bytes -= static_cast<size_t>(n);
+                offset += static_cast<size_t>(n);
+            }
+        }
+    }
+
+    SnapshotWriter::SnapshotWriter(const std::string& path, size_t file_bytes)
+        : path(path), temp_path(path + ".tmp")
+    {
+        fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw_errno("cannot create " + temp_path);
+        if (::ftruncate(fd, static_cast<off_t>(file_bytes)) != 0) {
+            int error = errno;
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+            throw std::system_error(error, std::generic_category(), "kvstore: cannot size " + temp_path);
+        }
+    }
+
+    SnapshotWriter::~SnapshotWriter()
+    {
+        if (fd >= 0) {
+            ::close(fd);
+            ::unlink(temp_path.c_str());
+        }
+    }
+
+    // Runs of non-zero pages go out in one pwrite each; zero pages are
+    // skipped, since ftruncate() already made the file read as zeros there.
+    void SnapshotWriter::write(size_t offset, const void* data, size_t bytes)
+    {
+        auto* bytes_in = static_cast<const std::byte*>(data);
+        size_t pos = 0;
+        size_t run_start = 0;
+        bool in_run = false;
+        while (pos < bytes) {
+            size_t page_end = (offset + pos) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT + SNAPSHOT_ALIGNMENT;
+            size_t step = std::min(bytes - pos, page_end - (offset + pos));
+            bool zero = all_zero(bytes_in + pos, step);
+            if (!zero && !in_run) {
+                run_start = pos;
+                in_run = true;
+            } else if (zero && in_run) {
+                write_all(fd, bytes_in + run_start, pos - run_start, offset + run_start);
+                in_run = false;
+            }
+            pos += step;
+        }
+        if (in_run)
+            write_all(fd, bytes_in + run_start, bytes - run_start, offset + run_start);
+    }
+
+    void SnapshotWriter::commit()
+    {
+        if (::fsync(fd) != 0)
+            throw_errno("cannot sync " + temp_path);
+        if (::rename(temp_path.c_str(), path.c_str()) != 0)
+            throw_errno("cannot rename " + temp_path);
+        ::close(fd);
+        fd = -1;
+    }
+
+    SnapshotReader::SnapshotReader(const std::string& path)
+    {
+        file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+            throw_errno("cannot open " + path);
+
+        struct stat st {};
+        if (::fstat(file, &st) != 0) {
+            int error = errno;
+            ::close(file);
+            throw std::system_error(error, std::generic_category(), "kvstore: cannot stat " + path);
+        }
+        ssize_t n = ::pread(file, &head, sizeof(head), 0);
+        if (n != static_cast<ssize_t>(sizeof(head)) || head.magic != SNAPSHOT_MAGIC ||
+            head.version != SNAPSHOT_VERSION || head.file_bytes != static_cast<uint64_t>(st.st_size) ||
+            head.arena_offset % SNAPSHOT_ALIGNMENT != 0 || head.arena_offset > head.file_bytes ||
+            head.arena_bytes != head.file_bytes - head.arena_offset || head.images_offset < sizeof(head) ||
+            head.images_offset > head.arena_offset) {
+            ::close(file);
+            throw std::runtime_error("kvstore: " + path + " is not a valid snapshot");
+        }
+    }
+
+    SnapshotReader::~SnapshotReader()
+    {
+        ::close(file);
+    }
+
+    void SnapshotReader::read(size_t offset, void* data, size_t bytes) const
+    {
+        auto* out = static_cast<std::byte*>(data);
+        while (bytes > 0) {
+            ssize_t n = ::pread(file, out, bytes, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0)
+                throw_errno("snapshot read failed");
+            if (n == 0)
+                throw std::runtime_error("kvstore: snapshot is truncated");
+            out += n;
+            bytes -= static_cast<size_t>(n);
+            offset += static_cast<size_t>(n);
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#include "lru-kvstore/stats.hpp"
+
+namespace kvstore {
+
+    void ShardStats::add_to(StoreStats& stats) const
+    {
+        stats.inserts += writes.inserts.load(std::memory_order_relaxed);
+        stats.updates += writes.updates.load(std::memory_order_relaxed);
+        stats.erases += writes.erases.load(std::memory_order_relaxed);
+        stats.evictions += writes.evictions.load(std::memory_order_relaxed);
+        stats.expirations += writes.expirations.load(std::memory_order_relaxed);
+        stats.retired += writes.retired.load(std::memory_order_relaxed);
+        for (const Stripe& stripe : stripes) {
+            stats.misses += stripe.misses.load(std::memory_order_relaxed);
+            for (size_t b = 0; b < StoreStats::DISTANCE_BUCKETS; ++b) {
+                uint64_t hits = stripe.distance[b].load(std::memory_order_relaxed);
+                stats.hit_distance[b] += hits;
+                stats.hits += hits;
+            }
+        }
+    }
+}
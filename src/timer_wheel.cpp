@@ -0,0 +1,190 @@
+#include "lru-kvstore/timer_wheel.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__linux__)
+#include <time.h>
+#else
+#include <chrono>
+#endif
+
+namespace kvstore {
+
+    uint64_t monotonic_ms()
+    {
+#if defined(__linux__)
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000 + static_cast<uint64_t>(ts.tv_nsec) / 1000000;
+#else
+        auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count());
+#endif
+    }
+
+    size_t TimerWheel::storage_bytes(size_t capacity)
+    {
+        return Arena::bytes_for<uint64_t>(capacity) + 2 * Arena::bytes_for<uint32_t>(capacity + LEVELS * SLOTS);
+    }
+
+    size_t TimerWheel::bytes() const
+    {
+        return storage_bytes(capacity);
+    }
+
+    void TimerWheel::init(Arena& arena, size_t capacity, uint64_t now)
+    {
+        this->capacity = capacity;
+        deadlines = arena.allocate<uint64_t>(capacity);
+        prev = arena.allocate<uint32_t>(capacity + LEVELS * SLOTS);
+        next = arena.allocate<uint32_t>(capacity + LEVELS * SLOTS);
+        for (int level = 0; level < LEVELS; ++level) {
+            for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+                uint32_t head = sentinel(level, slot);
+                prev[head] = head;
+                next[head] = head;
+            }
+        }
+        current = now;
+    }
+
+    void TimerWheel::rebuild(uint64_t now, int64_t shift)
+    {
+        for (int level = 0; level < LEVELS; ++level) {
+            occupied[level] = 0;
+            for (uint32_t slot = 0; slot < SLOTS; ++slot) {
+                uint32_t head = sentinel(level, slot);
+                prev[head] = head;
+                next[head] = head;
+            }
+        }
+        count = 0;
+        current = now;
+        for (uint32_t node = 0; node < capacity; ++node) {
+            uint64_t deadline = deadlines[node];
+            if (deadline == 0)
+                continue;
+            deadlines[node] = 0;
+            auto moved = static_cast<int64_t>(deadline) + shift;
+            schedule(node, moved > static_cast<int64_t>(now) ? static_cast<uint64_t>(moved) : now);
+        }
+    }
+
+    void TimerWheel::schedule(uint32_t node, uint64_t deadline)
+    {
+        if (deadlines[node] != 0) {
+            unlink(node);
+            --count;
+        }
+        deadlines[node] = deadline;
+        if (deadline == 0)
+            return;
+        place(node);
+        ++count;
+    }
+
+    void TimerWheel::cancel(uint32_t node)
+    {
+        if (deadlines[node] != 0)
+            schedule(node, 0);
+    }
+
+    // A deadline already behind `current` goes into the slot processed next.
+    void TimerWheel::place(uint32_t node)
+    {
+        uint64_t due = std::max(deadlines[node], current);
+        uint64_t delta = due - current;
+
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= uint64_t{1} << (SLOT_BITS * (level + 1)))
+            ++level;
+        if (delta >= uint64_t{1} << (SLOT_BITS * LEVELS))
+            due = current + (uint64_t{1} << (SLOT_BITS * LEVELS)) - 1;
+
+        auto slot = static_cast<uint32_t>(due >> (SLOT_BITS * level)) & (SLOTS - 1);
+        link(node, sentinel(level, slot));
+        occupied[level] |= uint64_t{1} << slot;
+    }
+
+    void TimerWheel::link(uint32_t node, uint32_t head)
+    {
+        prev[node] = head;
+        next[node] = next[head];
+        prev[next[head]] = node;
+        next[head] = node;
+    }
+
+    // A slot is empty once its sentinel is left linked to itself.
+    void TimerWheel::unlink(uint32_t node)
+    {
+        uint32_t before = prev[node];
+        uint32_t after = next[node];
+        next[before] = after;
+        prev[after] = before;
+        if (before == after && before >= capacity) {
+            uint32_t index = before - static_cast<uint32_t>(capacity);
+            occupied[index / SLOTS] &= ~(uint64_t{1} << (index % SLOTS));
+        }
+    }
+
+    void TimerWheel::cascade(int level, uint32_t slot)
+    {
+        uint32_t head = sentinel(level, slot);
+        while (next[head] != head) {
+            uint32_t node = next[head];
+            unlink(node);
+            place(node);
+        }
+    }
+
+    // Level L is looked at only on multiples of 64^L ticks, so its candidate
+    // is the first such tick at or after `current` whose slot is occupied.
+    uint64_t TimerWheel::next_stop() const
+    {
+        uint64_t stop = UINT64_MAX;
+        for (int level = 0; level < LEVELS; ++level) {
+            if (!occupied[level])
+                continue;
+            int shift = SLOT_BITS * level;
+            uint64_t block = (current + (uint64_t{1} << shift) - 1) >> shift;
+            auto rotation = static_cast<int>(block & (SLOTS - 1));
+            uint64_t ahead = static_cast<uint64_t>(std::countr_zero(std::rotr(occupied[level], rotation)));
+            stop = std::min(stop, (block + ahead) << shift);
+        }
+        return stop;
+    }
+
+    size_t TimerWheel::advance(uint64_t now, uint32_t* expired, size_t max)
+    {
+        size_t taken = 0;
+        while (taken < max) {
+            uint64_t tick = count ? next_stop() : UINT64_MAX;
+            if (tick > now) {
+                current = std::max(current, now + 1);
+                break;
+            }
+            current = tick;
+
+            for (int level = LEVELS - 1; level > 0; --level) {
+                int shift = SLOT_BITS * level;
+                auto slot = static_cast<uint32_t>(tick >> shift) & (SLOTS - 1);
+                if ((tick & ((uint64_t{1} << shift) - 1)) == 0 && (occupied[level] >> slot & 1))
+                    cascade(level, slot);
+            }
+
+            uint32_t head = sentinel(0, static_cast<uint32_t>(tick) & (SLOTS - 1));
+            while (taken < max && next[head] != head) {
+                uint32_t node = next[head];
+                unlink(node);
+                deadlines[node] = 0;
+                --count;
+                expired[taken++] = node;
+            }
+            if (next[head] != head)
+                break;
+            current = tick + 1;
+        }
+        return taken;
+    }
+}
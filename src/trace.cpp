@@ -0,0 +1,273 @@
+#include "lru-kvstore/trace.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kvstore {
+
+    namespace {
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), "kvstore: " + what);
+        }
+
+        constexpr size_t WRITE_BUFFER_BYTES = 1 << 20;
+
+        bool equals_lower(std::string_view text, std::string_view lower)
+        {
+            if (text.size() != lower.size())
+                return false;
+            for (size_t i = 0; i < text.size(); ++i) {
+                char c = text[i];
+                if (c >= 'A' && c <= 'Z')
+                    c = static_cast<char>(c - 'A' + 'a');
+                if (c != lower[i])
+                    return false;
+            }
+            return true;
+        }
+
+        bool parse_number(std::string_view text, uint64_t& value)
+        {
+            if (text.empty() || text.size() > 19)
+                return false;
+            value = 0;
+            for (char c : text) {
+                if (c < '0' || c > '9')
+                    return false;
+                value = value * 10 + static_cast<uint64_t>(c - '0');
+            }
+            return true;
+        }
+    }
+
+    TraceFile::TraceFile(const std::string& path)
+        : path(path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw_errno("cannot open " + path);
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "kvstore: cannot stat " + path);
+        }
+        size = static_cast<size_t>(st.st_size);
+        if (size > 0) {
+            void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                int error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "kvstore: cannot map " + path);
+            }
+            ::madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapping);
+        }
+        ::close(fd);
+
+        uint64_t magic = 0;
+        if (size >= sizeof(magic)) {
+            std::memcpy(&magic, data, sizeof(magic));
+            is_binary = magic == TRACE_MAGIC;
+        }
+    }
+
+    TraceFile::~TraceFile()
+    {
+        if (data)
+            ::munmap(const_cast<char*>(data), size);
+    }
+
+    TraceFile::Cursor TraceFile::cursor() const
+    {
+        return Cursor(*this, is_binary ? data + sizeof(TRACE_MAGIC) : data);
+    }
+
+    bool TraceFile::Cursor::next(TraceRecord& record)
+    {
+        return file->is_binary ? next_binary(record) : next_csv(record);
+    }
+
+    bool TraceFile::Cursor::next_binary(TraceRecord& record)
+    {
+        const char* end = file->data + file->size;
+        if (pos == end)
+            return false;
+        auto op = static_cast<uint8_t>(*pos++);
+        if (op > static_cast<uint8_t>(TraceOp::Erase))
+            fail("unknown op");
+        uint64_t delta = read_varint();
+        timestamp += (delta >> 1) ^ (~(delta & 1) + 1);
+        uint64_t key_bytes = read_varint();
+        uint64_t value_bytes = read_varint();
+        if (value_bytes > UINT32_MAX)
+            fail("bad value_bytes");
+        if (static_cast<uint64_t>(end - pos) < key_bytes)
+            fail("truncated key");
+        record.timestamp_us = timestamp;
+        record.op = static_cast<TraceOp>(op);
+        record.value_bytes = static_cast<uint32_t>(value_bytes);
+        record.key = std::string_view(pos, static_cast<size_t>(key_bytes));
+        pos += key_bytes;
+        return true;
+    }
+
+    uint64_t TraceFile::Cursor::read_varint()
+    {
+        const char* end = file->data + file->size;
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (pos == end)
+                fail("truncated record");
+            auto byte = static_cast<uint8_t>(*pos++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        fail("bad varint");
+    }
+
+    bool TraceFile::Cursor::next_csv(TraceRecord& record)
+    {
+        const char* end = file->data + file->size;
+        while (pos != end) {
+            const char* newline = static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+            const char* line_end = newline ? newline : end;
+            std::string_view text(pos, static_cast<size_t>(line_end - pos));
+            pos = newline ? newline + 1 : end;
+            ++line;
+            if (!text.empty() && text.back() == '\r')
+                text.remove_suffix(1);
+            if (text.empty() || text.front() == '#')
+                continue;
+
+            std::string_view fields[4];
+            size_t count = 0;
+            while (count < 4) {
+                size_t comma = text.find(',');
+                fields[count++] = text.substr(0, comma);
+                if (comma == std::string_view::npos)
+                    break;
+                text.remove_prefix(comma + 1);
+                if (count == 4)
+                    fail("too many fields");
+            }
+            if (count < 3)
+                fail("expected timestamp_us,op,key[,value_bytes]");
+
+            uint64_t number = 0;
+            if (!parse_number(fields[0], number))
+                fail("bad timestamp");
+            record.timestamp_us = number;
+            if (equals_lower(fields[1], "get"))
+                record.op = TraceOp::Get;
+            else if (equals_lower(fields[1], "put"))
+                record.op = TraceOp::Put;
+            else if (equals_lower(fields[1], "erase"))
+                record.op = TraceOp::Erase;
+            else
+                fail("unknown op");
+            record.key = fields[2];
+            record.value_bytes = 0;
+            if (count == 4) {
+                if (!parse_number(fields[3], number) || number > UINT32_MAX)
+                    fail("bad value_bytes");
+                record.value_bytes = static_cast<uint32_t>(number);
+            } else if (record.op == TraceOp::Put) {
+                fail("put without value_bytes");
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void TraceFile::Cursor::fail(const char* what) const
+    {
+        std::string where = file->is_binary
+            ? "byte " + std::to_string(pos - file->data)
+            : "line " + std::to_string(line);
+        throw std::runtime_error("kvstore: " + file->path + ": " + where + ": " + what);
+    }
+
+    TraceWriter::TraceWriter(const std::string& path)
+        : path(path)
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw_errno("cannot create " + path);
+        buffer.reserve(WRITE_BUFFER_BYTES);
+        buffer.append(reinterpret_cast<const char*>(&TRACE_MAGIC), sizeof(TRACE_MAGIC));
+    }
+
+    TraceWriter::~TraceWriter()
+    {
+        try {
+            close();
+        } catch (const std::system_error&) {
+        }
+    }
+
+    void TraceWriter::write(const TraceRecord& record)
+    {
+        buffer.push_back(static_cast<char>(record.op));
+        // Zigzag, so a timestamp that steps back costs a few bytes, not ten.
+        auto delta = static_cast<int64_t>(record.timestamp_us - timestamp);
+        append_varint((static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+        timestamp = record.timestamp_us;
+        append_varint(record.key.size());
+        append_varint(record.value_bytes);
+        buffer.append(record.key);
+        if (buffer.size() >= WRITE_BUFFER_BYTES)
+            flush();
+    }
+
+    void TraceWriter::append_varint(uint64_t value)
+    {
+        while (value >= 0x80) {
+            buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    void TraceWriter::close()
+    {
+        if (fd < 0)
+            return;
+        try {
+            flush();
+        } catch (const std::system_error&) {
+            ::close(fd);
+            fd = -1;
+            throw;
+        }
+        int result = ::close(fd);
+        fd = -1;
+        if (result != 0)
+            throw_errno("cannot close " + path);
+    }
+
+    void TraceWriter::flush()
+    {
+        const char* p = buffer.data();
+        size_t left = buffer.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                throw_errno("trace write failed");
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        buffer.clear();
+    }
+}
@@ -0,0 +1,203 @@
+#include "lru-kvstore/wal.hpp"
+#include "lru-kvstore/hash.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace kvstore {
+
+    namespace {
+        struct FileHeader {
+            uint64_t magic;
+            uint64_t generation;
+        };
+
+        struct RecordHeader {
+            uint32_t checksum;
+            uint32_t key_len;
+            uint32_t value_len;
+            uint32_t type;
+            int64_t deadline_ms;
+        };
+        static_assert(sizeof(RecordHeader) == 24);
+
+        // Of everything after the checksum field.
+        uint32_t checksum(const char* record, size_t bytes)
+        {
+            return static_cast<uint32_t>(WyHasher{}(std::string_view(record + sizeof(uint32_t),
+                                                                    bytes - sizeof(uint32_t))));
+        }
+
+        [[noreturn]] void throw_errno(const std::string& what)
+        {
+            throw std::system_error(errno, std::generic_category(), "kvstore: " + what);
+        }
+
+        void write_at(int fd, const void* data, size_t bytes, size_t offset, const std::string& path)
+        {
+            auto* in = static_cast<const char*>(data);
+            while (bytes > 0) {
+                ssize_t n = ::pwrite(fd, in, bytes, static_cast<off_t>(offset));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    throw_errno("cannot write " + path);
+                in += n;
+                bytes -= static_cast<size_t>(n);
+                offset += static_cast<size_t>(n);
+            }
+        }
+    }
+
+    void WalBuffer::put(std::string_view key, std::string_view value, int64_t deadline_ms)
+    {
+        append(WalRecord::Type::Put, key, value, deadline_ms);
+    }
+
+    void WalBuffer::erase(std::string_view key)
+    {
+        append(WalRecord::Type::Erase, key, {}, 0);
+    }
+
+    void WalBuffer::append(WalRecord::Type type, std::string_view key, std::string_view value, int64_t deadline_ms)
+    {
+        size_t start = bytes.size();
+        size_t length = sizeof(RecordHeader) + key.size() + value.size();
+        bytes.resize(start + length);
+        char* record = bytes.data() + start;
+
+        RecordHeader header{0, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size()),
+                            static_cast<uint32_t>(type), deadline_ms};
+        std::memcpy(record, &header, sizeof(header));
+        std::memcpy(record + sizeof(header), key.data(), key.size());
+        std::memcpy(record + sizeof(header) + key.size(), value.data(), value.size());
+        header.checksum = checksum(record, length);
+        std::memcpy(record, &header.checksum, sizeof(header.checksum));
+    }
+
+    WriteAheadLog::WriteAheadLog(const std::string& path) : path(path)
+    {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw_errno("cannot open " + path);
+    }
+
+    WriteAheadLog::~WriteAheadLog()
+    {
+        ::close(fd);
+    }
+
+    std::optional<uint64_t> WriteAheadLog::generation() const
+    {
+        FileHeader header{};
+        if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            header.magic != WAL_MAGIC)
+            return std::nullopt;
+        return header.generation;
+    }
+
+    size_t WriteAheadLog::replay(const std::function<void(const WalRecord&)>& apply) const
+    {
+        struct stat st {};
+        if (::fstat(fd, &st) != 0)
+            throw_errno("cannot stat " + path);
+        auto size = static_cast<size_t>(st.st_size);
+        if (size <= sizeof(FileHeader))
+            return 0;
+
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+            throw_errno("cannot map " + path);
+        const char* data = static_cast<const char*>(mapped);
+
+        size_t applied = 0;
+        size_t offset = sizeof(FileHeader);
+        while (size - offset >= sizeof(RecordHeader)) {
+            RecordHeader header;
+            std::memcpy(&header, data + offset, sizeof(header));
+            size_t length = sizeof(header) + size_t{header.key_len} + header.value_len;
+            if (length > size - offset || checksum(data + offset, length) != header.checksum ||
+                (header.type != static_cast<uint32_t>(WalRecord::Type::Put) &&
+                 header.type != static_cast<uint32_t>(WalRecord::Type::Erase)))
+                break;
+
+            const char* key = data + offset + sizeof(header);
+            apply(WalRecord{static_cast<WalRecord::Type>(header.type), {key, header.key_len},
+                            {key + header.key_len, header.value_len}, header.deadline_ms});
+            ++applied;
+            offset += length;
+        }
+        ::munmap(mapped, size);
+        return applied;
+    }
+
+    void WriteAheadLog::reset(uint64_t generation)
+    {
+        if (::ftruncate(fd, 0) != 0)
+            throw_errno("cannot truncate " + path);
+        FileHeader header{WAL_MAGIC, generation};
+        write_at(fd, &header, sizeof(header), 0, path);
+        sync();
+        failed = false;
+    }
+
+    void WriteAheadLog::append(std::span<const WalBuffer> buffers)
+    {
+        if (failed)
+            throw std::system_error(EIO, std::generic_category(), "kvstore: " + path + " has a torn record");
+        off_t start = ::lseek(fd, 0, SEEK_END);
+        if (start < 0)
+            throw_errno("cannot seek " + path);
+        try {
+            append_all(buffers);
+        } catch (const std::system_error&) {
+            if (::ftruncate(fd, start) != 0)
+                failed = true;
+            throw;
+        }
+    }
+
+    void WriteAheadLog::append_all(std::span<const WalBuffer> buffers)
+    {
+        constexpr size_t MAX_IOV = 64;
+        iovec iov[MAX_IOV];
+        size_t next = 0;
+        while (next < buffers.size()) {
+            size_t count = 0;
+            for (; next < buffers.size() && count < MAX_IOV; ++next) {
+                auto data = buffers[next].data();
+                if (!data.empty())
+                    iov[count++] = {const_cast<char*>(data.data()), data.size()};
+            }
+            // O_APPEND: each writev lands at the end; a short one is resumed.
+            size_t first = 0;
+            while (first < count) {
+                ssize_t n = ::writev(fd, iov + first, static_cast<int>(count - first));
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0)
+                    throw_errno("cannot append to " + path);
+                auto written = static_cast<size_t>(n);
+                while (first < count && written >= iov[first].iov_len)
+                    written -= iov[first++].iov_len;
+                if (first < count) {
+                    iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + written;
+                    iov[first].iov_len -= written;
+                }
+            }
+        }
+    }
+
+    void WriteAheadLog::sync()
+    {
+        if (::fdatasync(fd) != 0)
+            throw_errno("cannot sync " + path);
+    }
+}
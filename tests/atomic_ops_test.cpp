@@ -0,0 +1,287 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using namespace kvstore;
+using namespace std::chrono_literals;
+
+namespace {
+    Options small_options() {
+        Options options;
+        options.capacity = 256;
+        options.num_shards = 2;
+        return options;
+    }
+}
+
+TEST(AtomicOpsTest, CompareAndSwapChecksTheVersion) {
+    KVStore store(small_options());
+    uint64_t version = 1;
+    EXPECT_EQ(store.compare_and_swap("key", version, "x"), RmwStatus::NotFound);
+    EXPECT_EQ(version, 0u);
+
+    store.put("key", "one");
+    std::string value;
+    ASSERT_TRUE(store.get_versioned("key", value, version));
+    EXPECT_EQ(value, "one");
+    EXPECT_NE(version, 0u);
+
+    uint64_t stale = version;
+    EXPECT_EQ(store.compare_and_swap("key", version, "two"), RmwStatus::Ok);
+    EXPECT_GT(version, stale);
+    EXPECT_EQ(store.get("key"), "two");
+
+    // The failed swap reports the current version, so the retry succeeds.
+    uint64_t current = version;
+    EXPECT_EQ(store.compare_and_swap("key", stale, "three"), RmwStatus::Mismatch);
+    EXPECT_EQ(stale, current);
+    EXPECT_EQ(store.get("key"), "two");
+    EXPECT_EQ(store.compare_and_swap("key", stale, "three"), RmwStatus::Ok);
+    EXPECT_EQ(store.get("key"), "three");
+}
+
+// Every write gives a new version, including one that writes the same
+// bytes, and an erased and re-put key does not get its old version back.
+TEST(AtomicOpsTest, EveryWriteChangesTheVersion) {
+    KVStore store(small_options());
+    std::string value;
+    uint64_t first = 0;
+    uint64_t second = 0;
+    store.put("key", "same");
+    ASSERT_TRUE(store.get_versioned("key", value, first));
+    store.put("key", "same");
+    ASSERT_TRUE(store.get_versioned("key", value, second));
+    EXPECT_NE(first, second);
+
+    store.erase("key");
+    store.put("key", "same");
+    uint64_t third = 0;
+    ASSERT_TRUE(store.get_versioned("key", value, third));
+    EXPECT_NE(third, first);
+    EXPECT_NE(third, second);
+
+    char buffer[8];
+    uint64_t version = 0;
+    EXPECT_EQ(store.get_versioned("key", std::span<char>(buffer), version), 4u);
+    EXPECT_EQ(version, third);
+    EXPECT_FALSE(store.get_versioned("missing", std::span<char>(buffer), version));
+    EXPECT_EQ(version, 0u);
+}
+
+TEST(AtomicOpsTest, IncrAndDecrFollowMemcached) {
+    KVStore store(small_options());
+    uint64_t result = 0;
+    EXPECT_EQ(store.incr("counter", 1, result), RmwStatus::NotFound);
+    EXPECT_FALSE(store.get("counter"));
+
+    store.put("counter", "41");
+    EXPECT_EQ(store.incr("counter", 1, result), RmwStatus::Ok);
+    EXPECT_EQ(result, 42u);
+    EXPECT_EQ(store.get("counter"), "42");
+    EXPECT_EQ(store.decr("counter", 40, result), RmwStatus::Ok);
+    EXPECT_EQ(store.get("counter"), "2");
+    // decr stops at 0; incr wraps.
+    EXPECT_EQ(store.decr("counter", 5, result), RmwStatus::Ok);
+    EXPECT_EQ(result, 0u);
+    store.put("counter", "18446744073709551615");
+    EXPECT_EQ(store.incr("counter", 2, result), RmwStatus::Ok);
+    EXPECT_EQ(result, 1u);
+    EXPECT_EQ(store.get("counter"), "1");
+
+    for (const char* bad : {"", "12a", " 12", "-1", "18446744073709551616"}) {
+        store.put("text", bad);
+        EXPECT_EQ(store.incr("text", 1, result), RmwStatus::NotNumeric) << bad;
+        EXPECT_EQ(store.get("text"), bad);
+    }
+}
+
+TEST(AtomicOpsTest, IncrStoresInitialOnMiss) {
+    KVStore store(small_options());
+    uint64_t result = 0;
+    EXPECT_EQ(store.incr("hits", 5, result, 100), RmwStatus::Ok);
+    EXPECT_EQ(result, 100u);
+    EXPECT_EQ(store.get("hits"), "100");
+    EXPECT_EQ(store.incr("hits", 5, result, 100), RmwStatus::Ok);
+    EXPECT_EQ(result, 105u);
+    EXPECT_EQ(store.decr("misses", 1, result, 0), RmwStatus::Ok);
+    EXPECT_EQ(store.get("misses"), "0");
+    EXPECT_EQ(store.size(), 2u);
+}
+
+// A key too long for any chunk is turned away before anything is evicted.
+TEST(AtomicOpsTest, OversizedIncrLeavesTheShardAlone) {
+    KVStore store(small_options());
+    for (int i = 0; i < 100; ++i)
+        store.put("key" + std::to_string(i), "value");
+    std::string key(store.max_entry_bytes(), 'k');
+    uint64_t result = 0;
+    EXPECT_EQ(store.incr(key, 1, result, 5), RmwStatus::NotStored);
+    EXPECT_FALSE(store.get(key));
+    EXPECT_EQ(store.size(), 100u);
+    EXPECT_EQ(store.stats().evictions, 0u);
+}
+
+// Small appends fit the chunk; a large one moves the entry, as does any
+// append while a ValueHandle is out, which keeps seeing the old value.
+TEST(AtomicOpsTest, AppendGrowsTheValue) {
+    KVStore store(small_options());
+    EXPECT_EQ(store.append("log", "x"), RmwStatus::NotFound);
+
+    store.put("log", "a");
+    EXPECT_EQ(store.append("log", "b"), RmwStatus::Ok);
+    EXPECT_EQ(store.append("log", ""), RmwStatus::Ok);
+    EXPECT_EQ(store.get("log"), "ab");
+
+    std::string large(3000, 'z');
+    EXPECT_EQ(store.append("log", large), RmwStatus::Ok);
+    EXPECT_EQ(store.get("log"), "ab" + large);
+
+    {
+        ValueHandle handle = store.pin("log");
+        EXPECT_EQ(store.append("log", "c"), RmwStatus::Ok);
+        EXPECT_EQ(handle.value(), "ab" + large);
+    }
+    EXPECT_EQ(store.get("log"), "ab" + large + "c");
+
+    EXPECT_EQ(store.append("log", std::string(SLAB_PAGE_SIZE, 'y')), RmwStatus::NotStored);
+    EXPECT_EQ(store.get("log"), "ab" + large + "c");
+    EXPECT_EQ(store.memory_usage().payload_bytes, 3 + 2 + large.size() + 1);
+}
+
+TEST(AtomicOpsTest, GetAndSetReturnsTheOldValue) {
+    KVStore store(small_options());
+    std::string previous = "stale";
+    EXPECT_EQ(store.get_and_set("key", "one", previous), RmwStatus::NotFound);
+    EXPECT_TRUE(previous.empty());
+    EXPECT_EQ(store.get("key"), "one");
+
+    EXPECT_EQ(store.get_and_set("key", "two", previous), RmwStatus::Ok);
+    EXPECT_EQ(previous, "one");
+    EXPECT_EQ(store.get("key"), "two");
+
+    EXPECT_EQ(store.get_and_set("key", std::string(SLAB_PAGE_SIZE, 'y'), previous), RmwStatus::NotStored);
+    EXPECT_EQ(previous, "two");
+    EXPECT_EQ(store.get("key"), "two");
+}
+
+TEST(AtomicOpsTest, UpdatesKeepTheTtlAndSkipExpiredEntries) {
+    Options options = small_options();
+    options.expiry = true;
+    KVStore store(options);
+    uint64_t result = 0;
+
+    store.put("short", "1", 30ms);
+    EXPECT_EQ(store.incr("short", 1, result), RmwStatus::Ok);
+    std::this_thread::sleep_for(60ms);
+    EXPECT_FALSE(store.get("short"));
+    EXPECT_EQ(store.incr("short", 1, result), RmwStatus::NotFound);
+    EXPECT_EQ(store.append("short", "x"), RmwStatus::NotFound);
+    EXPECT_EQ(store.incr("short", 1, result, 7), RmwStatus::Ok);
+    std::this_thread::sleep_for(60ms);
+    EXPECT_EQ(store.get("short"), "7");
+}
+
+// get() then put() loses increments to each other; incr() cannot.
+TEST(AtomicOpsTest, ConcurrentIncrementsAreNotLost) {
+    KVStore store(small_options());
+    store.put("counter", "0");
+    constexpr int THREADS = 4;
+    constexpr int ROUNDS = 20000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&] {
+            uint64_t result = 0;
+            for (int i = 0; i < ROUNDS; ++i)
+                store.incr("counter", 1, result);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(store.get("counter"), std::to_string(THREADS * ROUNDS));
+}
+
+TEST(AtomicOpsTest, ConcurrentCompareAndSwapLoopsAreNotLost) {
+    KVStore store(small_options());
+    store.put("list", "");
+    constexpr int THREADS = 4;
+    constexpr int ROUNDS = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            std::string value;
+            uint64_t version = 0;
+            for (int i = 0; i < ROUNDS; ++i) {
+                store.get_versioned("list", value, version);
+                // Keeps only a count, so the value stays small.
+                for (;;) {
+                    std::string next = std::to_string(value.empty() ? 1 : std::stoi(value) + 1);
+                    RmwStatus status = store.compare_and_swap("list", version, next);
+                    if (status == RmwStatus::Ok)
+                        break;
+                    ASSERT_EQ(status, RmwStatus::Mismatch) << t;
+                    store.get_versioned("list", value, version);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(store.get("list"), std::to_string(THREADS * ROUNDS));
+}
+
+// A loaded store carries on from the snapshot's versions instead of
+// handing out ones a client may still hold.
+TEST(AtomicOpsTest, SnapshotKeepsVersions) {
+    std::string path = ::testing::TempDir() + "kvstore_rmw_" + std::to_string(::getpid()) + ".snap";
+    Options options = small_options();
+    options.num_shards = 1;
+    uint64_t version = 0;
+    {
+        KVStore store(options);
+        for (int i = 0; i < 10; ++i)
+            store.put("key", std::to_string(i));
+        std::string value;
+        store.get_versioned("key", value, version);
+        store.snapshot(path);
+    }
+    auto store = KVStore::load(path);
+    std::remove(path.c_str());
+    uint64_t loaded = version;
+    EXPECT_EQ(store->compare_and_swap("key", loaded, "next"), RmwStatus::Ok);
+    EXPECT_GT(loaded, version);
+    store->put("other", "x");
+    std::string value;
+    uint64_t other = 0;
+    store->get_versioned("other", value, other);
+    EXPECT_GT(other, loaded);
+}
+
+TEST(AtomicOpsTest, DurableStoreReplaysUpdates) {
+    std::string path = ::testing::TempDir() + "kvstore_rmw_" + std::to_string(::getpid()) + ".wal";
+    Options options = small_options();
+    options.wal_path = path;
+    {
+        KVStore store(options);
+        uint64_t result = 0;
+        std::string previous;
+        store.incr("counter", 3, result, 10);
+        store.incr("counter", 3, result);
+        store.put("log", "a");
+        store.append("log", "b");
+        store.get_and_set("swap", "one", previous);
+        store.get_and_set("swap", "two", previous);
+        store.sync();
+    }
+    KVStore store(options);
+    EXPECT_EQ(store.get("counter"), "13");
+    EXPECT_EQ(store.get("log"), "ab");
+    EXPECT_EQ(store.get("swap"), "two");
+    std::remove(path.c_str());
+    std::remove((path + ".snap").c_str());
+}
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace kvstore;
+
+template <typename Store>
+class EvictionPolicyTest : public ::testing::Test {
+protected:
+    static Options single_shard(size_t capacity, Admission admission = Admission::Always) {
+        Options options;
+        options.capacity = capacity;
+        options.num_shards = 1;
+        options.admission = admission;
+        return options;
+    }
+};
+
+using Stores = ::testing::Types<KVStore, ClockKVStore, SieveKVStore, S3FifoKVStore>;
+TYPED_TEST_SUITE(EvictionPolicyTest, Stores);
+
+TYPED_TEST(EvictionPolicyTest, MatchesReferenceMapWithoutEviction) {
+    TypeParam store(this->single_shard(4096));
+    std::unordered_map<std::string, std::string> reference;
+    std::mt19937 rng(7);
+
+    for (int i = 0; i < 20000; ++i) {
+        std::string key = "key" + std::to_string(rng() % 3000);
+        if (rng() % 4 == 0) {
+            EXPECT_EQ(store.erase(key), reference.erase(key) == 1);
+        } else {
+            std::string value = std::to_string(i);
+            store.put(key, value);
+            reference[key] = value;
+        }
+    }
+
+    EXPECT_EQ(store.size(), reference.size());
+    for (const auto& [key, value] : reference)
+        EXPECT_EQ(store.get(key), std::optional<std::string_view>(value));
+}
+
+TYPED_TEST(EvictionPolicyTest, ChurnStaysWithinCapacityAndConsistent) {
+    TypeParam store(this->single_shard(256));
+    std::mt19937 rng(11);
+    std::string out;
+
+    for (int i = 0; i < 50000; ++i) {
+        std::string key = "key" + std::to_string(rng() % 2000);
+        if (rng() % 3 == 0)
+            store.get_into(key, out);
+        else
+            store.put(key, key);
+        if (i % 7 == 0)
+            store.erase("key" + std::to_string(rng() % 2000));
+        ASSERT_LE(store.size(), 256u);
+    }
+
+    size_t found = 0;
+    for (int k = 0; k < 2000; ++k) {
+        std::string key = "key" + std::to_string(k);
+        if (store.get_into(key, out)) {
+            EXPECT_EQ(out, key);
+            ++found;
+        }
+    }
+    EXPECT_EQ(found, store.size());
+}
+
+// A hot set that is read between every insert of a one-off scan should stay
+// resident under every policy that honours reads.
+TYPED_TEST(EvictionPolicyTest, ReadHotSetSurvivesScan) {
+    TypeParam store(this->single_shard(128));
+    std::string out;
+    for (int i = 0; i < 32; ++i)
+        store.put("hot" + std::to_string(i), "value");
+
+    for (int i = 0; i < 1000; ++i) {
+        store.get_into("hot" + std::to_string(i % 32), out);
+        store.put("scan" + std::to_string(i), "value");
+    }
+
+    size_t hot = 0;
+    for (int i = 0; i < 32; ++i)
+        hot += store.get_into("hot" + std::to_string(i), out);
+    // Plain LRU keeps none of them. How many survive depends on which scan
+    // keys share sketch counters with them, i.e. on the hash: about 30 on
+    // average, rarely fewer than 26.
+    EXPECT_GE(hot, 24u);
+}
+
+TYPED_TEST(EvictionPolicyTest, TinyLfuChurnStaysConsistent) {
+    TypeParam store(this->single_shard(256, Admission::TinyLfu));
+    std::mt19937 rng(13);
+    std::string out;
+
+    for (int i = 0; i < 50000; ++i) {
+        std::string key = "key" + std::to_string(rng() % 2000);
+        if (rng() % 3 == 0)
+            store.get_into(key, out);
+        else
+            store.put(key, key);
+        if (i % 7 == 0)
+            store.erase("key" + std::to_string(rng() % 2000));
+        ASSERT_LE(store.size(), 256u);
+    }
+
+    size_t found = 0;
+    for (int k = 0; k < 2000; ++k) {
+        std::string key = "key" + std::to_string(k);
+        if (store.get_into(key, out)) {
+            EXPECT_EQ(out, key);
+            ++found;
+        }
+    }
+    EXPECT_EQ(found, store.size());
+}
+
+// Keys that were popular before a long scan, and not read during it, are
+// flushed by every policy on its own; the admission filter turns the scan
+// keys away instead because the sketch has seen each of them only once.
+TYPED_TEST(EvictionPolicyTest, TinyLfuKeepsFrequentKeysThroughScan) {
+    TypeParam store(this->single_shard(128, Admission::TinyLfu));
+    std::string out;
+    for (int i = 0; i < 32; ++i)
+        store.put("hot" + std::to_string(i), "value");
+    for (int round = 0; round < 8; ++round)
+        for (int i = 0; i < 32; ++i)
+            store.get_into("hot" + std::to_string(i), out);
+
+    for (int i = 0; i < 1000; ++i)
+        store.put("scan" + std::to_string(i), "value");
+
+    size_t hot = 0;
+    for (int i = 0; i < 32; ++i)
+        hot += store.get_into("hot" + std::to_string(i), out);
+    // Plain LRU keeps none of them. How many survive depends on which scan
+    // keys share sketch counters with them, i.e. on the hash: about 30 on
+    // average, rarely fewer than 26.
+    EXPECT_GE(hot, 24u);
+}
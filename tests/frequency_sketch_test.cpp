@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/arena.hpp"
+#include "lru-kvstore/frequency_sketch.hpp"
+
+using namespace kvstore;
+
+namespace {
+    uint64_t mix(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return x;
+    }
+}
+
+TEST(FrequencySketchTest, EstimatesGrowAndSaturate) {
+    Arena arena(FrequencySketch::storage_bytes(1024));
+    FrequencySketch sketch;
+    sketch.init(arena, 1024);
+
+    uint64_t hash = mix(42);
+    EXPECT_EQ(sketch.estimate(hash), 0u);
+    for (uint32_t i = 1; i <= 5; ++i) {
+        sketch.increment(hash);
+        EXPECT_EQ(sketch.estimate(hash), i);
+    }
+    for (int i = 0; i < 100; ++i)
+        sketch.increment(hash);
+    EXPECT_EQ(sketch.estimate(hash), FrequencySketch::MAX_COUNT);
+    EXPECT_EQ(sketch.estimate(mix(43)), 0u);
+}
+
+TEST(FrequencySketchTest, AgingHalvesCounts) {
+    const size_t capacity = 64;
+    Arena arena(FrequencySketch::storage_bytes(capacity));
+    FrequencySketch sketch;
+    sketch.init(arena, capacity);
+
+    uint64_t hot = mix(1);
+    for (int i = 0; i < 12; ++i)
+        sketch.increment(hot);
+    EXPECT_EQ(sketch.estimate(hot), 12u);
+
+    // One-off keys may share a counter with `hot`, but only aging lowers it.
+    bool aged = false;
+    for (uint64_t k = 2; k < 100 * capacity && !aged; ++k) {
+        uint32_t before = sketch.estimate(hot);
+        sketch.increment(mix(k));
+        uint32_t after = sketch.estimate(hot);
+        if (after < before) {
+            EXPECT_TRUE(after == before / 2 || after == (before + 1) / 2);
+            aged = true;
+        }
+    }
+    EXPECT_TRUE(aged);
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/hash.hpp"
+
+#include <bit>
+#include <set>
+#include <string>
+
+using namespace kvstore;
+
+// Every length exercises a different load pattern (byte reads, overlapping
+// 4-byte reads, 16- and 48-byte rounds); a key must not hash like its prefix
+// or like itself with one byte changed.
+TEST(HashTest, WyHasherSeesEveryByte) {
+    WyHasher hash;
+    std::string key;
+    std::set<uint64_t> seen;
+    for (int len = 0; len <= 130; ++len) {
+        EXPECT_TRUE(seen.insert(hash(key)).second) << len;
+        for (size_t i = 0; i < key.size(); ++i) {
+            std::string flipped = key;
+            flipped[i] ^= 1;
+            EXPECT_NE(hash(flipped), hash(key)) << len << " " << i;
+        }
+        key.push_back(static_cast<char>('a' + len % 26));
+    }
+    EXPECT_EQ(hash(key), WyHasher{}(std::string_view(key)));
+}
+
+// The store splits the hash into shard (high half) and bucket and tag (low
+// half), so a one-character change in a short key must flip about half of
+// each half.
+TEST(HashTest, HashersMixIntoBothHalves) {
+    auto check = [](auto hash) {
+        uint64_t high = 0;
+        uint64_t low = 0;
+        const int keys = 2000;
+        for (int i = 0; i < keys; ++i) {
+            uint64_t diff = hash("key_" + std::to_string(i)) ^ hash("key_" + std::to_string(i + 1));
+            high += std::popcount(diff >> 32);
+            low += std::popcount(diff & 0xffffffffu);
+        }
+        EXPECT_NEAR(static_cast<double>(high) / keys, 16.0, 1.0);
+        EXPECT_NEAR(static_cast<double>(low) / keys, 16.0, 1.0);
+    };
+    check(WyHasher{});
+    check(FnvHasher{});
+}
@@ -3,6 +3,8 @@
 #include <vector>
 #include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <unistd.h>
 #include "lru-kvstore/kv_store.hpp"
 
 using namespace kvstore;
@@ -71,3 +73,187 @@ TEST(KVStoreBenchmarkTest, MeasureGetLatencyUnderWrites) {
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Total Reads: " << reads << ", Duration(ms): " << duration.count() << std::endl;
 }
+
+// Values are a single repeated letter whose count is tied to the letter, so a
+// read that mixed two versions shows up as a wrong length or a mixed byte.
+TEST(KVStoreConcurrencyTest, OptimisticReadsNeverTorn) {
+    KVStore store;
+    auto value_for = [](int version) {
+        char c = static_cast<char>('a' + version % 26);
+        return std::string(8 + (version % 26) * 7, c);
+    };
+
+    for (int i = 0; i < 256; ++i)
+        store.put("key" + std::to_string(i), value_for(0));
+
+    std::atomic<bool> stop{false};
+    std::thread writer([&]() {
+        int i = 0;
+        while (!stop) {
+            std::string key = "key" + std::to_string(i % 256);
+            if (i % 7 == 0)
+                store.erase(key);
+            store.put(key, value_for(i));
+            ++i;
+        }
+    });
+
+    std::atomic<size_t> torn{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&]() {
+            std::string out;
+            for (int j = 0; j < 50'000; ++j) {
+                if (!store.get_into("key" + std::to_string(j % 256), out))
+                    continue;
+                bool ok = !out.empty() &&
+                          out.size() == 8 + static_cast<size_t>(out[0] - 'a') * 7 &&
+                          out.find_first_not_of(out[0]) == std::string::npos;
+                if (!ok)
+                    ++torn;
+            }
+        });
+    }
+
+    for (auto& r : readers) r.join();
+    stop = true;
+    writer.join();
+    EXPECT_EQ(torn.load(), 0u);
+}
+
+TEST(KVStoreConcurrencyTest, PinnedValuesStayIntactUnderChurn) {
+    Options options;
+    options.capacity = 256;
+    options.num_shards = 2;
+    KVStore store(options);
+    auto value_for = [](int version) {
+        char c = static_cast<char>('a' + version % 26);
+        return std::string(8 + (version % 26) * 7, c);
+    };
+
+    std::atomic<bool> stop{false};
+    std::thread writer([&]() {
+        int i = 0;
+        while (!stop) {
+            store.put("key" + std::to_string(i % 512), value_for(i));
+            ++i;
+        }
+    });
+
+    std::atomic<size_t> torn{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&]() {
+            for (int j = 0; j < 2'000; ++j) {
+                ValueHandle handle = store.pin("key" + std::to_string(j % 512));
+                if (!handle)
+                    continue;
+                std::string first(handle.value());
+                std::this_thread::yield();
+                // The writer has had a chance to overwrite or evict the key;
+                // the pinned bytes must not have changed.
+                if (handle.value() != first ||
+                    first.find_first_not_of(first[0]) != std::string::npos)
+                    ++torn;
+            }
+        });
+    }
+
+    for (auto& r : readers) r.join();
+    stop = true;
+    writer.join();
+    EXPECT_EQ(torn.load(), 0u);
+}
+
+template <typename Store>
+class ShardLockStoreTest : public ::testing::Test {};
+
+using LockedStores = ::testing::Types<BasicKVStore<LruPolicy, BackoffLock>, BasicKVStore<LruPolicy, AdaptiveLock>,
+                                      BasicKVStore<LruPolicy, SharedAdaptiveLock>>;
+TYPED_TEST_SUITE(ShardLockStoreTest, LockedStores);
+
+// Writers, pinned readers and copying readers on a small store, with more
+// threads than cores.
+TYPED_TEST(ShardLockStoreTest, MixedTrafficStaysConsistent) {
+    Options options;
+    options.capacity = 256;
+    options.num_shards = 2;
+    TypeParam store(options);
+    auto value_for = [](int version) {
+        char c = static_cast<char>('a' + version % 26);
+        return std::string(8 + (version % 26) * 7, c);
+    };
+    auto well_formed = [](std::string_view v) {
+        return !v.empty() && v.size() == 8 + static_cast<size_t>(v[0] - 'a') * 7 &&
+               v.find_first_not_of(v[0]) == std::string_view::npos;
+    };
+
+    std::atomic<size_t> torn{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 20'000; ++i) {
+                std::string key = "key" + std::to_string((i * 7 + t) % 512);
+                if (i % 11 == 0)
+                    store.erase(key);
+                else
+                    store.put(key, value_for(i));
+            }
+        });
+    }
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            std::string out;
+            for (int i = 0; i < 20'000; ++i) {
+                std::string key = "key" + std::to_string((i * 13 + t) % 512);
+                if (t % 2 == 0) {
+                    ValueHandle handle = store.pin(key);
+                    if (handle && !well_formed(handle.value()))
+                        ++torn;
+                } else if (store.get_into(key, out) && !well_formed(out)) {
+                    ++torn;
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(torn.load(), 0u);
+    EXPECT_LE(store.size(), 256u);
+}
+
+// Writers race the commit thread and, with a 64 KB commit size, each other's
+// backpressure commits; every thread's last write per key must come back.
+TEST(KVStoreConcurrencyTest, DurableWritesFromManyThreadsReplay) {
+    std::string path = ::testing::TempDir() + "kvstore_concurrent_" + std::to_string(::getpid()) + ".wal";
+    Options options;
+    options.capacity = 1 << 14;
+    options.wal_path = path;
+    options.wal_commit_bytes = 64 * 1024;
+    options.wal_commit_interval = std::chrono::milliseconds(1);
+
+    constexpr int THREADS = 4;
+    constexpr int KEYS = 1000;
+    {
+        KVStore store(options);
+        std::vector<std::thread> writers;
+        for (int t = 0; t < THREADS; ++t) {
+            writers.emplace_back([&, t] {
+                for (int round = 0; round < 5; ++round)
+                    for (int i = 0; i < KEYS; ++i)
+                        store.put("t" + std::to_string(t) + "_" + std::to_string(i), std::to_string(round));
+            });
+        }
+        for (auto& writer : writers)
+            writer.join();
+        store.sync();
+    }
+
+    KVStore store(options);
+    EXPECT_EQ(store.size(), size_t{THREADS * KEYS});
+    for (int t = 0; t < THREADS; ++t)
+        for (int i = 0; i < KEYS; ++i)
+            EXPECT_EQ(store.get("t" + std::to_string(t) + "_" + std::to_string(i)), "4");
+    std::remove(path.c_str());
+    std::remove((path + ".snap").c_str());
+}
@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 #include "lru-kvstore/kv_store.hpp"
 
+#include <chrono>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
 using namespace kvstore;
 
 
@@ -133,3 +138,517 @@ TEST(KVStoreTest, ReinsertSameKeyAfterEviction) {
     auto val = store.get(key);
     EXPECT_TRUE(val.has_value());
 }
+
+TEST(KVStoreOptionsTest, DefaultStoreUsesDefaultCapacity) {
+    KVStore store;
+    EXPECT_EQ(store.capacity(), DEFAULT_CAPACITY);
+    EXPECT_EQ(store.shard_count(), DEFAULT_NUM_SHARDS);
+}
+
+TEST(KVStoreOptionsTest, SizeNeverExceedsConfiguredCapacity) {
+    Options options;
+    options.capacity = 100;
+    options.num_shards = 3;
+    KVStore store(options);
+
+    for (int i = 0; i < 1000; ++i) {
+        store.put("key" + std::to_string(i), "val");
+    }
+
+    EXPECT_LE(store.size(), 100u);
+    EXPECT_GT(store.size(), 0u);
+    EXPECT_TRUE(store.get("key999").has_value());
+}
+
+TEST(KVStoreOptionsTest, LargeCapacityHoldsAllKeys) {
+    Options options;
+    options.capacity = 1 << 16;
+    options.num_shards = 4;
+    KVStore store(options);
+
+    auto keys = generate_keys(1 << 15);
+    for (const auto& key : keys) {
+        store.put(key, "val");
+    }
+
+    EXPECT_EQ(store.size(), keys.size());
+    for (const auto& key : keys) {
+        ASSERT_TRUE(store.get(key).has_value());
+    }
+}
+
+TEST(KVStoreOptionsTest, InvalidOptionsThrow) {
+    Options no_shards;
+    no_shards.num_shards = 0;
+    EXPECT_THROW(KVStore{no_shards}, std::invalid_argument);
+
+    Options bad_load;
+    bad_load.load_factor = 1.5;
+    EXPECT_THROW(KVStore{bad_load}, std::invalid_argument);
+}
+
+TEST(KVStoreTableTest, RandomInsertEraseMatchesReferenceMap) {
+    Options options;
+    options.capacity = 4096;
+    options.num_shards = 2;
+    KVStore store(options);
+
+    std::unordered_map<std::string, std::string> reference;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> key_dist(0, 1999);
+
+    for (int i = 0; i < 50000; ++i) {
+        std::string key = "k" + std::to_string(key_dist(rng));
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(store.erase(key), reference.erase(key) == 1);
+        } else {
+            std::string value = "v" + std::to_string(i);
+            store.put(key, value);
+            reference[key] = value;
+        }
+    }
+
+    EXPECT_EQ(store.size(), reference.size());
+    for (int k = 0; k < 2000; ++k) {
+        std::string key = "k" + std::to_string(k);
+        auto it = reference.find(key);
+        auto val = store.get(key);
+        if (it == reference.end()) {
+            EXPECT_FALSE(val.has_value());
+        } else {
+            ASSERT_TRUE(val.has_value());
+            EXPECT_EQ(*val, it->second);
+        }
+    }
+}
+
+TEST(KVStoreTableTest, ChurnLeavesNoLongProbeChains) {
+    KVStore store;
+    auto keys = generate_keys(CAPACITY * 10);
+    for (const auto& key : keys) {
+        store.put(key, "val");
+    }
+    for (size_t i = 0; i < CAPACITY * 10; i += 2) {
+        store.erase(keys[i]);
+    }
+
+    auto histogram = store.probe_histogram();
+    uint64_t entries = 0;
+    for (auto count : histogram.hit) entries += count;
+
+    EXPECT_EQ(entries, store.size());
+    EXPECT_LT(histogram.max_miss, 32u);
+    EXPECT_LT(ProbeHistogram::mean(histogram.miss), 4.0);
+}
+
+TEST(KVStoreTableTest, ScalarAndSimdKernelsAgree) {
+    Options simd_options;
+    simd_options.capacity = 2048;
+    Options scalar_options = simd_options;
+    scalar_options.probe_kernel = ProbeKernel::Scalar;
+
+    KVStore simd(simd_options);
+    KVStore scalar(scalar_options);
+
+    auto keys = generate_keys(4096);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        simd.put(keys[i], "v" + std::to_string(i));
+        scalar.put(keys[i], "v" + std::to_string(i));
+        if (i % 5 == 0) {
+            simd.erase(keys[i / 2]);
+            scalar.erase(keys[i / 2]);
+        }
+    }
+
+    EXPECT_EQ(simd.size(), scalar.size());
+    for (const auto& key : keys) {
+        EXPECT_EQ(simd.get(key), scalar.get(key));
+    }
+}
+
+TEST(KVStoreTableTest, TablesSmallerThanAGroupWrapCorrectly) {
+    Options options;
+    options.capacity = 3;
+    options.num_shards = 1;
+    for (auto kernel : {ProbeKernel::Simd, ProbeKernel::Scalar}) {
+        options.probe_kernel = kernel;
+        KVStore store(options);
+
+        for (int i = 0; i < 100; ++i) {
+            store.put("k" + std::to_string(i), "v" + std::to_string(i));
+            EXPECT_EQ(store.get("k" + std::to_string(i)), std::optional<std::string>("v" + std::to_string(i)));
+            if (i % 3 == 0) {
+                EXPECT_TRUE(store.erase("k" + std::to_string(i)));
+            }
+        }
+        EXPECT_LE(store.size(), 3u);
+        EXPECT_TRUE(store.get("k98").has_value());
+        EXPECT_FALSE(store.get("k99").has_value());
+    }
+}
+
+TEST(KVStoreValueTest, LongKeysAndValuesRoundTrip) {
+    KVStore store;
+    std::string key(300, 'k');
+    std::string value(5000, 'v');
+    value[4999] = 'z';
+
+    EXPECT_TRUE(store.put(key, value));
+    EXPECT_EQ(store.get(key), std::optional<std::string>(value));
+}
+
+TEST(KVStoreValueTest, OverwriteAcrossSizeClasses) {
+    KVStore store;
+    store.put("key", "small");
+    store.put("key", std::string(2000, 'x'));
+    EXPECT_EQ(store.get("key"), std::optional<std::string>(std::string(2000, 'x')));
+    store.put("key", "tiny");
+    EXPECT_EQ(store.get("key"), std::optional<std::string>("tiny"));
+    EXPECT_EQ(store.size(), 1u);
+}
+
+TEST(KVStoreValueTest, OversizedEntryIsRejected) {
+    KVStore store;
+    store.put("big", "old");
+    EXPECT_FALSE(store.put("big", std::string(SLAB_PAGE_SIZE, 'x')));
+    EXPECT_FALSE(store.get("big").has_value());
+}
+
+// The slab follows the default store's budget, and entries of a new size
+// take a page from the emptiest class instead of evicting the LRU tail
+// until one frees up.
+TEST(KVStoreValueTest, NewSizeClassesKeepMostEntries) {
+    KVStore store;
+    EXPECT_LE(store.memory_usage().data_bytes_reserved, 2 * store.memory_budget());
+    for (int i = 0; i < 980; ++i)
+        store.put("key" + std::to_string(i), "v");
+    size_t before = store.size();
+    ASSERT_GE(before, 950u);
+
+    for (int round = 0; round < 8; ++round) {
+        for (size_t bytes : {40, 200, 1000})
+            EXPECT_TRUE(store.put("mixed" + std::to_string(round) + "_" + std::to_string(bytes), std::string(bytes, 'm')));
+    }
+    EXPECT_GE(store.size(), before - 50);
+    EXPECT_LE(store.memory_usage().data_bytes_reserved, 2 * store.memory_budget());
+}
+
+TEST(KVStoreValueTest, MemoryBudgetLimitsStoredBytes) {
+    Options options;
+    options.capacity = 0;
+    options.memory_budget = 1 << 20;
+    options.num_shards = 4;
+    KVStore store(options);
+
+    std::string value(1000, 'v');
+    for (int i = 0; i < 10000; ++i) {
+        store.put("key" + std::to_string(i), value);
+    }
+
+    auto usage = store.memory_usage();
+    EXPECT_LE(usage.data_bytes_reserved, options.memory_budget);
+    EXPECT_GT(store.size(), 500u);
+    EXPECT_LT(store.size(), 1100u);
+    EXPECT_TRUE(store.get("key9999").has_value());
+}
+
+TEST(KVStoreValueTest, GetIntoCopiesAndReportsFullSize) {
+    KVStore store;
+    std::string value(3000, 'v');
+    value[0] = 'a';
+    store.put("key", value);
+
+    char small[4];
+    auto size = store.get_into("key", std::span<char>(small));
+    ASSERT_TRUE(size.has_value());
+    EXPECT_EQ(*size, value.size());
+    EXPECT_EQ(std::string_view(small, 4), "avvv");
+
+    std::string out = "stale";
+    EXPECT_TRUE(store.get_into("key", out));
+    EXPECT_EQ(out, value);
+
+    EXPECT_FALSE(store.get_into("missing", std::span<char>(small)).has_value());
+    EXPECT_FALSE(store.get_into("missing", out));
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(KVStoreHandleTest, PinnedValueSurvivesOverwriteEraseAndEviction) {
+    Options options;
+    options.capacity = 64;
+    options.num_shards = 1;
+    KVStore store(options);
+    store.put("key", "original");
+
+    ValueHandle handle = store.pin("key");
+    ASSERT_TRUE(handle);
+    store.put("key", "replaced");
+    EXPECT_EQ(handle.value(), "original");
+    EXPECT_EQ(store.get("key"), std::optional<std::string_view>("replaced"));
+
+    ValueHandle second = store.pin("key");
+    store.erase("key");
+    for (int i = 0; i < 8; ++i)
+        store.put("other" + std::to_string(i), std::string(100, 'x'));
+    EXPECT_EQ(handle.value(), "original");
+    EXPECT_EQ(*second, "replaced");
+
+    EXPECT_FALSE(store.pin("missing"));
+}
+
+TEST(KVStoreHandleTest, ReleasedHandlesLetTheShardRecycle) {
+    Options options;
+    options.capacity = 64;
+    options.num_shards = 1;
+    KVStore store(options);
+    for (int i = 0; i < 64; ++i)
+        store.put("key" + std::to_string(i), "value");
+
+    ValueHandle handle = store.pin("key0");
+    // Only the pinned chunk is held back; every other eviction frees its
+    // node and chunk at once.
+    for (int i = 64; i < 256; ++i)
+        EXPECT_TRUE(store.put("key" + std::to_string(i), "value"));
+    EXPECT_EQ(store.size(), 64u);
+    EXPECT_EQ(store.stats().retired, 1u);
+    EXPECT_EQ(handle.value(), "value");
+
+    handle.reset();
+    for (int i = 256; i < 512; ++i)
+        EXPECT_TRUE(store.put("key" + std::to_string(i), "value"));
+    EXPECT_EQ(store.size(), 64u);
+    EXPECT_EQ(store.memory_usage().payload_bytes, 64u * (6 + 5));
+}
+
+// A handle on one key does not stop writes to a full shard: unpinned keys
+// are overwritten in place or moved, the pinned one moves and its old
+// chunk waits in the retired ring, and inserts evict as usual.
+TEST(KVStoreHandleTest, FullShardTakesWritesWhilePinned) {
+    Options options;
+    options.capacity = 64;
+    options.num_shards = 1;
+    KVStore store(options);
+    for (int i = 0; i < 64; ++i)
+        store.put("k" + std::to_string(i), "value");
+
+    ValueHandle handle = store.pin("k0");
+    EXPECT_TRUE(store.put("k5", "other"));
+    EXPECT_TRUE(store.put("k6", std::string(300, 'x')));
+    for (int i = 0; i < 8; ++i)
+        EXPECT_TRUE(store.put("k0", "next" + std::to_string(i)));
+    EXPECT_TRUE(store.put("fresh", "value"));
+    EXPECT_EQ(store.size(), 64u);
+    EXPECT_EQ(store.get("k5"), std::optional<std::string_view>("other"));
+    EXPECT_EQ(store.get("k0"), std::optional<std::string_view>("next7"));
+    EXPECT_EQ(handle.value(), "value");
+    EXPECT_EQ(store.stats().retired, 1u);
+}
+
+TEST(KVStorePromotionTest, ReadKeysSurviveEviction) {
+    for (bool promote : {true, false}) {
+        Options options;
+        options.capacity = 64;
+        options.num_shards = 1;
+        options.promote_on_read = promote;
+        KVStore store(options);
+        for (int i = 0; i < 64; ++i)
+            store.put("key" + std::to_string(i), "value");
+
+        std::string out;
+        EXPECT_TRUE(store.get_into("key0", out));   // buffered
+        EXPECT_TRUE(store.get("key1").has_value()); // promoted under the lock
+        for (int i = 64; i < 126; ++i)
+            store.put("key" + std::to_string(i), "value");
+
+        EXPECT_EQ(store.get_into("key0", out), promote);
+        EXPECT_EQ(store.get("key1").has_value(), promote);
+        EXPECT_FALSE(store.get("key2").has_value());
+    }
+}
+
+// More keys than one batch, with misses and a repeated key mixed in.
+TEST(KVStoreBatchTest, MultiGetMatchesGet) {
+    KVStore store;
+    for (int i = 0; i < 300; i += 2)
+        store.put("key" + std::to_string(i), "value" + std::to_string(i));
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 300; ++i)
+        names.push_back("key" + std::to_string(i));
+    names.push_back("key4");
+    std::vector<std::string_view> keys(names.begin(), names.end());
+    std::vector<std::optional<std::string>> values(keys.size(), std::string("stale"));
+
+    size_t hits = store.multi_get(keys, values);
+
+    EXPECT_EQ(hits, 151u);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto expected = store.get(keys[i]);
+        ASSERT_EQ(values[i].has_value(), expected.has_value()) << keys[i];
+        if (expected) {
+            EXPECT_EQ(*values[i], *expected);
+        }
+    }
+}
+
+TEST(KVStoreBatchTest, MultiPutAppliesEntriesInOrder) {
+    KVStore store;
+    store.put("big", "old");
+    std::string huge(store.max_entry_bytes() + 1, 'x');
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 200; ++i)
+        names.push_back("key" + std::to_string(i));
+    std::vector<std::pair<std::string_view, std::string_view>> entries;
+    for (const auto& name : names)
+        entries.emplace_back(name, "first");
+    entries.emplace_back("key7", "second");
+    entries.emplace_back("big", huge);
+
+    EXPECT_EQ(store.multi_put(entries), 201u);
+    EXPECT_EQ(store.size(), 200u);
+    EXPECT_EQ(store.get("key0"), "first");
+    EXPECT_EQ(store.get("key7"), "second");
+    EXPECT_FALSE(store.get("big").has_value());
+}
+
+TEST(KVStoreBatchTest, LookupManyMatchesGet) {
+    KVStore store;
+    for (int i = 0; i < 300; i += 2)
+        store.put("key" + std::to_string(i), std::string(i % 4 == 0 ? 4 : 20, 'v'));
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 300; ++i)
+        names.push_back("key" + std::to_string(i));
+    std::vector<std::string_view> keys(names.begin(), names.end());
+
+    // Values longer than a fresh std::string's inline buffer take the resize path.
+    for (size_t depth : {1, 4, 32, 100}) {
+        std::vector<std::optional<std::string>> values(keys.size());
+        EXPECT_EQ(store.lookup_many(keys, values, depth), store.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            auto expected = store.get(keys[i]);
+            ASSERT_EQ(values[i].has_value(), expected.has_value()) << keys[i];
+            if (expected) {
+                EXPECT_EQ(*values[i], *expected);
+            }
+        }
+    }
+}
+
+TEST(KVStoreHashTest, PrehashedCallsMatchPlainOnes) {
+    KVStore store;
+    auto key = KVStore::prehash("key");
+    EXPECT_TRUE(store.put(key, "value"));
+    EXPECT_EQ(store.get("key"), "value");
+    EXPECT_EQ(store.get(key), "value");
+    EXPECT_EQ(store.pin(key).value(), "value");
+
+    std::string out;
+    EXPECT_TRUE(store.get_into(key, out));
+    EXPECT_EQ(out, "value");
+    char buffer[8];
+    EXPECT_EQ(store.get_into(key, std::span<char>(buffer)), 5u);
+
+    EXPECT_TRUE(store.erase(key));
+    EXPECT_FALSE(store.get("key").has_value());
+    EXPECT_FALSE(store.get(key).has_value());
+}
+
+TEST(KVStoreHashTest, FnvHasherStoreWorks) {
+    BasicKVStore<LruPolicy, SpinLock, FnvHasher> store;
+    for (int i = 0; i < 100; ++i)
+        store.put("key" + std::to_string(i), "value" + std::to_string(i));
+    EXPECT_EQ(store.size(), 100u);
+    EXPECT_EQ(store.get("key42"), "value42");
+    EXPECT_EQ(store.get(decltype(store)::prehash("key7")), "value7");
+    EXPECT_NE(decltype(store)::prehash("key7").hash, KVStore::prehash("key7").hash);
+}
+
+namespace {
+    using namespace std::chrono_literals;
+
+    Options expiring_store(size_t capacity = CAPACITY, std::chrono::milliseconds interval = 0ms) {
+        Options options;
+        options.capacity = capacity;
+        options.num_shards = 1;
+        options.expiry = true;
+        options.expiry_interval = interval;
+        return options;
+    }
+}
+
+TEST(KVStoreExpiryTest, ExpiredEntriesReadAsMisses) {
+    KVStore store(expiring_store());
+    store.put("short", "a", 30ms);
+    store.put("long", "b", 1h);
+    store.put("forever", "c");
+    store.put("cleared", "d", 30ms);
+    store.put("cleared", "e");
+    std::this_thread::sleep_for(80ms);
+
+    std::string out;
+    EXPECT_FALSE(store.get("short").has_value());
+    EXPECT_FALSE(store.get_into("short", out));
+    EXPECT_FALSE(store.pin("short"));
+    EXPECT_EQ(store.get("long"), "b");
+    EXPECT_EQ(store.get("forever"), "c");
+    EXPECT_EQ(store.get("cleared"), "e");
+
+    std::vector<std::string_view> keys = {"short", "long"};
+    std::vector<std::optional<std::string>> values(keys.size());
+    EXPECT_EQ(store.lookup_many(keys, values), 1u);
+    EXPECT_FALSE(values[0].has_value());
+    EXPECT_EQ(values[1], "b");
+    EXPECT_FALSE(store.erase("short"));
+    EXPECT_EQ(store.size(), 3u);
+
+    // An expired key can be stored again.
+    store.put("cleared", "f", 30ms);
+    store.put("short", "g");
+    EXPECT_EQ(store.get("short"), "g");
+}
+
+TEST(KVStoreExpiryTest, WritesReclaimExpiredEntriesBeforeEvicting) {
+    KVStore store(expiring_store(64));
+    for (int i = 0; i < 32; ++i)
+        store.put("live" + std::to_string(i), "v");
+    for (int i = 0; i < 32; ++i)
+        store.put("temp" + std::to_string(i), "v", 20ms);
+    std::this_thread::sleep_for(60ms);
+
+    // The shard is full, but the first write reclaims the expired half.
+    for (int i = 0; i < 32; ++i)
+        store.put("new" + std::to_string(i), "v");
+    EXPECT_EQ(store.size(), 64u);
+    for (int i = 0; i < 32; ++i)
+        EXPECT_TRUE(store.get("live" + std::to_string(i)).has_value()) << i;
+}
+
+TEST(KVStoreExpiryTest, ExpireAndMaintenanceThreadReclaim) {
+    KVStore manual(expiring_store());
+    for (int i = 0; i < 100; ++i)
+        manual.put("key" + std::to_string(i), "v", 20ms);
+    EXPECT_EQ(manual.expire(), 0u);
+    std::this_thread::sleep_for(60ms);
+    EXPECT_EQ(manual.expire(), 100u);
+    EXPECT_EQ(manual.size(), 0u);
+
+    KVStore background(expiring_store(CAPACITY, 5ms));
+    for (int i = 0; i < 100; ++i)
+        background.put("key" + std::to_string(i), "v", 10ms);
+    for (int wait = 0; wait < 200 && background.size() > 0; ++wait)
+        std::this_thread::sleep_for(5ms);
+    EXPECT_EQ(background.size(), 0u);
+}
+
+TEST(KVStoreExpiryTest, TtlNeedsExpiryAndPositiveDuration) {
+    KVStore plain;
+    EXPECT_THROW(plain.put("key", "value", 1s), std::logic_error);
+    KVStore store(expiring_store());
+    EXPECT_THROW(store.put("key", "value", 0ms), std::invalid_argument);
+
+    Options options;
+    options.expiry_interval = 10ms;
+    EXPECT_THROW(KVStore{options}, std::invalid_argument);
+}
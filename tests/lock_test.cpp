@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/concurrency.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using namespace kvstore;
+
+template <typename Lock>
+class ShardLockTest : public ::testing::Test {};
+
+using Locks = ::testing::Types<SpinLock, BackoffLock, AdaptiveLock, SharedAdaptiveLock>;
+TYPED_TEST_SUITE(ShardLockTest, Locks);
+
+// More threads than the test VM has cores, so holders get preempted.
+TYPED_TEST(ShardLockTest, MutualExclusionWhenOversubscribed) {
+    TypeParam lock;
+    size_t counter = 0;
+    const int threads = 2 * std::max(2u, std::thread::hardware_concurrency());
+    const int per_thread = 20'000;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < per_thread; ++i) {
+                std::lock_guard<TypeParam> guard(lock);
+                ++counter;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    EXPECT_EQ(counter, static_cast<size_t>(threads) * per_thread);
+}
+
+TYPED_TEST(ShardLockTest, TryLockFailsWhileHeld) {
+    TypeParam lock;
+    lock.lock();
+    std::thread other([&]() { EXPECT_FALSE(lock.try_lock()); });
+    other.join();
+    lock.unlock();
+    EXPECT_TRUE(lock.try_lock());
+    lock.unlock();
+}
+
+// A holder that sleeps far longer than SPIN_LIMIT pauses: the waiter has to
+// spin first and record it. Only the adaptive locks then go to sleep.
+TYPED_TEST(ShardLockTest, CountersRecordContention) {
+    TypeParam lock;
+    lock.lock();
+    std::thread waiter([&]() {
+        std::lock_guard<TypeParam> guard(lock);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    lock.unlock();
+    waiter.join();
+
+    LockCounters counters = lock.counters();
+    EXPECT_GT(counters.spins, 0u);
+    if constexpr (std::is_same_v<TypeParam, AdaptiveLock> || std::is_same_v<TypeParam, SharedAdaptiveLock>) {
+        EXPECT_GE(counters.sleeps, 1u);
+    } else {
+        EXPECT_EQ(counters.sleeps, 0u);
+    }
+}
+
+TEST(SharedAdaptiveLockTest, ReadersShareWritersExclude) {
+    SharedAdaptiveLock lock;
+    lock.lock_shared();
+    lock.lock_shared();
+    EXPECT_FALSE(lock.try_lock());
+
+    std::atomic<bool> written{false};
+    std::thread writer([&]() {
+        std::lock_guard<SharedAdaptiveLock> guard(lock);
+        written = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(written.load());
+
+    lock.unlock_shared();
+    lock.unlock_shared();
+    writer.join();
+    EXPECT_TRUE(written.load());
+    EXPECT_TRUE(lock.try_lock());
+    lock.unlock();
+}
+
+// A waiting writer holds off new readers, so a steady stream of them cannot
+// starve it.
+TEST(SharedAdaptiveLockTest, WaitingWriterBlocksNewReaders) {
+    SharedAdaptiveLock lock;
+    lock.lock_shared();
+
+    std::atomic<bool> written{false};
+    std::thread writer([&]() {
+        std::lock_guard<SharedAdaptiveLock> guard(lock);
+        written = true;
+    });
+    while (!(lock.state.load() & SharedAdaptiveLock::PENDING))
+        std::this_thread::yield();
+
+    std::atomic<bool> read{false};
+    std::thread reader([&]() {
+        std::shared_lock<SharedAdaptiveLock> guard(lock);
+        EXPECT_TRUE(written.load());
+        read = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(read.load());
+
+    lock.unlock_shared();
+    writer.join();
+    reader.join();
+    EXPECT_TRUE(read.load());
+}
@@ -0,0 +1,268 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/memcached.hpp"
+#include "lru-kvstore/server.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace kvstore;
+using namespace std::chrono_literals;
+
+namespace {
+    Options expiring_options() {
+        Options options;
+        options.capacity = 1024;
+        options.expiry = true;
+        return options;
+    }
+
+    // Runs `input` through a session and returns everything it queued.
+    std::string run(McSession& session, std::string input, size_t* consumed = nullptr) {
+        size_t used = session.execute(input.data(), input.data() + input.size());
+        if (consumed)
+            *consumed = used;
+        McOutput& out = session.output();
+        std::string reply;
+        iovec iov[16];
+        while (!out.empty()) {
+            size_t count = out.gather(iov, 16);
+            size_t bytes = 0;
+            for (size_t i = 0; i < count; ++i) {
+                reply.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+                bytes += iov[i].iov_len;
+            }
+            out.consume(bytes);
+        }
+        return reply;
+    }
+
+    int connect_to(uint16_t port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+        return fd;
+    }
+
+    void send_all(int fd, std::string_view data) {
+        while (!data.empty()) {
+            ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            ASSERT_GT(n, 0);
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+    }
+
+    // Reads until `bytes` have arrived or the server closes.
+    std::string receive(int fd, size_t bytes) {
+        std::string data;
+        char buffer[4096];
+        while (data.size() < bytes) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                break;
+            data.append(buffer, static_cast<size_t>(n));
+        }
+        return data;
+    }
+}
+
+TEST(MemcachedTest, ParsesRequestsInPlace) {
+    std::string input = "get a bb ccc\r\nset key 7 0 5 noreply\r\nhello\r\ndelete key\r\nquit\r\n";
+    char* begin = input.data();
+    char* end = begin + input.size();
+    McRequest request;
+    size_t consumed = 0;
+
+    ASSERT_EQ(parse_request(begin, end, request, consumed), McParse::Request);
+    EXPECT_EQ(request.command, McCommand::Get);
+    EXPECT_EQ(request.keys, "a bb ccc");
+    EXPECT_EQ(request.keys.data(), begin + 4);
+    begin += consumed;
+
+    ASSERT_EQ(parse_request(begin, end, request, consumed), McParse::Request);
+    EXPECT_EQ(request.command, McCommand::Set);
+    EXPECT_EQ(request.keys, "key");
+    EXPECT_EQ(request.flags, 7u);
+    EXPECT_EQ(request.bytes, 5u);
+    EXPECT_TRUE(request.noreply);
+    EXPECT_EQ(std::string_view(request.data, request.bytes), "hello");
+    begin += consumed;
+
+    ASSERT_EQ(parse_request(begin, end, request, consumed), McParse::Request);
+    EXPECT_EQ(request.command, McCommand::Delete);
+    EXPECT_FALSE(request.noreply);
+    begin += consumed;
+
+    ASSERT_EQ(parse_request(begin, end, request, consumed), McParse::Request);
+    EXPECT_EQ(request.command, McCommand::Quit);
+    EXPECT_EQ(begin + consumed, end);
+}
+
+TEST(MemcachedTest, WaitsForTheWholeRequest) {
+    std::string input = "set key 0 0 10\r\nhello";
+    McRequest request;
+    size_t consumed = 1;
+    EXPECT_EQ(parse_request(input.data(), input.data() + input.size(), request, consumed), McParse::Incomplete);
+    EXPECT_EQ(consumed, 0u);
+    input = "get ke";
+    EXPECT_EQ(parse_request(input.data(), input.data() + input.size(), request, consumed), McParse::Incomplete);
+}
+
+TEST(MemcachedTest, RejectsMalformedRequests) {
+    McRequest request;
+    size_t consumed = 0;
+    auto parse = [&](std::string input) { return parse_request(input.data(), input.data() + input.size(), request, consumed); };
+
+    EXPECT_EQ(parse("flush_all\r\n"), McParse::Error);
+    EXPECT_EQ(parse("get\r\n"), McParse::ClientError);
+    EXPECT_EQ(parse("get " + std::string(MC_MAX_KEY + 1, 'k') + "\r\n"), McParse::ClientError);
+    EXPECT_EQ(parse("set key x 0 5\r\nhello\r\n"), McParse::ClientError);
+    EXPECT_EQ(parse("set key 0 0 5 sometimes\r\nhello\r\n"), McParse::ClientError);
+    EXPECT_EQ(parse("set key 0 0 5\r\nhello!!"), McParse::ClientError);
+    EXPECT_STREQ(request.error, "bad data chunk");
+    EXPECT_EQ(consumed, 22u);
+    EXPECT_EQ(parse("delete\r\n"), McParse::ClientError);
+    EXPECT_EQ(parse(std::string(MC_MAX_LINE, 'x')), McParse::Fatal);
+    EXPECT_EQ(parse("set key 0 0 " + std::to_string(MC_MAX_VALUE + 1) + "\r\n"), McParse::Fatal);
+}
+
+TEST(MemcachedTest, SessionAnswersPipelinedRequests) {
+    KVStore store(expiring_options());
+    McSession session(store);
+    std::string reply = run(session,
+                            "set a 42 0 3\r\none\r\n"
+                            "set b 0 0 0\r\n\r\n"
+                            "get a b missing\r\n"
+                            "gets a\r\n"
+                            "delete a\r\n"
+                            "delete a\r\n"
+                            "set c 0 0 1 noreply\r\nx\r\n"
+                            "get c\r\n"
+                            "bogus\r\n");
+    EXPECT_EQ(reply,
+              "STORED\r\n"
+              "STORED\r\n"
+              "VALUE a 42 3\r\none\r\nVALUE b 0 0\r\n\r\nEND\r\n"
+              "VALUE a 42 3 1\r\none\r\nEND\r\n"
+              "DELETED\r\n"
+              "NOT_FOUND\r\n"
+              "VALUE c 0 1\r\nx\r\nEND\r\n"
+              "ERROR\r\n");
+    EXPECT_FALSE(session.closing());
+}
+
+TEST(MemcachedTest, SessionLeavesIncompleteRequestsAndStopsAtQuit) {
+    KVStore store(expiring_options());
+    McSession session(store);
+    size_t consumed = 0;
+    EXPECT_EQ(run(session, "set a 0 0 5\r\nhel", &consumed), "");
+    EXPECT_EQ(consumed, 0u);
+    EXPECT_EQ(run(session, "get a\r\nquit\r\nget a\r\n", &consumed), "END\r\n");
+    EXPECT_EQ(consumed, 13u);
+    EXPECT_TRUE(session.closing());
+}
+
+TEST(MemcachedTest, SessionHonoursExptime) {
+    KVStore store(expiring_options());
+    McSession session(store);
+    EXPECT_EQ(run(session, "set a 0 100 1\r\nx\r\nset b 0 -1 1\r\ny\r\nget a b\r\n"),
+              "STORED\r\nSTORED\r\nVALUE a 0 1\r\nx\r\nEND\r\n");
+
+    KVStore plain;
+    McSession without_expiry(plain);
+    EXPECT_EQ(run(without_expiry, "set a 0 100 1\r\nx\r\n"), "SERVER_ERROR expiry is not enabled\r\n");
+}
+
+TEST(MemcachedTest, SessionCopiesLargeValues) {
+    // Big enough a budget for 64 KiB slab pages.
+    Options options = expiring_options();
+    options.memory_budget = 8 << 20;
+    KVStore store(options);
+    McSession session(store);
+    std::string value(50'000, 'v');
+    std::string reply = run(session, "set big 0 0 50000\r\n" + value + "\r\nget big big\r\n");
+    std::string entry = "VALUE big 0 50000\r\n" + value + "\r\n";
+    EXPECT_EQ(reply, "STORED\r\n" + entry + entry + "END\r\n");
+}
+
+TEST(MemcachedTest, OutputResumesAfterPartialWrites) {
+    McOutput out;
+    out.append_constant("abc");
+    out.append_copy("defg");
+    out.append_copy("hi");
+    out.append_constant("jk");
+    EXPECT_EQ(out.pending_bytes(), 11u);
+
+    std::string sent;
+    iovec iov[2];
+    while (!out.empty()) {
+        size_t count = out.gather(iov, 2);
+        // Take at most 3 bytes per "write".
+        size_t taken = std::min<size_t>(3, iov[0].iov_len);
+        sent.append(static_cast<const char*>(iov[0].iov_base), taken);
+        out.consume(taken);
+        EXPECT_GE(count, 1u);
+    }
+    EXPECT_EQ(sent, "abcdefghijk");
+}
+
+TEST(MemcachedTest, ServerSpeaksTheProtocolOverTcp) {
+    KVStore store(expiring_options());
+    ServerOptions options;
+    options.port = 0;
+    options.threads = 2;
+    Server server(store, options);
+    ASSERT_NE(server.port(), 0);
+
+    std::vector<std::thread> clients;
+    for (int c = 0; c < 4; ++c) {
+        clients.emplace_back([&, c] {
+            int fd = connect_to(server.port());
+            std::string key = "key" + std::to_string(c);
+            std::string requests;
+            std::string expected;
+            for (int i = 0; i < 64; ++i) {
+                std::string value = std::to_string(i);
+                requests += "set " + key + " 0 0 " + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+                requests += "get " + key + "\r\n";
+                expected += "STORED\r\nVALUE " + key + " 0 " + std::to_string(value.size()) + "\r\n" + value +
+                            "\r\nEND\r\n";
+            }
+            // Sent in small pieces, so requests arrive split.
+            for (size_t pos = 0; pos < requests.size(); pos += 7)
+                send_all(fd, std::string_view(requests).substr(pos, 7));
+            EXPECT_EQ(receive(fd, expected.size()), expected);
+            send_all(fd, "quit\r\n");
+            EXPECT_EQ(receive(fd, 1), "");
+            ::close(fd);
+        });
+    }
+    for (auto& client : clients)
+        client.join();
+    EXPECT_EQ(store.size(), 4u);
+}
+
+TEST(MemcachedTest, ServerStopsWithConnectionsOpen) {
+    KVStore store(expiring_options());
+    ServerOptions options;
+    options.port = 0;
+    options.threads = 1;
+    auto server = std::make_unique<Server>(store, options);
+    int fd = connect_to(server->port());
+    send_all(fd, "set a 0 0 1\r\nx\r\n");
+    EXPECT_EQ(receive(fd, 8), "STORED\r\n");
+    server.reset();
+    EXPECT_EQ(receive(fd, 1), "");
+    ::close(fd);
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/hash.hpp"
+#include "lru-kvstore/miss_ratio.hpp"
+
+#include <list>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace kvstore;
+
+namespace {
+    uint64_t hash_of(uint64_t key) {
+        return WyHasher{}(std::to_string(key));
+    }
+
+    // Misses of an exact LRU cache of `capacity` entries over `trace`.
+    double lru_miss_ratio(const std::vector<uint64_t>& trace, size_t capacity) {
+        std::list<uint64_t> order;
+        std::unordered_map<uint64_t, std::list<uint64_t>::iterator> where;
+        size_t misses = 0;
+        for (uint64_t key : trace) {
+            auto it = where.find(key);
+            if (it != where.end()) {
+                order.erase(it->second);
+            } else {
+                ++misses;
+                if (order.size() == capacity) {
+                    where.erase(order.back());
+                    order.pop_back();
+                }
+            }
+            order.push_front(key);
+            where[key] = order.begin();
+        }
+        return static_cast<double>(misses) / static_cast<double>(trace.size());
+    }
+}
+
+// Sampling every key gives exact LRU reuse distances.
+TEST(MissRatioCurveTest, FullSamplingIsExactLru) {
+    MissRatioCurve curve(1.0);
+    // A cyclic scan over 10 keys: LRU misses every access below 10 entries.
+    for (int round = 0; round < 5; ++round)
+        for (uint64_t key = 0; key < 10; ++key)
+            curve.access(hash_of(key));
+    EXPECT_DOUBLE_EQ(curve.miss_ratio(9), 1.0);
+    EXPECT_NEAR(curve.miss_ratio(10), 10.0 / 50.0, 1e-12);
+    EXPECT_DOUBLE_EQ(curve.miss_ratio(0), 1.0);
+    EXPECT_EQ(curve.sampled_keys(), 10u);
+
+    std::mt19937_64 rng(7);
+    std::uniform_int_distribution<uint64_t> pick(0, 999);
+    std::vector<uint64_t> trace(50000);
+    for (auto& key : trace)
+        key = pick(rng) < 800 ? pick(rng) % 100 : pick(rng);
+    MissRatioCurve exact(1.0);
+    for (uint64_t key : trace)
+        exact.access(hash_of(key));
+    for (size_t capacity : {1, 10, 100, 500, 1000})
+        EXPECT_NEAR(exact.miss_ratio(capacity), lru_miss_ratio(trace, capacity), 1e-12) << capacity;
+}
+
+// 2400 accesses run the access clock past its first compaction; distances
+// stay exact across it.
+TEST(MissRatioCurveTest, ErasedKeysLeaveTheStack) {
+    MissRatioCurve curve(1.0);
+    for (int round = 0; round < 300; ++round) {
+        for (uint64_t key = 0; key < 8; ++key)
+            curve.access(hash_of(key));
+        curve.erase(hash_of(100));  // never seen: ignored
+    }
+    EXPECT_NEAR(curve.miss_ratio(8), 8.0 / 2400.0, 1e-12);
+    EXPECT_DOUBLE_EQ(curve.miss_ratio(7), 1.0);
+    // With half the keys erased, the others come back at distance 3.
+    for (uint64_t key = 4; key < 8; ++key)
+        curve.erase(hash_of(key));
+    for (uint64_t key = 0; key < 4; ++key)
+        curve.access(hash_of(key));
+    EXPECT_EQ(curve.sampled_keys(), 4u);
+    EXPECT_NEAR(curve.miss_ratio(4), 2400.0 / 2404.0, 1e-12);
+    EXPECT_NEAR(curve.miss_ratio(8), 8.0 / 2404.0, 1e-12);
+}
+
+TEST(MissRatioCurveTest, SampledEstimateTracksExactCurve) {
+    std::mt19937_64 rng(11);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::vector<uint64_t> trace(400000);
+    // Heavy-tailed popularity over 200K keys.
+    for (auto& key : trace)
+        key = static_cast<uint64_t>(200000.0 * u(rng) * u(rng) * u(rng));
+    MissRatioCurve sampled(0.05);
+    for (uint64_t key : trace)
+        sampled.access(hash_of(key));
+    EXPECT_EQ(sampled.accesses(), trace.size());
+    EXPECT_LT(sampled.sampled_accesses(), trace.size() / 10);
+    for (size_t capacity : {1000, 10000, 50000})
+        EXPECT_NEAR(sampled.miss_ratio(capacity), lru_miss_ratio(trace, capacity), 0.03) << capacity;
+}
+
+TEST(MissRatioCurveTest, RejectsBadRates) {
+    EXPECT_THROW(MissRatioCurve(0.0), std::invalid_argument);
+    EXPECT_THROW(MissRatioCurve(1.5), std::invalid_argument);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/numa.hpp"
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace kvstore;
+
+TEST(NumaTest, ReportsTheNodesOnline) {
+    size_t nodes = numa_node_count();
+    EXPECT_GE(nodes, 1u);
+    int node = numa_current_node();
+    EXPECT_GE(node, 0);
+    EXPECT_LT(static_cast<size_t>(node), nodes);
+}
+
+TEST(NumaTest, PlacementLeavesMemoryUsable) {
+    const size_t bytes = 16 * NUMA_PAGE_BYTES;
+    void* memory = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(memory, MAP_FAILED);
+    bool bound = numa_bind(memory, bytes / 2, 0);
+    bool interleaved = numa_interleave(static_cast<char*>(memory) + bytes / 2, bytes / 2);
+    if (numa_node_count() == 1) {
+        EXPECT_FALSE(bound);
+        EXPECT_FALSE(interleaved);
+    }
+    // Unaligned memory and nodes that do not exist are refused, not faulted on.
+    EXPECT_FALSE(numa_bind(static_cast<char*>(memory) + 1, NUMA_PAGE_BYTES, 0));
+    EXPECT_FALSE(numa_bind(memory, bytes, static_cast<int>(numa_node_count())));
+    EXPECT_FALSE(numa_run_on_node(-1));
+
+    auto* bytes_in = static_cast<unsigned char*>(memory);
+    for (size_t i = 0; i < bytes; ++i)
+        bytes_in[i] = static_cast<unsigned char>(i);
+    EXPECT_EQ(bytes_in[bytes - 1], static_cast<unsigned char>(bytes - 1));
+    ::munmap(memory, bytes);
+}
+
+TEST(NumaTest, PerShardPlacementMapsEveryShardToANode) {
+    Options options;
+    options.capacity = 4096;
+    options.num_shards = 8;
+    options.numa = NumaPlacement::PerShard;
+    KVStore store(options);
+
+    size_t nodes = numa_node_count();
+    for (size_t i = 0; i < store.shard_count(); ++i) {
+        EXPECT_EQ(store.shard_node(i), static_cast<int>(i * nodes / store.shard_count()));
+    }
+    for (int i = 0; i < 1024; ++i)
+        store.put("key" + std::to_string(i), "value" + std::to_string(i));
+    EXPECT_EQ(store.size(), 1024u);
+    for (int i = 0; i < 1024; ++i)
+        EXPECT_EQ(store.get("key" + std::to_string(i)), "value" + std::to_string(i));
+
+    KVStore unplaced;
+    EXPECT_EQ(unplaced.shard_node(0), -1);
+}
+
+TEST(NumaTest, InterleavedStoreWorks) {
+    Options options;
+    options.capacity = 1024;
+    options.numa = NumaPlacement::Interleave;
+    KVStore store(options);
+    for (int i = 0; i < 256; ++i)
+        store.put("key" + std::to_string(i), "value");
+    EXPECT_EQ(store.size(), 256u);
+    EXPECT_EQ(store.shard_node(0), -1);
+}
+
+TEST(NumaTest, ExplicitShardNodes) {
+    Options options;
+    options.capacity = 64;
+    options.num_shards = 2;
+    options.numa = NumaPlacement::PerShard;
+    options.shard_nodes = {0, 0};
+    KVStore store(options);
+    EXPECT_EQ(store.shard_node(0), 0);
+    EXPECT_EQ(store.shard_node(1), 0);
+
+    options.shard_nodes = {0};
+    EXPECT_THROW(KVStore{options}, std::invalid_argument);
+    options.shard_nodes = {0, static_cast<int>(numa_node_count())};
+    EXPECT_THROW(KVStore{options}, std::invalid_argument);
+    options.shard_nodes = {0, -1};
+    EXPECT_THROW(KVStore{options}, std::invalid_argument);
+    options.shard_nodes = {0, 0};
+    options.numa = NumaPlacement::Interleave;
+    EXPECT_THROW(KVStore{options}, std::invalid_argument);
+}
+
+TEST(NumaTest, ShardOfAgreesForPrehashedKeys) {
+    KVStore store;
+    for (int i = 0; i < 256; ++i) {
+        std::string key = "key" + std::to_string(i);
+        EXPECT_EQ(store.shard_of(KVStore::prehash(key)), store.shard_of(key));
+    }
+}
+
+TEST(NumaTest, PerShardSnapshotLoadsWithItsLayout) {
+    auto path = (std::filesystem::temp_directory_path() /
+                 ("kvstore_numa_" + std::to_string(::getpid()) + ".snap")).string();
+    Options options;
+    options.capacity = 1024;
+    options.num_shards = 4;
+    options.numa = NumaPlacement::PerShard;
+    {
+        KVStore store(options);
+        for (int i = 0; i < 256; ++i)
+            store.put("key" + std::to_string(i), "value" + std::to_string(i));
+        store.snapshot(path);
+    }
+    auto loaded = KVStore::load(path);
+    EXPECT_EQ(loaded->size(), 256u);
+    EXPECT_EQ(loaded->get("key7"), "value7");
+    EXPECT_GE(loaded->shard_node(3), 0);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/shared_memory.hpp"
+
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace kvstore;
+
+namespace {
+    // A fresh segment name; unlinks the segment on the way out.
+    struct SharedName {
+        explicit SharedName(const char* name)
+            : name(std::string("kvstore_") + name + "_" + std::to_string(::getpid())) {
+            SharedSegment::unlink(this->name);
+        }
+        ~SharedName() { SharedSegment::unlink(name); }
+
+        Options options(size_t capacity = 8192) const {
+            Options options;
+            options.capacity = capacity;
+            options.num_shards = 4;
+            options.shared_name = name;
+            return options;
+        }
+
+        std::string name;
+    };
+
+    // Runs `body` in a child process; true if it returned true. A process
+    // that maps a segment cannot attach to it again, so each store that
+    // should attach gets a process of its own.
+    pid_t spawn(const std::function<bool()>& body) {
+        pid_t child = ::fork();
+        if (child == 0) {
+            bool ok = false;
+            try {
+                ok = body();
+            } catch (...) {
+            }
+            std::_Exit(ok ? 0 : 1);
+        }
+        return child;
+    }
+
+    bool succeeded(pid_t child) {
+        int status = 0;
+        return child > 0 && ::waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+}
+
+// The segment outlives the process that created it.
+TEST(SharedMemoryTest, AttachSeesWritesOfExitedCreator) {
+    SharedName shared("exited");
+    ASSERT_TRUE(succeeded(spawn([&] {
+        KVStore store(shared.options());
+        for (int i = 0; i < 1000; ++i)
+            store.put("key" + std::to_string(i), "value" + std::to_string(i));
+        store.erase("key7");
+        return store.size() == 999;
+    })));
+
+    KVStore store(shared.options());
+    EXPECT_EQ(store.size(), 999u);
+    EXPECT_EQ(store.get("key0"), "value0");
+    EXPECT_EQ(store.get("key999"), "value999");
+    EXPECT_FALSE(store.get("key7").has_value());
+    auto handle = store.pin("key1");
+    ASSERT_TRUE(handle);
+    EXPECT_EQ(handle.value(), "value1");
+}
+
+// Processes race to create the segment, then write and read through the
+// same shards and locks.
+TEST(SharedMemoryTest, ProcessesShareOneStore) {
+    using Store = BasicKVStore<LruPolicy, AdaptiveLock>;
+    SharedName shared("many");
+    Options options = shared.options();
+
+    constexpr int PROCESSES = 4;
+    constexpr int KEYS = 2000;
+    std::vector<pid_t> children;
+    for (int p = 0; p < PROCESSES; ++p) {
+        children.push_back(spawn([&, p] {
+            Store store(options);
+            std::string prefix = "p" + std::to_string(p) + "-";
+            for (int i = 0; i < KEYS; ++i) {
+                store.put(prefix + std::to_string(i), std::to_string(i));
+                // Someone else's key, if it is there yet, must be intact.
+                auto other = store.get("p" + std::to_string((p + 1) % PROCESSES) + "-" + std::to_string(i / 2));
+                if (other && *other != std::to_string(i / 2))
+                    return false;
+            }
+            return true;
+        }));
+    }
+    for (pid_t child : children)
+        EXPECT_TRUE(succeeded(child));
+
+    Store store(options);
+    EXPECT_EQ(store.size(), static_cast<size_t>(PROCESSES * KEYS));
+    for (int p = 0; p < PROCESSES; ++p)
+        for (int i = 0; i < KEYS; i += 97)
+            EXPECT_EQ(store.get("p" + std::to_string(p) + "-" + std::to_string(i)), std::to_string(i));
+}
+
+TEST(SharedMemoryTest, RejectsMismatchedAttach) {
+    SharedName shared("mismatch");
+    ASSERT_TRUE(succeeded(spawn([&] {
+        KVStore store(shared.options());
+        return store.put("key", "value");
+    })));
+
+    EXPECT_THROW(ClockKVStore(shared.options()), std::runtime_error);
+    EXPECT_THROW((BasicKVStore<LruPolicy, AdaptiveLock>(shared.options())), std::runtime_error);
+    EXPECT_THROW(KVStore(shared.options(4096)), std::runtime_error);
+    KVStore store(shared.options());
+    EXPECT_EQ(store.get("key"), "value");
+    // This process maps the segment now, so it cannot attach a second time.
+    EXPECT_THROW(KVStore(shared.options()), std::runtime_error);
+}
+
+TEST(SharedMemoryTest, RejectsBadOptions) {
+    SharedName shared("options");
+    Options options = shared.options();
+    options.wal_path = "unused.wal";
+    EXPECT_THROW(KVStore{options}, std::invalid_argument);
+    options = shared.options();
+    options.shared_name = "a/b";
+    EXPECT_THROW(KVStore{options}, std::invalid_argument);
+    EXPECT_FALSE(SharedSegment::unlink(shared.name));
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/slab.hpp"
+
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace kvstore;
+
+namespace {
+    struct SlabFixture {
+        Arena arena;
+        SlabAllocator slab;
+
+        explicit SlabFixture(size_t pages, size_t page_bytes = SLAB_PAGE_SIZE)
+            : arena(SlabAllocator::storage_bytes(pages, page_bytes)) {
+            slab.init(arena, pages, page_bytes);
+        }
+    };
+}
+
+TEST(SlabAllocatorTest, ChunksAreDistinctAndLargeEnough) {
+    SlabFixture f(8);
+    std::set<uint32_t> offsets;
+
+    for (size_t size : {1, 16, 17, 100, 1000, 5000}) {
+        uint32_t chunk = f.slab.allocate(size);
+        ASSERT_NE(chunk, SlabAllocator::NONE);
+        EXPECT_GE(f.slab.chunk_size(chunk), size);
+        EXPECT_TRUE(offsets.insert(chunk).second);
+        std::memset(f.slab.data(chunk), 0xAB, size);
+    }
+}
+
+TEST(SlabAllocatorTest, FreedPagesAreReusedByOtherClasses) {
+    SlabFixture f(2);
+
+    // Fill both pages with small chunks.
+    std::vector<uint32_t> small;
+    while (true) {
+        uint32_t chunk = f.slab.allocate(16);
+        if (chunk == SlabAllocator::NONE) break;
+        small.push_back(chunk);
+    }
+    EXPECT_EQ(f.slab.pages_in_use(), 2u);
+    EXPECT_EQ(f.slab.allocate(4000), SlabAllocator::NONE);
+
+    // Emptying one page returns it to the pool for a different class.
+    size_t per_page = SLAB_PAGE_SIZE / 16;
+    for (size_t i = 0; i < per_page; ++i) {
+        f.slab.free(small[i]);
+    }
+    EXPECT_EQ(f.slab.pages_in_use(), 1u);
+    EXPECT_NE(f.slab.allocate(4000), SlabAllocator::NONE);
+}
+
+TEST(SlabAllocatorTest, RejectsAllocationsLargerThanAPage) {
+    SlabFixture f(2);
+    EXPECT_NE(f.slab.allocate(SLAB_PAGE_SIZE), SlabAllocator::NONE);
+    EXPECT_EQ(f.slab.allocate(SLAB_PAGE_SIZE + 1), SlabAllocator::NONE);
+}
+
+TEST(SlabAllocatorTest, PageSizeFollowsTheBudget) {
+    EXPECT_EQ(SlabAllocator::page_size_for(1 << 20), SLAB_PAGE_SIZE);
+    EXPECT_EQ(SlabAllocator::page_size_for(128 * 1024), 16u * 1024);
+    EXPECT_EQ(SlabAllocator::page_size_for(12 * 1024), SLAB_MIN_PAGE_SIZE);
+    EXPECT_EQ(SlabAllocator::pages_for(128 * 1024, 16 * 1024), 8u);
+
+    SlabFixture f(2, 8 * 1024);
+    EXPECT_EQ(f.slab.max_allocation(), 8u * 1024);
+    EXPECT_EQ(f.slab.total_bytes(), 16u * 1024);
+    EXPECT_NE(f.slab.allocate(8 * 1024), SlabAllocator::NONE);
+    EXPECT_EQ(f.slab.allocate(8 * 1024 + 1), SlabAllocator::NONE);
+}
+
+TEST(SlabAllocatorTest, EmptiestPageSkipsTheKeptChunk) {
+    SlabFixture f(3);
+    uint32_t kept = f.slab.allocate(16);
+    uint32_t big = f.slab.allocate(40000);
+    std::vector<uint32_t> medium;
+    for (int i = 0; i < 3; ++i)
+        medium.push_back(f.slab.allocate(1000));
+    EXPECT_EQ(f.slab.emptiest_page(SlabAllocator::NONE), f.slab.page_of(kept));
+    EXPECT_EQ(f.slab.emptiest_page(kept), f.slab.page_of(big));
+    EXPECT_EQ(f.slab.live_chunks(f.slab.page_of(medium[0])), 3u);
+    EXPECT_TRUE(f.slab.same_class(medium[1], 999));
+    EXPECT_FALSE(f.slab.same_class(medium[1], 40000));
+}
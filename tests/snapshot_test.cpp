@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/snapshot.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace kvstore;
+using namespace std::chrono_literals;
+
+namespace {
+    std::string snapshot_path(const char* name) {
+        return ::testing::TempDir() + "kvstore_" + name + "_" + std::to_string(::getpid()) + ".snap";
+    }
+
+    // Overwrites `bytes` bytes at `offset` with 0xFF.
+    void scribble(const std::string& path, size_t offset, size_t bytes) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(offset));
+        std::string junk(bytes, '\xFF');
+        file.write(junk.data(), static_cast<std::streamsize>(junk.size()));
+    }
+}
+
+// Values, sizes and eviction order all survive: after the reload, the next
+// insert evicts the same key the original store would have.
+TEST(SnapshotTest, RoundTripKeepsEntriesAndLruOrder) {
+    Options options;
+    options.capacity = 64;
+    options.num_shards = 1;
+    KVStore store(options);
+    for (int i = 0; i < 64; ++i)
+        store.put("key" + std::to_string(i), "value" + std::to_string(i));
+    store.erase("key5");
+    ASSERT_TRUE(store.get("key0").has_value());  // key1 is now the oldest
+
+    std::string path = snapshot_path("roundtrip");
+    store.snapshot(path);
+    auto loaded = KVStore::load(path);
+    std::remove(path.c_str());
+
+    EXPECT_EQ(loaded->size(), store.size());
+    EXPECT_EQ(loaded->memory_usage().payload_bytes, store.memory_usage().payload_bytes);
+    EXPECT_FALSE(loaded->get("key5").has_value());
+
+    loaded->put("new1", "x");  // takes the erased key's slot
+    loaded->put("new2", "x");
+    EXPECT_FALSE(loaded->get("key1").has_value());
+    EXPECT_EQ(loaded->get("key0"), "value0");
+    for (int i = 2; i < 64; ++i) {
+        if (i != 5) {
+            EXPECT_EQ(loaded->get("key" + std::to_string(i)), "value" + std::to_string(i));
+        }
+    }
+}
+
+TEST(SnapshotTest, LoadedStoreAcceptsWritesAndKeepsOptions) {
+    Options options;
+    options.capacity = 4096;
+    options.num_shards = 4;
+    options.admission = Admission::TinyLfu;
+    S3FifoKVStore store(options);
+    for (int i = 0; i < 3000; ++i)
+        store.put("key" + std::to_string(i), std::string(24, 'a' + i % 26));
+
+    std::string path = snapshot_path("writes");
+    store.snapshot(path);
+    auto loaded = S3FifoKVStore::load(path);
+    std::remove(path.c_str());
+
+    EXPECT_EQ(loaded->capacity(), 4096u);
+    EXPECT_EQ(loaded->shard_count(), 4u);
+    for (int i = 0; i < 20000; ++i)
+        loaded->put("more" + std::to_string(i), std::string(24, 'z'));
+    EXPECT_LE(loaded->size(), 4096u);
+    EXPECT_EQ(loaded->get("more19999"), std::string(24, 'z'));
+}
+
+// A TTL keeps counting down across the snapshot; one that ran out while
+// the store was on disk reads as a miss.
+TEST(SnapshotTest, TtlsSurviveReload) {
+    Options options;
+    options.capacity = 256;
+    options.num_shards = 2;
+    options.expiry = true;
+    KVStore store(options);
+    store.put("short", "a", 40ms);
+    store.put("long", "b", 1h);
+    store.put("forever", "c");
+
+    std::string path = snapshot_path("ttl");
+    store.snapshot(path);
+    std::this_thread::sleep_for(80ms);
+    auto loaded = KVStore::load(path);
+    std::remove(path.c_str());
+
+    EXPECT_FALSE(loaded->get("short").has_value());
+    EXPECT_EQ(loaded->get("long"), "b");
+    EXPECT_EQ(loaded->get("forever"), "c");
+    EXPECT_EQ(loaded->expire(), 1u);
+}
+
+TEST(SnapshotTest, RejectsForeignAndCorruptFiles) {
+    Options options;
+    options.capacity = 256;
+    options.num_shards = 2;
+    KVStore store(options);
+    for (int i = 0; i < 200; ++i)
+        store.put("key" + std::to_string(i), "value");
+
+    std::string path = snapshot_path("corrupt");
+    store.snapshot(path);
+    EXPECT_THROW(ClockKVStore::load(path), std::runtime_error);
+    EXPECT_THROW((BasicKVStore<LruPolicy, SpinLock, FnvHasher>::load(path)), std::runtime_error);
+    EXPECT_NO_THROW((BasicKVStore<LruPolicy, AdaptiveLock>::load(path)));
+
+    // The first shard's table wiped: its buckets now disagree with ctrl.
+    SnapshotHeader header;
+    {
+        std::ifstream file(path, std::ios::binary);
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    }
+    size_t table_start = header.arena_offset + Arena::bytes_for<uint8_t>(512 + MAX_GROUP_WIDTH);
+    scribble(path, table_start, 512 * sizeof(uint32_t));
+    EXPECT_THROW(KVStore::load(path), std::runtime_error);
+
+    scribble(path, 0, 8);
+    EXPECT_THROW(KVStore::load(path), std::runtime_error);
+    std::remove(path.c_str());
+    EXPECT_THROW(KVStore::load(path), std::system_error);
+}
+
+// An LRU list whose tail points back at its head passes every range check;
+// the bounded walk in restore() has to catch it.
+TEST(SnapshotTest, RejectsLoopedEvictionList) {
+    Options options;
+    options.capacity = 128;
+    options.num_shards = 1;
+    KVStore store(options);
+    for (const char* key : {"a", "b", "c"})
+        store.put(key, "value");
+
+    std::string path = snapshot_path("looped");
+    store.snapshot(path);
+    SnapshotHeader header;
+    {
+        std::ifstream file(path, std::ios::binary);
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    }
+    EXPECT_NO_THROW(KVStore::load(path));
+
+    // Nodes 0, 1, 2 hold "a", "b", "c"; node 0 is the tail, node 2 the head.
+    size_t meta_start = header.arena_offset + Arena::bytes_for<uint8_t>(256 + MAX_GROUP_WIDTH) +
+                        Arena::bytes_for<std::atomic<uint32_t>>(256);
+    uint32_t head = 2;
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(meta_start + offsetof(NodeMeta, next)));
+        file.write(reinterpret_cast<const char*>(&head), sizeof(head));
+    }
+    EXPECT_THROW(KVStore::load(path), std::runtime_error);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+
+#include <chrono>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace kvstore;
+using namespace std::chrono_literals;
+
+namespace {
+    uint64_t distance_total(const StoreStats& stats) {
+        return std::accumulate(stats.hit_distance.begin(), stats.hit_distance.end(), uint64_t{0});
+    }
+}
+
+TEST(StatsTest, CountsLookupsAndWrites) {
+    Options options;
+    options.capacity = 64;
+    options.num_shards = 1;
+    KVStore store(options);
+    for (int i = 0; i < 64; ++i)
+        store.put("key" + std::to_string(i), "value");
+    store.put("key0", "again");
+
+    EXPECT_TRUE(store.get("key1").has_value());
+    EXPECT_FALSE(store.get("nope").has_value());
+    std::string out;
+    EXPECT_TRUE(store.get_into("key2", out));
+    EXPECT_TRUE(store.pin("key3"));
+    std::vector<std::string_view> keys = {"key4", "key5", "missing"};
+    std::vector<std::optional<std::string>> values(keys.size());
+    EXPECT_EQ(store.multi_get(keys, values), 2u);
+    EXPECT_EQ(store.lookup_many(keys, values), 2u);
+
+    EXPECT_TRUE(store.erase("key6"));
+    EXPECT_FALSE(store.erase("key6"));
+    for (int i = 0; i < 10; ++i)
+        store.put("new" + std::to_string(i), "value");
+
+    StoreStats stats = store.stats();
+    EXPECT_EQ(stats.inserts, 74u);
+    EXPECT_EQ(stats.updates, 1u);
+    EXPECT_EQ(stats.erases, 1u);
+    EXPECT_EQ(stats.evictions, 9u);
+    EXPECT_EQ(stats.expirations, 0u);
+    EXPECT_EQ(stats.hits, 7u);
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(distance_total(stats), stats.hits);
+    EXPECT_EQ(stats.entries, 64u);
+    EXPECT_EQ(store.approximate_size(), store.size());
+}
+
+TEST(StatsTest, CountsExpirationsAndRetiredNodes) {
+    Options options;
+    options.capacity = 64;
+    options.num_shards = 1;
+    options.expiry = true;
+    KVStore store(options);
+    store.put("short", "a", 20ms);
+    store.put("held", "old");
+    std::this_thread::sleep_for(40ms);
+    EXPECT_FALSE(store.get("short").has_value());
+    EXPECT_EQ(store.expire(), 1u);
+
+    {
+        ValueHandle handle = store.pin("held");
+        store.put("held", "a longer value that moves");
+        EXPECT_EQ(store.stats().retired, 1u);
+    }
+    // The next node to leave, with nothing pinned, frees the retired one too.
+    store.put("other", "x");
+    store.erase("other");
+    StoreStats stats = store.stats();
+    EXPECT_EQ(stats.retired, 0u);
+    EXPECT_EQ(stats.expirations, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 1u);
+}
+
+// Readers on every stripe still add up exactly.
+TEST(StatsTest, ConcurrentReadersCountEveryLookup) {
+    KVStore store;
+    store.put("key", "value");
+    constexpr int THREADS = 8;
+    constexpr int READS = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&] {
+            std::string out;
+            for (int i = 0; i < READS; ++i) {
+                store.get_into("key", out);
+                store.get_into("absent", out);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    StoreStats stats = store.stats();
+    EXPECT_EQ(stats.hits, static_cast<uint64_t>(THREADS * READS));
+    EXPECT_EQ(stats.misses, static_cast<uint64_t>(THREADS * READS));
+}
+
+TEST(StatsTest, NoStatsCompilesCountersOut) {
+    static_assert(sizeof(Shard<LruPolicy, SpinLock, NoStats>) < sizeof(Shard<LruPolicy, SpinLock, ShardStats>));
+    BasicKVStore<LruPolicy, SpinLock, WyHasher, NoStats> store;
+    store.put("key", "value");
+    EXPECT_TRUE(store.get("key").has_value());
+    StoreStats stats = store.stats();
+    EXPECT_EQ(stats.inserts, 0u);
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(store.approximate_size(), 1u);
+}
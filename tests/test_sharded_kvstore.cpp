@@ -138,3 +138,29 @@ TEST(ShardThreadTest, ParallelReadsWritesDoNotCrash) {
 
     SUCCEED();
 }
+
+namespace {
+    // The first `count` keys of the form "k<i>" that land in `shard`.
+    std::vector<std::string> keys_in_shard(const KVStore& store, size_t shard, size_t count) {
+        std::vector<std::string> keys;
+        for (size_t i = 0; keys.size() < count; ++i) {
+            std::string key = "k" + std::to_string(i);
+            if (store.shard_of(key) == shard)
+                keys.push_back(std::move(key));
+        }
+        return keys;
+    }
+}
+
+// Each shard holds its share of the capacity and evicts on its own, however
+// skewed the keys are.
+TEST(ShardCapacityTest, FullShardEvictsAtItsShare) {
+    Options options;
+    options.capacity = 400;
+    options.num_shards = 4;
+    KVStore store(options);
+
+    for (const auto& key : keys_in_shard(store, 0, 400))
+        store.put(key, "v");
+    EXPECT_EQ(store.size(), 100u);
+}
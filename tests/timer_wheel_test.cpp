@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/arena.hpp"
+#include "lru-kvstore/timer_wheel.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace kvstore;
+
+namespace {
+    struct Wheel {
+        explicit Wheel(size_t capacity, uint64_t now) : arena(TimerWheel::storage_bytes(capacity)) {
+            wheel.init(arena, capacity, now);
+        }
+
+        std::vector<uint32_t> advance(uint64_t now, size_t max = SIZE_MAX) {
+            std::vector<uint32_t> expired(std::min(max, wheel.size()));
+            expired.resize(wheel.advance(now, expired.data(), expired.size()));
+            return expired;
+        }
+
+        Arena arena;
+        TimerWheel wheel;
+    };
+}
+
+// Deadlines on every level, advanced in uneven steps: each node comes off
+// exactly when its deadline passes, never early or late.
+TEST(TimerWheelTest, ExpiresEachNodeAtItsDeadline) {
+    const size_t nodes = 2000;
+    const uint64_t start = 1'000'003;
+    Wheel w(nodes, start);
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> deadline(nodes);
+    for (uint32_t i = 0; i < nodes; ++i) {
+        // Spread over 1 tick to ~64^4 ticks away, log-uniformly.
+        deadline[i] = start + 1 + (rng() % (uint64_t{1} << (rng() % 25)));
+        w.wheel.schedule(i, deadline[i]);
+    }
+    EXPECT_EQ(w.wheel.size(), nodes);
+
+    std::vector<bool> gone(nodes);
+    uint64_t now = start;
+    while (!w.wheel.empty()) {
+        now += 1 + rng() % 5000;
+        for (uint32_t node : w.advance(now)) {
+            ASSERT_FALSE(gone[node]);
+            EXPECT_LE(deadline[node], now);
+            gone[node] = true;
+        }
+        for (uint32_t i = 0; i < nodes; ++i)
+            ASSERT_EQ(gone[i], deadline[i] <= now) << i;
+    }
+}
+
+TEST(TimerWheelTest, RescheduleCancelAndBatchLimit) {
+    Wheel w(16, 100);
+    for (uint32_t i = 0; i < 10; ++i)
+        w.wheel.schedule(i, 150);
+    w.wheel.schedule(3, 5000);
+    w.wheel.cancel(4);
+    w.wheel.schedule(5, 0);
+    EXPECT_EQ(w.wheel.size(), 8u);
+    EXPECT_FALSE(w.wheel.due(149));
+    EXPECT_TRUE(w.advance(149).empty());
+
+    // Seven are due; take them three at a time.
+    EXPECT_EQ(w.advance(200, 3).size(), 3u);
+    EXPECT_EQ(w.advance(200, 3).size(), 3u);
+    EXPECT_EQ(w.advance(200, 3).size(), 1u);
+    EXPECT_EQ(w.wheel.deadline(0), 0u);
+
+    EXPECT_TRUE(w.advance(4999).empty());
+    EXPECT_EQ(w.advance(5000), std::vector<uint32_t>{3});
+    EXPECT_TRUE(w.wheel.empty());
+}
+
+// Past the top level (64^5 ticks) a deadline waits in the furthest slot and
+// is placed again each time that slot comes round.
+TEST(TimerWheelTest, FarDeadlinesWaitOnTheTopLevel) {
+    const uint64_t top = uint64_t{1} << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS);
+    Wheel w(2, 0);
+    w.wheel.schedule(0, 3 * top + 17);
+    w.wheel.schedule(1, top / 2);
+    EXPECT_EQ(w.advance(top), std::vector<uint32_t>{1});
+    EXPECT_TRUE(w.advance(3 * top + 16).empty());
+    EXPECT_EQ(w.advance(3 * top + 17), std::vector<uint32_t>{0});
+}
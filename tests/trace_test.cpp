@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/trace.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace kvstore;
+
+namespace {
+    std::string trace_path(const char* name) {
+        return ::testing::TempDir() + "kvstore_" + name + "_" + std::to_string(::getpid()) + ".trace";
+    }
+
+    void write_text(const std::string& path, const std::string& text) {
+        std::ofstream(path, std::ios::binary) << text;
+    }
+
+    std::vector<TraceRecord> read_all(const TraceFile& file) {
+        std::vector<TraceRecord> records;
+        TraceFile::Cursor cursor = file.cursor();
+        TraceRecord record;
+        while (cursor.next(record))
+            records.push_back(record);
+        return records;
+    }
+}
+
+TEST(TraceTest, ParsesCsv) {
+    std::string path = trace_path("csv");
+    write_text(path,
+               "# timestamp_us,op,key,value_bytes\n"
+               "100,get,user:1\r\n"
+               "\n"
+               "150,PUT,user:1,512\n"
+               "200,erase,user:2,0\n"
+               "250,get,user:3");
+    TraceFile file(path);
+    EXPECT_FALSE(file.binary());
+    auto records = read_all(file);
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[0].timestamp_us, 100u);
+    EXPECT_EQ(records[0].op, TraceOp::Get);
+    EXPECT_EQ(records[0].key, "user:1");
+    EXPECT_EQ(records[1].op, TraceOp::Put);
+    EXPECT_EQ(records[1].value_bytes, 512u);
+    EXPECT_EQ(records[2].op, TraceOp::Erase);
+    EXPECT_EQ(records[2].key, "user:2");
+    EXPECT_EQ(records[3].key, "user:3");
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, RejectsMalformedCsv) {
+    std::string path = trace_path("bad_csv");
+    for (const char* line : {"1,fetch,key", "x,get,key", "1,get", "1,put,key", "1,put,key,10,extra"}) {
+        write_text(path, std::string("0,get,fine\n") + line + "\n");
+        TraceFile file(path);
+        try {
+            read_all(file);
+            ADD_FAILURE() << "accepted " << line;
+        } catch (const std::runtime_error& error) {
+            EXPECT_NE(std::string(error.what()).find("line 2"), std::string::npos) << error.what();
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, BinaryRoundTrip) {
+    std::string path = trace_path("binary");
+    std::vector<std::string> keys;
+    for (int i = 0; i < 100000; ++i)
+        keys.push_back("key" + std::to_string(i));
+    {
+        TraceWriter writer(path);
+        for (size_t i = 0; i < keys.size(); ++i)
+            writer.write({i * 10, static_cast<TraceOp>(i % 3), static_cast<uint32_t>(i % 1000), keys[i]});
+        // Out of order and far apart timestamps survive the delta encoding.
+        writer.write({5, TraceOp::Get, 0, std::string(70000, 'k')});
+        writer.write({UINT64_MAX, TraceOp::Erase, 0, "last"});
+        writer.close();
+    }
+
+    TraceFile file(path);
+    EXPECT_TRUE(file.binary());
+    auto records = read_all(file);
+    ASSERT_EQ(records.size(), keys.size() + 2);
+    EXPECT_EQ(records[keys.size()].timestamp_us, 5u);
+    EXPECT_EQ(records[keys.size()].key.size(), 70000u);
+    EXPECT_EQ(records[keys.size() + 1].timestamp_us, UINT64_MAX);
+    EXPECT_EQ(records[keys.size() + 1].key, "last");
+    for (size_t i = 0; i < keys.size(); i += 997) {
+        EXPECT_EQ(records[i].timestamp_us, i * 10);
+        EXPECT_EQ(records[i].op, static_cast<TraceOp>(i % 3));
+        EXPECT_EQ(records[i].value_bytes, i % 1000);
+        EXPECT_EQ(records[i].key, keys[i]);
+    }
+
+    // A record cut short is an error, not the end of the trace.
+    ASSERT_EQ(::truncate(path.c_str(), static_cast<off_t>(file.bytes() - 3)), 0);
+    TraceFile truncated(path);
+    EXPECT_THROW(read_all(truncated), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, EmptyAndMissingFiles) {
+    std::string path = trace_path("empty");
+    write_text(path, "");
+    TraceFile file(path);
+    EXPECT_TRUE(read_all(file).empty());
+    std::remove(path.c_str());
+    EXPECT_THROW(TraceFile(trace_path("missing")), std::system_error);
+}
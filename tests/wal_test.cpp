@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/wal.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace kvstore;
+using namespace std::chrono_literals;
+
+namespace {
+    // A fresh log path; removes the log and its snapshot on the way out.
+    struct WalFiles {
+        explicit WalFiles(const char* name)
+            : path(::testing::TempDir() + "kvstore_" + name + "_" + std::to_string(::getpid()) + ".wal") {
+            remove();
+        }
+        ~WalFiles() { remove(); }
+
+        void remove() const {
+            std::remove(path.c_str());
+            std::remove((path + ".snap").c_str());
+        }
+
+        Options options(std::chrono::milliseconds interval = 10ms, size_t commit_bytes = 1 << 20) const {
+            Options options;
+            options.capacity = 4096;
+            options.num_shards = 4;
+            options.expiry = true;
+            options.wal_path = path;
+            options.wal_commit_interval = interval;
+            options.wal_commit_bytes = commit_bytes;
+            return options;
+        }
+
+        std::string path;
+    };
+}
+
+TEST(WalTest, ReplayStopsAtTornRecord) {
+    WalFiles files("torn");
+    {
+        WriteAheadLog log(files.path);
+        log.reset(7);
+        WalBuffer buffers[2];
+        buffers[0].put("a", "1", 0);
+        buffers[0].erase("b");
+        buffers[1].put("c", "333", 1234);
+        log.append(buffers);
+        log.sync();
+    }
+    // Cut the last record short, as a crash mid-write would.
+    std::filesystem::resize_file(files.path, std::filesystem::file_size(files.path) - 2);
+
+    WriteAheadLog log(files.path);
+    EXPECT_EQ(log.generation(), 7u);
+    std::vector<std::string> seen;
+    EXPECT_EQ(log.replay([&](const WalRecord& record) {
+        seen.push_back(std::to_string(static_cast<int>(record.type)) + ":" + std::string(record.key) + "=" +
+                       std::string(record.value));
+    }), 2u);
+    EXPECT_EQ(seen, (std::vector<std::string>{"1:a=1", "2:b="}));
+}
+
+// A write cut short (here by RLIMIT_FSIZE) is trimmed off, so what is
+// appended after it still replays.
+TEST(WalTest, FailedAppendLeavesNoTornRecord) {
+    WalFiles files("short");
+    WriteAheadLog log(files.path);
+    log.reset(1);
+    WalBuffer first;
+    first.put("a", "1", 0);
+    log.append(std::span<const WalBuffer>(&first, 1));
+
+    WalBuffer big;
+    big.put("big", std::string(8192, 'x'), 0);
+    rlimit saved{};
+    ::getrlimit(RLIMIT_FSIZE, &saved);
+    rlimit limited = saved;
+    limited.rlim_cur = std::filesystem::file_size(files.path) + 100;
+    auto handler = std::signal(SIGXFSZ, SIG_IGN);
+    ::setrlimit(RLIMIT_FSIZE, &limited);
+    EXPECT_THROW(log.append(std::span<const WalBuffer>(&big, 1)), std::system_error);
+    ::setrlimit(RLIMIT_FSIZE, &saved);
+    std::signal(SIGXFSZ, handler);
+
+    WalBuffer last;
+    last.erase("a");
+    log.append(std::span<const WalBuffer>(&last, 1));
+    std::vector<std::string> seen;
+    EXPECT_EQ(log.replay([&](const WalRecord& record) { seen.push_back(std::string(record.key)); }), 2u);
+    EXPECT_EQ(seen, (std::vector<std::string>{"a", "a"}));
+}
+
+TEST(WalTest, StoreReopensWithItsWrites) {
+    WalFiles files("reopen");
+    {
+        KVStore store(files.options());
+        for (int i = 0; i < 1000; ++i)
+            store.put("key" + std::to_string(i), "value" + std::to_string(i));
+        for (int i = 0; i < 1000; i += 3)
+            store.erase("key" + std::to_string(i));
+        std::pair<std::string_view, std::string_view> batch[] = {{"key1", "batched"}, {"fresh", "x"}};
+        store.multi_put(batch);
+        store.put("ttl", "gone soon", 40ms);
+        store.put("ttl-long", "stays", 1h);
+    }
+    std::this_thread::sleep_for(80ms);
+
+    for (int reopen = 0; reopen < 2; ++reopen) {
+        KVStore store(files.options());
+        EXPECT_EQ(store.get("key1"), "batched");
+        EXPECT_EQ(store.get("fresh"), "x");
+        EXPECT_EQ(store.get("key2"), "value2");
+        EXPECT_FALSE(store.get("key3").has_value());
+        EXPECT_FALSE(store.get("ttl").has_value());
+        EXPECT_EQ(store.get("ttl-long"), "stays");
+        EXPECT_EQ(store.size(), 1000u - 334u + 2u);
+    }
+    // Opening compacted the replayed log into the snapshot.
+    EXPECT_TRUE(std::filesystem::exists(files.path + ".snap"));
+    EXPECT_EQ(std::filesystem::file_size(files.path), 16u);
+}
+
+// An overwrite of a full shard while another key is pinned goes through,
+// in memory and in the log.
+TEST(WalTest, OverwriteWhilePinnedSurvivesReopen) {
+    WalFiles files("pinned");
+    Options options = files.options();
+    options.capacity = 4;
+    options.num_shards = 1;
+    {
+        KVStore store(options);
+        for (int i = 0; i < 4; ++i)
+            store.put("k" + std::to_string(i), "v");
+        ValueHandle handle = store.pin("k0");
+        EXPECT_TRUE(store.put("k1", std::string(100, 'x')));
+        EXPECT_EQ(store.get("k1"), std::string(100, 'x'));
+    }
+    KVStore store(options);
+    EXPECT_EQ(store.get("k1"), std::string(100, 'x'));
+    EXPECT_EQ(store.get("k0"), "v");
+    EXPECT_EQ(store.size(), 4u);
+}
+
+// Once the retired ring is full of chunks an old handle may read, an
+// overwrite of a pinned key fails without touching the shard: the old value
+// stays, nothing is evicted, and the log agrees after a reopen.
+TEST(WalTest, FailedOverwriteKeepsTheOldValue) {
+    WalFiles files("failed");
+    Options options = files.options();
+    options.capacity = 64;
+    options.num_shards = 1;
+    size_t rounds = 0;
+    {
+        KVStore store(options);
+        for (int i = 0; i < 32; ++i)
+            store.put("k" + std::to_string(i), "v");
+        ValueHandle oldest = store.pin("k1");
+        bool stored = true;
+        for (; stored && rounds < 1000; ++rounds) {
+            ValueHandle handle = store.pin("k0");
+            stored = store.put("k0", "v" + std::to_string(rounds));
+        }
+        EXPECT_FALSE(stored);
+        EXPECT_EQ(rounds, Shard<LruPolicy>::retired_slots_for(options.capacity) + 1);
+        EXPECT_EQ(store.get("k0"), "v" + std::to_string(rounds - 2));
+        EXPECT_EQ(store.size(), 32u);
+    }
+    KVStore store(options);
+    EXPECT_EQ(store.get("k0"), "v" + std::to_string(rounds - 2));
+    EXPECT_EQ(store.size(), 32u);
+}
+
+// The child process dies without running a destructor: what it synced is
+// there, what it only buffered is not.
+TEST(WalTest, SyncedWritesSurviveACrash) {
+    WalFiles files("crash");
+    pid_t child = ::fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        KVStore store(files.options(1h, 1 << 30));
+        for (int i = 0; i < 100; ++i)
+            store.put("synced" + std::to_string(i), "v");
+        store.sync();
+        store.put("unsynced", "v");
+        std::_Exit(0);
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+
+    KVStore store(files.options());
+    EXPECT_EQ(store.size(), 100u);
+    EXPECT_EQ(store.get("synced99"), "v");
+    EXPECT_FALSE(store.get("unsynced").has_value());
+}
+
+// A log from before a compaction is already in the snapshot; replaying it
+// would roll keys back, so it is skipped.
+TEST(WalTest, CompactionSupersedesOlderLog) {
+    WalFiles files("compact");
+    std::string saved = files.path + ".old";
+    {
+        KVStore store(files.options());
+        store.put("key", "old");
+        store.sync();
+        std::filesystem::copy_file(files.path, saved, std::filesystem::copy_options::overwrite_existing);
+        store.put("key", "new");
+        store.compact();
+        EXPECT_EQ(std::filesystem::file_size(files.path), 16u);
+        store.put("after", "x");
+    }
+    {
+        KVStore store(files.options());
+        EXPECT_EQ(store.get("key"), "new");
+        EXPECT_EQ(store.get("after"), "x");
+    }
+    std::filesystem::rename(saved, files.path);
+    KVStore store(files.options());
+    EXPECT_EQ(store.get("key"), "new");
+}
+
+// Erases count toward wal_commit_bytes like puts do: with the interval out
+// of the way, a run of erases alone reaches the file.
+TEST(WalTest, ErasesTriggerSizeBasedCommits) {
+    WalFiles files("erases");
+    KVStore store(files.options(1h, 4096));
+    store.sync();
+    auto synced = std::filesystem::file_size(files.path);
+    for (int i = 0; i < 4000; ++i)
+        store.erase("a-key-that-was-never-put-" + std::to_string(i));
+    EXPECT_GT(std::filesystem::file_size(files.path), synced);
+}
+
+TEST(WalTest, RejectsBadOptions) {
+    WalFiles files("options");
+    EXPECT_THROW(KVStore(files.options(0ms)), std::invalid_argument);
+    EXPECT_THROW(KVStore(files.options(10ms, 0)), std::invalid_argument);
+    KVStore volatile_store;
+    EXPECT_THROW(volatile_store.sync(), std::logic_error);
+    EXPECT_THROW(volatile_store.compact(), std::logic_error);
+}
@@ -0,0 +1,346 @@
+// kvstore_replay: replays a recorded access trace (see trace.hpp) against
+// KVStores of several capacities in one pass, and reports hit ratios, hit
+// ratio over time, evictions and throughput as JSON on stdout, next to a
+// SHARDS estimate of an exact LRU cache's miss-ratio curve.
+//
+//   kvstore_replay TRACE [--capacities=10000,100000] [--threads=1] [--interval-s=60]
+//                        [--entry-bytes=256] [--fill-on-miss=BYTES] [--sampling-rate=0.01]
+//   kvstore_replay TRACE --write-binary=OUT
+//
+// Every thread walks the whole mapped trace, and handles only the records
+// whose keys fall in its slice of the shard range. Each key is therefore
+// replayed by one thread in trace order, and threads rarely share a shard.
+// Gets are get_into(), puts put a value of the recorded size, and erases
+// erase. With --fill-on-miss, a get that misses also puts the key (a
+// value of BYTES bytes, or the recorded size if there is one), as a
+// cache-aside client would for a trace of reads only. Each store has
+// capacity entries and a memory budget of capacity * --entry-bytes.
+//
+// --write-binary converts a CSV trace into the binary format, which is
+// smaller and parses without scanning for delimiters or digits.
+
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/miss_ratio.hpp"
+#include "lru-kvstore/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace kvstore;
+
+namespace {
+    struct Config {
+        std::string trace;
+        std::vector<size_t> capacities = {10'000, 100'000};
+        size_t threads = 1;
+        uint64_t interval_s = 60;
+        size_t entry_bytes = 256;
+        size_t fill_on_miss = 0;  // 0 = off
+        double sampling_rate = 0.01;
+        std::string write_binary;
+    };
+
+    // Gets and hits of one store in one interval of trace time.
+    struct Window {
+        uint64_t gets = 0;
+        uint64_t hits = 0;
+    };
+
+    struct ThreadResult {
+        uint64_t records = 0;
+        uint64_t gets = 0;
+        uint64_t puts = 0;
+        uint64_t erases = 0;
+        std::vector<uint64_t> rejected;             // per store: puts that did not fit
+        std::vector<std::vector<Window>> windows;   // per store, per interval
+    };
+
+    [[noreturn]] void usage(const char* error) {
+        std::fprintf(stderr,
+                     "kvstore_replay: %s\n"
+                     "usage: kvstore_replay TRACE [--capacities=N,...] [--threads=N] [--interval-s=N]\n"
+                     "                            [--entry-bytes=N] [--fill-on-miss=BYTES] [--sampling-rate=R]\n"
+                     "       kvstore_replay TRACE --write-binary=OUT\n",
+                     error);
+        std::exit(2);
+    }
+
+    std::vector<size_t> parse_list(const std::string& text) {
+        std::vector<size_t> values;
+        size_t begin = 0;
+        while (begin <= text.size()) {
+            size_t end = text.find(',', begin);
+            if (end == std::string::npos)
+                end = text.size();
+            values.push_back(std::stoull(text.substr(begin, end - begin)));
+            begin = end + 1;
+        }
+        return values;
+    }
+
+    Config parse(int argc, char** argv) {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0) {
+                if (!config.trace.empty())
+                    usage("more than one trace given");
+                config.trace = arg;
+                continue;
+            }
+            size_t eq = arg.find('=');
+            if (eq == std::string::npos)
+                usage(("bad argument " + arg).c_str());
+            std::string name = arg.substr(2, eq - 2);
+            std::string value = arg.substr(eq + 1);
+            try {
+                if (name == "capacities")
+                    config.capacities = parse_list(value);
+                else if (name == "threads")
+                    config.threads = std::stoull(value);
+                else if (name == "interval-s")
+                    config.interval_s = std::stoull(value);
+                else if (name == "entry-bytes")
+                    config.entry_bytes = std::stoull(value);
+                else if (name == "fill-on-miss")
+                    config.fill_on_miss = std::stoull(value);
+                else if (name == "sampling-rate")
+                    config.sampling_rate = std::stod(value);
+                else if (name == "write-binary")
+                    config.write_binary = value;
+                else
+                    usage(("unknown option --" + name).c_str());
+            } catch (const std::logic_error&) {
+                usage(("bad value for --" + name).c_str());
+            }
+        }
+        if (config.trace.empty())
+            usage("no trace given");
+        if (config.threads == 0 || config.interval_s == 0 || config.entry_bytes == 0)
+            usage("threads, interval-s and entry-bytes must be positive");
+        if (!(config.sampling_rate > 0.0 && config.sampling_rate <= 1.0))
+            usage("sampling-rate must be in (0, 1]");
+        for (size_t capacity : config.capacities)
+            if (capacity < DEFAULT_NUM_SHARDS)
+                usage("capacities must be at least the shard count");
+        return config;
+    }
+
+    int write_binary(const Config& config) {
+        TraceFile input(config.trace);
+        TraceWriter output(config.write_binary);
+        TraceFile::Cursor cursor = input.cursor();
+        TraceRecord record;
+        uint64_t records = 0;
+        while (cursor.next(record)) {
+            output.write(record);
+            ++records;
+        }
+        output.close();
+        std::printf("{\"trace\": \"%s\", \"records\": %llu, \"output\": \"%s\"}\n", config.trace.c_str(),
+                    static_cast<unsigned long long>(records), config.write_binary.c_str());
+        return 0;
+    }
+
+    // Which thread replays a key: its slice of the high 32 hash bits, which
+    // also pick the shard.
+    size_t owner(uint64_t hash, size_t threads) {
+        return static_cast<size_t>(((hash >> 32) * threads) >> 32);
+    }
+
+    void replay(const TraceFile& trace, const Config& config, std::vector<std::unique_ptr<KVStore>>& stores,
+                size_t thread, ThreadResult& result, MissRatioCurve* curve) {
+        result.rejected.assign(stores.size(), 0);
+        result.windows.resize(stores.size());
+        const uint64_t interval_us = config.interval_s * 1'000'000;
+        std::string value;
+        std::string out;
+        auto value_of = [&](size_t bytes) {
+            if (value.size() < bytes)
+                value.resize(bytes, 'v');
+            return std::string_view(value.data(), bytes);
+        };
+
+        TraceFile::Cursor cursor = trace.cursor();
+        TraceRecord record;
+        bool first = true;
+        uint64_t start_us = 0;
+        while (cursor.next(record)) {
+            if (first) {
+                start_us = record.timestamp_us;
+                first = false;
+            }
+            HashedKey key = KVStore::prehash(record.key);
+            if (curve) {
+                if (record.op == TraceOp::Erase)
+                    curve->erase(key.hash);
+                else
+                    curve->access(key.hash);
+            }
+            if (owner(key.hash, config.threads) != thread)
+                continue;
+
+            ++result.records;
+            size_t window = record.timestamp_us > start_us ? (record.timestamp_us - start_us) / interval_us : 0;
+            for (size_t s = 0; s < stores.size(); ++s) {
+                KVStore& store = *stores[s];
+                switch (record.op) {
+                    case TraceOp::Get: {
+                        auto& windows = result.windows[s];
+                        if (window >= windows.size())
+                            windows.resize(window + 1);
+                        bool hit = store.get_into(key, out);
+                        ++windows[window].gets;
+                        windows[window].hits += hit;
+                        if (!hit && config.fill_on_miss != 0) {
+                            size_t bytes = record.value_bytes != 0 ? record.value_bytes : config.fill_on_miss;
+                            result.rejected[s] += !store.put(key, value_of(bytes));
+                        }
+                        break;
+                    }
+                    case TraceOp::Put:
+                        result.rejected[s] += !store.put(key, value_of(record.value_bytes));
+                        break;
+                    case TraceOp::Erase:
+                        store.erase(key);
+                        break;
+                }
+            }
+            result.gets += record.op == TraceOp::Get;
+            result.puts += record.op == TraceOp::Put;
+            result.erases += record.op == TraceOp::Erase;
+        }
+    }
+
+    // The configured capacities plus powers of two from 1024 to 8x the
+    // largest, where the curve is sampled.
+    std::vector<size_t> curve_points(const Config& config) {
+        std::vector<size_t> points = config.capacities;
+        size_t largest = *std::max_element(config.capacities.begin(), config.capacities.end());
+        for (size_t point = 1024; point <= 8 * largest; point *= 2)
+            points.push_back(point);
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+        return points;
+    }
+
+    int run(const Config& config) {
+        TraceFile trace(config.trace);
+        std::vector<std::unique_ptr<KVStore>> stores;
+        for (size_t capacity : config.capacities) {
+            Options options;
+            options.capacity = capacity;
+            options.memory_budget = capacity * config.entry_bytes;
+            stores.push_back(std::make_unique<KVStore>(options));
+        }
+        MissRatioCurve curve(config.sampling_rate);
+
+        std::vector<ThreadResult> results(config.threads);
+        std::vector<std::exception_ptr> errors(config.threads);
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < config.threads; ++t) {
+            workers.emplace_back([&, t] {
+                try {
+                    replay(trace, config, stores, t, results[t], t == 0 ? &curve : nullptr);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const auto& error : errors)
+            if (error)
+                std::rethrow_exception(error);
+
+        ThreadResult total;
+        total.rejected.assign(stores.size(), 0);
+        total.windows.resize(stores.size());
+        for (const ThreadResult& result : results) {
+            total.records += result.records;
+            total.gets += result.gets;
+            total.puts += result.puts;
+            total.erases += result.erases;
+            for (size_t s = 0; s < stores.size(); ++s) {
+                total.rejected[s] += result.rejected[s];
+                auto& windows = total.windows[s];
+                if (windows.size() < result.windows[s].size())
+                    windows.resize(result.windows[s].size());
+                for (size_t w = 0; w < result.windows[s].size(); ++w) {
+                    windows[w].gets += result.windows[s][w].gets;
+                    windows[w].hits += result.windows[s][w].hits;
+                }
+            }
+        }
+        auto ratio = [](uint64_t part, uint64_t whole) {
+            return whole == 0 ? 0.0 : static_cast<double>(part) / static_cast<double>(whole);
+        };
+
+        std::printf("{\n");
+        std::printf("  \"trace\": \"%s\",\n", config.trace.c_str());
+        std::printf("  \"format\": \"%s\",\n", trace.binary() ? "binary" : "csv");
+        std::printf("  \"records\": %llu,\n", static_cast<unsigned long long>(total.records));
+        std::printf("  \"gets\": %llu,\n", static_cast<unsigned long long>(total.gets));
+        std::printf("  \"puts\": %llu,\n", static_cast<unsigned long long>(total.puts));
+        std::printf("  \"erases\": %llu,\n", static_cast<unsigned long long>(total.erases));
+        std::printf("  \"threads\": %zu,\n", config.threads);
+        std::printf("  \"seconds\": %.3f,\n", seconds);
+        std::printf("  \"records_per_second\": %.0f,\n", static_cast<double>(total.records) / seconds);
+        std::printf("  \"stores\": [\n");
+        for (size_t s = 0; s < stores.size(); ++s) {
+            StoreStats stats = stores[s]->stats();
+            uint64_t hits = 0;
+            for (const Window& window : total.windows[s])
+                hits += window.hits;
+            std::printf("    {\n");
+            std::printf("      \"capacity\": %zu,\n", config.capacities[s]);
+            std::printf("      \"hit_ratio\": %.4f,\n", ratio(hits, total.gets));
+            std::printf("      \"lru_estimate_hit_ratio\": %.4f,\n", 1.0 - curve.miss_ratio(config.capacities[s]));
+            std::printf("      \"evictions\": %llu,\n", static_cast<unsigned long long>(stats.evictions));
+            std::printf("      \"rejected_puts\": %llu,\n", static_cast<unsigned long long>(total.rejected[s]));
+            std::printf("      \"entries\": %zu,\n", stats.entries);
+            std::printf("      \"windows\": [");
+            for (size_t w = 0; w < total.windows[s].size(); ++w) {
+                const Window& window = total.windows[s][w];
+                std::printf("%s\n        {\"start_s\": %llu, \"gets\": %llu, \"hit_ratio\": %.4f}", w ? "," : "",
+                            static_cast<unsigned long long>(w * config.interval_s),
+                            static_cast<unsigned long long>(window.gets), ratio(window.hits, window.gets));
+            }
+            std::printf("%s]\n", total.windows[s].empty() ? "" : "\n      ");
+            std::printf("    }%s\n", s + 1 == stores.size() ? "" : ",");
+        }
+        std::printf("  ],\n");
+        std::printf("  \"lru_miss_ratio_curve\": {\n");
+        std::printf("    \"sampling_rate\": %g,\n", config.sampling_rate);
+        std::printf("    \"sampled_keys\": %zu,\n", curve.sampled_keys());
+        std::printf("    \"points\": [");
+        std::vector<size_t> points = curve_points(config);
+        for (size_t i = 0; i < points.size(); ++i)
+            std::printf("%s\n      {\"capacity\": %zu, \"miss_ratio\": %.4f}", i ? "," : "", points[i],
+                        curve.miss_ratio(points[i]));
+        std::printf("\n    ]\n");
+        std::printf("  }\n");
+        std::printf("}\n");
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config = parse(argc, argv);
+    try {
+        return config.write_binary.empty() ? run(config) : write_binary(config);
+    } catch (const std::exception& error) {
+        std::fprintf(stderr, "kvstore_replay: %s\n", error.what());
+        return 1;
+    }
+}
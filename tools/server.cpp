@@ -0,0 +1,109 @@
+// kvstore_server: serves a KVStore over TCP with the memcached text
+// protocol (get, gets, set, delete; see memcached.hpp) until SIGINT or
+// SIGTERM.
+//
+//   kvstore_server [--address=127.0.0.1] [--port=11211] [--threads=4]
+//                  [--capacity=1000000] [--memory-mb=0] [--shards=64]
+//
+// The store evicts by LRU once it holds --capacity entries or, if given,
+// --memory-mb of keys and values (each value carries 4 bytes of memcached
+// flags). Expiry is on, so set's exptime works.
+
+#include "lru-kvstore/kv_store.hpp"
+#include "lru-kvstore/server.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+using namespace kvstore;
+
+namespace {
+    struct Config {
+        ServerOptions server;
+        size_t capacity = 1'000'000;
+        size_t memory_mb = 0;
+        size_t shards = 64;
+    };
+
+    [[noreturn]] void usage(const char* error) {
+        std::fprintf(stderr,
+                     "kvstore_server: %s\n"
+                     "usage: kvstore_server [--address=127.0.0.1] [--port=11211] [--threads=4]\n"
+                     "                      [--capacity=1000000] [--memory-mb=0] [--shards=64]\n",
+                     error);
+        std::exit(2);
+    }
+
+    Config parse(int argc, char** argv) {
+        Config config;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos)
+                usage(("bad argument " + arg).c_str());
+            std::string name = arg.substr(2, eq - 2);
+            std::string value = arg.substr(eq + 1);
+            try {
+                if (name == "address") {
+                    config.server.address = value;
+                } else if (name == "port") {
+                    unsigned long port = std::stoul(value);
+                    if (port > 65535)
+                        usage("port must be below 65536");
+                    config.server.port = static_cast<uint16_t>(port);
+                } else if (name == "threads") {
+                    config.server.threads = std::stoull(value);
+                } else if (name == "capacity") {
+                    config.capacity = std::stoull(value);
+                } else if (name == "memory-mb") {
+                    config.memory_mb = std::stoull(value);
+                } else if (name == "shards") {
+                    config.shards = std::stoull(value);
+                } else {
+                    usage(("unknown option --" + name).c_str());
+                }
+            } catch (const std::logic_error&) {
+                usage(("bad value for --" + name).c_str());
+            }
+        }
+        if (config.server.threads == 0 || config.capacity == 0 || config.shards == 0)
+            usage("threads, capacity and shards must be positive");
+        return config;
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config = parse(argc, argv);
+
+    // Blocked before the workers start so that they inherit the mask and
+    // only sigwait() below sees the signals.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        Options options;
+        options.capacity = config.capacity;
+        options.memory_budget = config.memory_mb << 20;
+        options.num_shards = config.shards;
+        options.expiry = true;
+        KVStore store(options);
+        Server server(store, config.server);
+        std::fprintf(stderr, "kvstore_server: listening on %s:%u with %zu threads\n",
+                     config.server.address.c_str(), static_cast<unsigned>(server.port()), config.server.threads);
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+        server.stop();
+        return 0;
+    } catch (const std::exception& error) {
+        std::fprintf(stderr, "kvstore_server: %s\n", error.what());
+        return 1;
+    }
+}